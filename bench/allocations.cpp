@@ -0,0 +1,109 @@
+/*************************************************************************************************/
+/**
+	allocations.cpp
+
+	Counts the allocations made by beebasm-bench, by replacing the global operator new and delete
+
+
+	Copyright (C) Rich Talbot-Watkins 2007 - 2012
+
+	This file is part of BeebAsm.
+
+	BeebAsm is free software: you can redistribute it and/or modify it under the terms of the GNU
+	General Public License as published by the Free Software Foundation, either version 3 of the
+	License, or (at your option) any later version.
+
+	BeebAsm is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without
+	even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License along with BeebAsm, as
+	COPYING.txt.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/*************************************************************************************************/
+
+#include <cstdlib>
+#include <new>
+
+#include "allocations.h"
+
+
+using namespace std;
+
+
+static unsigned long long gAllocations = 0;
+static unsigned long long gAllocatedBytes = 0;
+
+
+
+/*************************************************************************************************/
+/**
+	operator new()
+
+	Allocates with malloc(), counting each allocation
+*/
+/*************************************************************************************************/
+void* operator new( size_t size )
+{
+	gAllocations++;
+	gAllocatedBytes += size;
+
+	void* p = malloc( size == 0 ? 1 : size );
+
+	if ( p == NULL )
+	{
+		throw bad_alloc();
+	}
+
+	return p;
+}
+
+
+
+/*************************************************************************************************/
+/**
+	operator delete()
+*/
+/*************************************************************************************************/
+void operator delete( void* p ) noexcept
+{
+	free( p );
+}
+
+
+
+/*************************************************************************************************/
+/**
+	operator delete()
+
+	The sized form, which C++14 calls in place of the above when the size is known
+*/
+/*************************************************************************************************/
+void operator delete( void* p, size_t ) noexcept
+{
+	free( p );
+}
+
+
+
+/*************************************************************************************************/
+/**
+	GetAllocationCount()
+*/
+/*************************************************************************************************/
+unsigned long long GetAllocationCount()
+{
+	return gAllocations;
+}
+
+
+
+/*************************************************************************************************/
+/**
+	GetAllocatedBytes()
+*/
+/*************************************************************************************************/
+unsigned long long GetAllocatedBytes()
+{
+	return gAllocatedBytes;
+}
@@ -1,28 +1,34 @@
-/*************************************************************************************************/
-/**
-	main.h
-
-
-	Copyright (C) Rich Talbot-Watkins 2007 - 2012
-
-	This file is part of BeebAsm.
-
-	BeebAsm is free software: you can redistribute it and/or modify it under the terms of the GNU
-	General Public License as published by the Free Software Foundation, either version 3 of the
-	License, or (at your option) any later version.
-
-	BeebAsm is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without
-	even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
-	GNU General Public License for more details.
-
-	You should have received a copy of the GNU General Public License along with BeebAsm, as
-	COPYING.txt.  If not, see <http://www.gnu.org/licenses/>.
-*/
-/*************************************************************************************************/
-
-#ifndef MAIN_H_
-#define MAIN_H_
-
-
-
-#endif // MAIN_H_
+/*************************************************************************************************/
+/**
+	allocations.h
+
+
+	Copyright (C) Rich Talbot-Watkins 2007 - 2012
+
+	This file is part of BeebAsm.
+
+	BeebAsm is free software: you can redistribute it and/or modify it under the terms of the GNU
+	General Public License as published by the Free Software Foundation, either version 3 of the
+	License, or (at your option) any later version.
+
+	BeebAsm is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without
+	even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License along with BeebAsm, as
+	COPYING.txt.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/*************************************************************************************************/
+
+#ifndef ALLOCATIONS_H_
+#define ALLOCATIONS_H_
+
+
+// The number and total size of the allocations made by the process so far, counted by replacing
+// the global operator new
+
+unsigned long long GetAllocationCount();
+unsigned long long GetAllocatedBytes();
+
+
+#endif // ALLOCATIONS_H_
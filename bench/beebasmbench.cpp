@@ -0,0 +1,395 @@
+/*************************************************************************************************/
+/**
+	beebasmbench.cpp
+
+	Measures how fast beebasm assembles a set of synthetic workloads, in-process through
+	libbeebasm, and writes the results as tab-separated values which can be compared between
+	versions
+
+
+	Copyright (C) Rich Talbot-Watkins 2007 - 2012
+
+	This file is part of BeebAsm.
+
+	BeebAsm is free software: you can redistribute it and/or modify it under the terms of the GNU
+	General Public License as published by the Free Software Foundation, either version 3 of the
+	License, or (at your option) any later version.
+
+	BeebAsm is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without
+	even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License along with BeebAsm, as
+	COPYING.txt.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/*************************************************************************************************/
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <set>
+#include <string>
+#include <vector>
+
+#ifndef _WIN32
+#include <sys/resource.h>
+#endif
+
+#include "allocations.h"
+#include "workloads.h"
+#include "libbeebasm.h"
+#include "objectcode.h"
+
+
+using namespace std;
+
+
+// The state of the process at the start of each pass, and at the end
+
+struct Mark
+{
+	int									m_pass;			// -1 at the end
+	chrono::steady_clock::time_point	m_time;
+	unsigned long long					m_allocations;
+	unsigned long long					m_allocatedBytes;
+	int									m_bytes;		// bytes assembled so far
+	long								m_peakRss;
+};
+
+
+// A row of the results
+
+struct Phase
+{
+	string								m_name;
+	double								m_seconds;
+	long long							m_lines;
+	long long							m_bytes;
+	unsigned long long					m_allocations;
+	unsigned long long					m_allocatedBytes;
+	long								m_peakRss;
+};
+
+
+
+/*************************************************************************************************/
+/**
+	GetPeakRss()
+
+	Returns the most memory the process has had resident so far, in kilobytes, or 0 if unknown
+*/
+/*************************************************************************************************/
+static long GetPeakRss()
+{
+#ifdef _WIN32
+	return 0;
+#else
+	rusage usage;
+
+	if ( getrusage( RUSAGE_SELF, &usage ) != 0 )
+	{
+		return 0;
+	}
+
+#ifdef __APPLE__
+	return usage.ru_maxrss / 1024;
+#else
+	return usage.ru_maxrss;
+#endif
+#endif
+}
+
+
+
+/*************************************************************************************************/
+/**
+	MakeMark()
+
+	Records the state of the process, for the start of a pass or the end of the assembly
+*/
+/*************************************************************************************************/
+static Mark MakeMark( int pass, int bytes )
+{
+	Mark mark;
+	mark.m_pass = pass;
+	mark.m_time = chrono::steady_clock::now();
+	mark.m_allocations = GetAllocationCount();
+	mark.m_allocatedBytes = GetAllocatedBytes();
+	mark.m_bytes = bytes;
+	mark.m_peakRss = GetPeakRss();
+	return mark;
+}
+
+
+
+/*************************************************************************************************/
+/**
+	Seconds()
+*/
+/*************************************************************************************************/
+static double Seconds( const Mark& start, const Mark& end )
+{
+	return chrono::duration< double >( end.m_time - start.m_time ).count();
+}
+
+
+
+/*************************************************************************************************/
+/**
+	RunWorkload()
+
+	Assembles a workload once, and works out a row of results for each pass and for the whole
+	assembly
+
+	@return		false if the assembly failed
+*/
+/*************************************************************************************************/
+static bool RunWorkload( const Workload& workload, vector< Phase >& phases )
+{
+	vector< Mark > marks;
+	marks.reserve( 16 );
+
+	BeebAsmOptions options;
+	options.m_arguments = workload.m_arguments;
+	options.m_passObserver = [ &marks ]( int pass )
+	{
+		marks.push_back( MakeMark( pass, ObjectCode::Instance().GetBytesAssembled() ) );
+	};
+
+	Mark start = MakeMark( 0, 0 );
+	BeebAsmResult result = AssembleInMemory( WORKLOAD_SOURCE, workload.m_files, options );
+	Mark end = MakeMark( -1, 0 );
+
+	if ( !result.m_bSucceeded )
+	{
+		cerr << workload.m_name << " failed to assemble:" << endl << result.m_diagnostics;
+		return false;
+	}
+
+	phases.clear();
+
+	Phase total;
+	total.m_name = "total";
+	total.m_seconds = Seconds( start, end );
+	total.m_lines = 0;
+	total.m_bytes = 0;
+	total.m_allocations = end.m_allocations - start.m_allocations;
+	total.m_allocatedBytes = end.m_allocatedBytes - start.m_allocatedBytes;
+	total.m_peakRss = end.m_peakRss;
+
+	for ( size_t i = 0; i + 1 < marks.size(); i++ )
+	{
+		Phase phase;
+		phase.m_name = "pass" + to_string( marks[ i ].m_pass + 1 );
+		phase.m_seconds = Seconds( marks[ i ], marks[ i + 1 ] );
+		phase.m_lines = workload.m_lines;
+		phase.m_bytes = marks[ i + 1 ].m_bytes - marks[ i ].m_bytes;
+		phase.m_allocations = marks[ i + 1 ].m_allocations - marks[ i ].m_allocations;
+		phase.m_allocatedBytes = marks[ i + 1 ].m_allocatedBytes - marks[ i ].m_allocatedBytes;
+		phase.m_peakRss = marks[ i + 1 ].m_peakRss;
+		phases.push_back( phase );
+
+		total.m_lines += phase.m_lines;
+		total.m_bytes += phase.m_bytes;
+	}
+
+	// The total also counts the files written, e.g. by PUTBASIC onto the disc image
+
+	for ( map< string, string >::const_iterator it = result.m_savedFiles.begin(); it != result.m_savedFiles.end(); ++it )
+	{
+		total.m_bytes += static_cast< long long >( it->second.size() );
+	}
+
+	phases.push_back( total );
+	return true;
+}
+
+
+
+/*************************************************************************************************/
+/**
+	WriteResults()
+
+	Writes the rows of results for a workload
+*/
+/*************************************************************************************************/
+static void WriteResults( ostream& out, const Workload& workload, const vector< Phase >& phases )
+{
+	for ( vector< Phase >::const_iterator it = phases.begin(); it != phases.end(); ++it )
+	{
+		double seconds = max( it->m_seconds, 1e-9 );
+
+		out << workload.m_name << '\t'
+			<< it->m_name << '\t'
+			<< fixed << setprecision( 6 ) << it->m_seconds << '\t'
+			<< it->m_lines << '\t'
+			<< static_cast< long long >( it->m_lines / seconds ) << '\t'
+			<< it->m_bytes << '\t'
+			<< static_cast< long long >( it->m_bytes / seconds ) << '\t'
+			<< it->m_allocations << '\t'
+			<< it->m_allocatedBytes << '\t'
+			<< it->m_peakRss << endl;
+	}
+}
+
+
+
+/*************************************************************************************************/
+/**
+	ShowHelp()
+*/
+/*************************************************************************************************/
+static void ShowHelp( const vector< Workload >& workloads )
+{
+	cout << "beebasm-bench [options]" << endl << endl;
+	cout << "Assembles each workload in-process, and writes the time, lines and bytes per second," << endl;
+	cout << "allocations and peak resident memory of each pass as tab-separated values." << endl << endl;
+	cout << " -w <name>      Run only this workload (may be given more than once)" << endl;
+	cout << " -scale <n>     Multiply the size of each workload by <n> (default 1)" << endl;
+	cout << " -n <count>     Assemble each workload <count> times and report the fastest (default 3)" << endl;
+	cout << " -o <file>      Write the results to <file> instead of stdout" << endl;
+	cout << " -list          List the workloads" << endl;
+	cout << " --help         See this help again" << endl << endl;
+	cout << "Workloads:" << endl;
+
+	for ( vector< Workload >::const_iterator it = workloads.begin(); it != workloads.end(); ++it )
+	{
+		cout << " " << left << setw( 15 ) << it->m_name << it->m_description << endl;
+	}
+}
+
+
+
+/*************************************************************************************************/
+/**
+	main()
+*/
+/*************************************************************************************************/
+int main( int argc, char* argv[] )
+{
+	double scale = 1.0;
+	int repeats = 3;
+	const char* pOutputFile = NULL;
+	set< string > selected;
+	bool bList = false;
+
+	for ( int i = 1; i < argc; i++ )
+	{
+		bool bHasValue = ( i + 1 < argc );
+
+		if ( strcmp( argv[ i ], "-w" ) == 0 && bHasValue )
+		{
+			selected.insert( argv[ ++i ] );
+		}
+		else if ( strcmp( argv[ i ], "-scale" ) == 0 && bHasValue )
+		{
+			scale = atof( argv[ ++i ] );
+		}
+		else if ( strcmp( argv[ i ], "-n" ) == 0 && bHasValue )
+		{
+			repeats = atoi( argv[ ++i ] );
+		}
+		else if ( strcmp( argv[ i ], "-o" ) == 0 && bHasValue )
+		{
+			pOutputFile = argv[ ++i ];
+		}
+		else if ( strcmp( argv[ i ], "-list" ) == 0 || strcmp( argv[ i ], "--help" ) == 0 || strcmp( argv[ i ], "-h" ) == 0 )
+		{
+			bList = true;
+		}
+		else
+		{
+			cerr << "Bad option: " << argv[ i ] << " (beebasm-bench --help for options)" << endl;
+			return EXIT_FAILURE;
+		}
+	}
+
+	if ( scale <= 0.0 || repeats < 1 )
+	{
+		cerr << "-scale and -n must be positive" << endl;
+		return EXIT_FAILURE;
+	}
+
+	vector< Workload > workloads;
+	MakeWorkloads( scale, workloads );
+
+	if ( bList )
+	{
+		ShowHelp( workloads );
+		return EXIT_SUCCESS;
+	}
+
+	for ( set< string >::const_iterator it = selected.begin(); it != selected.end(); ++it )
+	{
+		bool bFound = false;
+
+		for ( size_t i = 0; i < workloads.size(); i++ )
+		{
+			bFound = bFound || ( workloads[ i ].m_name == *it );
+		}
+
+		if ( !bFound )
+		{
+			cerr << "No such workload: " << *it << endl;
+			return EXIT_FAILURE;
+		}
+	}
+
+	ofstream outputFile;
+
+	if ( pOutputFile != NULL )
+	{
+		outputFile.open( pOutputFile );
+
+		if ( !outputFile )
+		{
+			cerr << "Unable to open " << pOutputFile << endl;
+			return EXIT_FAILURE;
+		}
+	}
+
+	ostream& out = ( pOutputFile != NULL ) ? outputFile : cout;
+
+	out << "# beebasm-bench -scale " << scale << " -n " << repeats << endl;
+	out << "workload\tphase\tseconds\tlines\tlines_per_second\tbytes\tbytes_per_second\t"
+		<< "allocations\tallocated_bytes\tpeak_rss_kb" << endl;
+
+	for ( vector< Workload >::const_iterator it = workloads.begin(); it != workloads.end(); ++it )
+	{
+		if ( !selected.empty() && selected.count( it->m_name ) == 0 )
+		{
+			continue;
+		}
+
+		// Report the fastest time for each phase, and the counts from the last run, as the first
+		// run also fills the process-wide caches (e.g. of symbol names)
+
+		vector< Phase > results;
+
+		for ( int run = 0; run < repeats; run++ )
+		{
+			vector< Phase > phases;
+
+			if ( !RunWorkload( *it, phases ) )
+			{
+				return EXIT_FAILURE;
+			}
+
+			for ( size_t i = 0; i < phases.size() && i < results.size(); i++ )
+			{
+				phases[ i ].m_seconds = min( phases[ i ].m_seconds, results[ i ].m_seconds );
+			}
+
+			results = phases;
+		}
+
+		WriteResults( out, *it, results );
+	}
+
+	return EXIT_SUCCESS;
+}
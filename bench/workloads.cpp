@@ -0,0 +1,402 @@
+/*************************************************************************************************/
+/**
+	workloads.cpp
+
+	Generates the synthetic programs beebasm-bench assembles
+
+
+	Copyright (C) Rich Talbot-Watkins 2007 - 2012
+
+	This file is part of BeebAsm.
+
+	BeebAsm is free software: you can redistribute it and/or modify it under the terms of the GNU
+	General Public License as published by the Free Software Foundation, either version 3 of the
+	License, or (at your option) any later version.
+
+	BeebAsm is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without
+	even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License along with BeebAsm, as
+	COPYING.txt.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/*************************************************************************************************/
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <sstream>
+
+#include "workloads.h"
+
+
+using namespace std;
+
+
+// Where the generated code goes, leaving room for the workloads which fill memory
+
+#define CODE_START			0x1100
+#define CODE_END			0xF000
+
+
+
+/*************************************************************************************************/
+/**
+	Scaled()
+
+	Multiplies a size by the scale, keeping it within limits
+*/
+/*************************************************************************************************/
+static int Scaled( int size, double scale, int minimum, int maximum )
+{
+	double scaled = floor( size * scale + 0.5 );
+
+	return static_cast< int >( max( static_cast< double >( minimum ), min( static_cast< double >( maximum ), scaled ) ) );
+}
+
+
+
+/*************************************************************************************************/
+/**
+	NextRandom()
+
+	A small generator of pseudo-random bytes, so that the data is the same on every platform
+*/
+/*************************************************************************************************/
+static unsigned char NextRandom( unsigned int& state )
+{
+	state = state * 1103515245u + 12345u;
+	return static_cast< unsigned char >( state >> 16 );
+}
+
+
+
+/*************************************************************************************************/
+/**
+	CountLines()
+
+	Counts the lines in the source files and BASIC listings of a workload
+*/
+/*************************************************************************************************/
+static void CountLines( Workload& workload )
+{
+	workload.m_lines = 0;
+
+	for ( map< string, string >::const_iterator it = workload.m_files.begin(); it != workload.m_files.end(); ++it )
+	{
+		const string& name = it->first;
+
+		if ( name.find( ".6502" ) != string::npos || name.find( ".bas" ) != string::npos )
+		{
+			workload.m_lines += static_cast< int >( count( it->second.begin(), it->second.end(), '\n' ) );
+		}
+	}
+}
+
+
+
+/*************************************************************************************************/
+/**
+	MakeForNest()
+
+	FOR loops nested six deep, assigning a symbol in the innermost loop, and emitting a byte in
+	as deep a loop as memory allows
+*/
+/*************************************************************************************************/
+static Workload MakeForNest( double scale )
+{
+	const int depth = 6;
+	const int iterations = max( 2, static_cast< int >( floor( pow( 200000.0 * scale, 1.0 / depth ) + 0.5 ) ) );
+
+	// Emit a byte in the deepest loop whose iterations fit into memory
+
+	int emitLevel = 0;
+	double emitted = iterations;
+
+	while ( emitLevel + 1 < depth && emitted * iterations <= CODE_END - CODE_START )
+	{
+		emitted *= iterations;
+		emitLevel++;
+	}
+
+	ostringstream source;
+	source << "ORG &" << hex << uppercase << CODE_START << dec << "\n";
+	source << ".start\n";
+
+	for ( int level = 0; level < depth; level++ )
+	{
+		source << string( level, '\t' ) << "FOR l" << level << ", 0, " << iterations - 1 << "\n";
+
+		if ( level == emitLevel )
+		{
+			source << string( level + 1, '\t' ) << "EQUB ( l0";
+			for ( int i = 1; i <= level; i++ )
+			{
+				source << " + l" << i;
+			}
+			source << " ) AND &FF\n";
+		}
+	}
+
+	source << string( depth, '\t' ) << "t = ( l0 * l1 + l2 ) EOR ( l3 - l4 + l5 )\n";
+
+	for ( int level = depth - 1; level >= 0; level-- )
+	{
+		source << string( level, '\t' ) << "NEXT\n";
+	}
+
+	source << ".end\n";
+
+	Workload workload;
+	workload.m_name = "for-nest";
+	workload.m_description = "FOR loops nested six deep";
+	workload.m_files[ WORKLOAD_SOURCE ] = source.str();
+	CountLines( workload );
+	return workload;
+}
+
+
+
+/*************************************************************************************************/
+/**
+	MakeMacros()
+
+	Straight-line code made of macro invocations, each of which invokes another macro twice
+*/
+/*************************************************************************************************/
+static Workload MakeMacros( double scale )
+{
+	// Each invocation assembles 26 bytes
+	const int invocations = Scaled( 2000, scale, 10, ( CODE_END - CODE_START ) / 26 );
+
+	ostringstream source;
+	source << "ORG &70\n";
+	source << ".ptr SKIP 2\n";
+	source << "ORG &" << hex << uppercase << CODE_START << dec << "\n";
+	source << "MACRO ADD16 addr, value\n";
+	source << "\tCLC\n";
+	source << "\tLDA addr\n";
+	source << "\tADC #LO(value)\n";
+	source << "\tSTA addr\n";
+	source << "\tLDA addr + 1\n";
+	source << "\tADC #HI(value)\n";
+	source << "\tSTA addr + 1\n";
+	source << "ENDMACRO\n";
+	source << "MACRO ADD16TWICE addr, value\n";
+	source << "\tADD16 addr, value\n";
+	source << "\tADD16 addr, value * 2\n";
+	source << "ENDMACRO\n";
+	source << ".start\n";
+
+	for ( int i = 0; i < invocations; i++ )
+	{
+		source << "\tADD16TWICE ptr, " << i * 7 << "\n";
+	}
+
+	source << ".end\n";
+
+	Workload workload;
+	workload.m_name = "macros";
+	workload.m_description = "Nested macro invocations";
+	workload.m_files[ WORKLOAD_SOURCE ] = source.str();
+	CountLines( workload );
+	return workload;
+}
+
+
+
+/*************************************************************************************************/
+/**
+	MakeSymbols()
+
+	A hundred thousand symbols: a chain of assignments, each referring to the one before, and
+	then code labels which refer to the assignments and jump forward to the next label
+*/
+/*************************************************************************************************/
+static Workload MakeSymbols( double scale )
+{
+	const int assignments = Scaled( 90000, scale, 10, 10000000 );
+
+	// Each label assembles 5 bytes
+	const int labels = Scaled( 10000, scale, 10, ( CODE_END - CODE_START ) / 5 - 1 );
+
+	ostringstream source;
+	source << "sym0 = 1\n";
+
+	for ( int i = 1; i < assignments; i++ )
+	{
+		source << "sym" << i << " = sym" << i - 1 << " + 3\n";
+	}
+
+	source << "ORG &" << hex << uppercase << CODE_START << dec << "\n";
+
+	for ( int i = 0; i < labels; i++ )
+	{
+		source << ".label" << i << "\n";
+		source << "\tLDA #LO(sym" << ( i * 9 ) % assignments << ")\n";
+		source << "\tJMP label" << i + 1 << "\n";
+	}
+
+	source << ".label" << labels << "\n";
+	source << "\tRTS\n";
+
+	Workload workload;
+	workload.m_name = "symbols";
+	workload.m_description = "A hundred thousand symbols and labels";
+	workload.m_files[ WORKLOAD_SOURCE ] = source.str();
+	CountLines( workload );
+	return workload;
+}
+
+
+
+/*************************************************************************************************/
+/**
+	MakeIncbin()
+
+	A binary file filling most of memory, included repeatedly with CLEAR in between
+*/
+/*************************************************************************************************/
+static Workload MakeIncbin( double scale )
+{
+	const int size = Scaled( 0xD000, scale, 256, 0xD000 );
+	const int copies = Scaled( 8, scale, 1, 100000 );
+
+	string data( static_cast< size_t >( size ), '\0' );
+	unsigned int state = 1;
+
+	for ( int i = 0; i < size; i++ )
+	{
+		data[ i ] = static_cast< char >( NextRandom( state ) );
+	}
+
+	ostringstream source;
+	source << "FOR copy, 1, " << copies << "\n";
+	source << "\tCLEAR &" << hex << uppercase << CODE_START << ", &" << CODE_END << "\n";
+	source << "\tORG &" << CODE_START << dec << "\n";
+	source << "\tINCBIN \"data.bin\"\n";
+	source << "NEXT\n";
+
+	Workload workload;
+	workload.m_name = "incbin";
+	workload.m_description = "Large binary includes";
+	workload.m_files[ WORKLOAD_SOURCE ] = source.str();
+	workload.m_files[ "data.bin" ] = data;
+	CountLines( workload );
+	return workload;
+}
+
+
+
+/*************************************************************************************************/
+/**
+	MakeEqubData()
+
+	Data files of EQUB lines, each filling most of memory, included one after another with CLEAR
+	in between
+*/
+/*************************************************************************************************/
+static Workload MakeEqubData( double scale )
+{
+	// Each line assembles 16 bytes
+	const int linesPerFile = ( CODE_END - CODE_START ) / 16;
+	const int lines = Scaled( 6000, scale, 10, 100000000 );
+
+	Workload workload;
+	workload.m_name = "equb-data";
+	workload.m_description = "Long files of EQUB data";
+
+	ostringstream source;
+	unsigned int state = 2;
+
+	for ( int file = 0; file * linesPerFile < lines; file++ )
+	{
+		ostringstream name;
+		name << "data" << file << ".6502";
+
+		ostringstream data;
+		data << hex << uppercase << setfill( '0' );
+
+		for ( int line = file * linesPerFile; line < min( lines, ( file + 1 ) * linesPerFile ); line++ )
+		{
+			data << "EQUB ";
+			for ( int i = 0; i < 16; i++ )
+			{
+				data << ( i > 0 ? ", &" : "&" ) << setw( 2 ) << static_cast< int >( NextRandom( state ) );
+			}
+			data << "\n";
+		}
+
+		workload.m_files[ name.str() ] = data.str();
+
+		source << "CLEAR &" << hex << uppercase << CODE_START << ", &" << CODE_END << "\n";
+		source << "ORG &" << CODE_START << dec << "\n";
+		source << "INCLUDE \"" << name.str() << "\"\n";
+	}
+
+	workload.m_files[ WORKLOAD_SOURCE ] = source.str();
+	CountLines( workload );
+	return workload;
+}
+
+
+
+/*************************************************************************************************/
+/**
+	MakePutBasic()
+
+	A long BASIC listing, without line numbers, tokenised onto a disc image
+*/
+/*************************************************************************************************/
+static Workload MakePutBasic( double scale )
+{
+	// Small enough for the tokenised program to fit on the disc
+	const int lines = Scaled( 3000, scale, 10, 6000 );
+
+	ostringstream listing;
+
+	for ( int i = 0; i < lines; i++ )
+	{
+		switch ( i % 4 )
+		{
+			case 0:		listing << "REM Section " << i / 4 << "\n";										break;
+			case 1:		listing << "FOR I%=1 TO " << i << ":A%=A%+I%*" << i % 13 << ":NEXT\n";			break;
+			case 2:		listing << "IF A%>" << i * 3 << " THEN PRINT \"Overflow at \";A%:A%=0\n";		break;
+			default:	listing << "PROCdraw(" << i % 40 << "," << i % 25 << ",A% AND 7)\n";				break;
+		}
+	}
+
+	listing << "END\n";
+	listing << "DEF PROCdraw(X%,Y%,C%)\n";
+	listing << "PRINT TAB(X%,Y%);CHR$(128+C%);\n";
+	listing << "ENDPROC\n";
+
+	Workload workload;
+	workload.m_name = "putbasic";
+	workload.m_description = "A long BASIC listing";
+	workload.m_files[ WORKLOAD_SOURCE ] = "PUTBASIC \"listing.bas\", \"LISTING\"\n";
+	workload.m_files[ "listing.bas" ] = listing.str();
+	workload.m_arguments.push_back( "-do" );
+	workload.m_arguments.push_back( "bench.ssd" );
+	CountLines( workload );
+	return workload;
+}
+
+
+
+/*************************************************************************************************/
+/**
+	MakeWorkloads()
+
+	Generates every workload, with its size multiplied by scale
+*/
+/*************************************************************************************************/
+void MakeWorkloads( double scale, vector< Workload >& workloads )
+{
+	workloads.push_back( MakeForNest( scale ) );
+	workloads.push_back( MakeMacros( scale ) );
+	workloads.push_back( MakeSymbols( scale ) );
+	workloads.push_back( MakeIncbin( scale ) );
+	workloads.push_back( MakeEqubData( scale ) );
+	workloads.push_back( MakePutBasic( scale ) );
+}
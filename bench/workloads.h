@@ -0,0 +1,60 @@
+/*************************************************************************************************/
+/**
+	workloads.h
+
+
+	Copyright (C) Rich Talbot-Watkins 2007 - 2012
+
+	This file is part of BeebAsm.
+
+	BeebAsm is free software: you can redistribute it and/or modify it under the terms of the GNU
+	General Public License as published by the Free Software Foundation, either version 3 of the
+	License, or (at your option) any later version.
+
+	BeebAsm is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without
+	even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License along with BeebAsm, as
+	COPYING.txt.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/*************************************************************************************************/
+
+#ifndef WORKLOADS_H_
+#define WORKLOADS_H_
+
+#include <map>
+#include <string>
+#include <vector>
+
+
+// The file each workload assembles
+
+#define WORKLOAD_SOURCE		"main.6502"
+
+
+// A generated program, and everything it reads
+
+struct Workload
+{
+	std::string							m_name;
+	std::string							m_description;
+
+	// WORKLOAD_SOURCE, and the other files it reads
+	std::map<std::string, std::string>	m_files;
+
+	// Command line options, other than -i
+	std::vector<std::string>			m_arguments;
+
+	// Lines of text in the source files and BASIC listings, which each pass works through
+	int									m_lines;
+};
+
+
+// Generates every workload, with its size multiplied by scale.  The same scale always gives the
+// same programs, so that results can be compared between versions.
+
+void MakeWorkloads( double scale, std::vector<Workload>& workloads );
+
+
+#endif // WORKLOADS_H_
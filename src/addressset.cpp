@@ -0,0 +1,272 @@
+/*************************************************************************************************/
+/**
+	addressset.cpp
+
+
+	Copyright (C) Rich Talbot-Watkins 2007 - 2012
+
+	This file is part of BeebAsm.
+
+	BeebAsm is free software: you can redistribute it and/or modify it under the terms of the GNU
+	General Public License as published by the Free Software Foundation, either version 3 of the
+	License, or (at your option) any later version.
+
+	BeebAsm is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without
+	even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License along with BeebAsm, as
+	COPYING.txt.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/*************************************************************************************************/
+
+#include <algorithm>
+
+#include "addressset.h"
+
+
+using namespace std;
+
+
+/*************************************************************************************************/
+/**
+	AddressSet::AddressSet()
+
+	Constructs an empty set of addresses in the range [0, size)
+*/
+/*************************************************************************************************/
+AddressSet::AddressSet( int size )
+	:	m_size( size ),
+		m_words( ( size + 63 ) / 64, 0 )
+{
+}
+
+
+
+/*************************************************************************************************/
+/**
+	AddressSet::RangeMask()
+
+	Returns the bits of the given word which lie in the range [start, end)
+*/
+/*************************************************************************************************/
+uint64_t AddressSet::RangeMask( int word, int start, int end )
+{
+	int first = max( start - word * 64, 0 );
+	int last = min( end - word * 64, 64 );
+
+	uint64_t mask = ( last == 64 ) ? ~static_cast<uint64_t>( 0 ) : ( Bit( last ) - 1 );
+	return mask & ~( Bit( first ) - 1 );
+}
+
+
+
+/*************************************************************************************************/
+/**
+	AddressSet::LowestBit()
+
+	Returns the index of the lowest set bit of a non-zero word
+*/
+/*************************************************************************************************/
+int AddressSet::LowestBit( uint64_t word )
+{
+	assert( word != 0 );
+
+	int bit = 0;
+	while ( ( word & 0xFF ) == 0 )
+	{
+		word >>= 8;
+		bit += 8;
+	}
+	while ( ( word & 1 ) == 0 )
+	{
+		word >>= 1;
+		bit++;
+	}
+	return bit;
+}
+
+
+
+/*************************************************************************************************/
+/**
+	AddressSet::SetRange()
+*/
+/*************************************************************************************************/
+void AddressSet::SetRange( int start, int end )
+{
+	assert( start >= 0 && start <= end && end <= m_size );
+
+	for ( int word = start >> 6; word * 64 < end; word++ )
+	{
+		m_words[ word ] |= RangeMask( word, start, end );
+	}
+}
+
+
+
+/*************************************************************************************************/
+/**
+	AddressSet::ResetRange()
+*/
+/*************************************************************************************************/
+void AddressSet::ResetRange( int start, int end )
+{
+	assert( start >= 0 && start <= end && end <= m_size );
+
+	for ( int word = start >> 6; word * 64 < end; word++ )
+	{
+		m_words[ word ] &= ~RangeMask( word, start, end );
+	}
+}
+
+
+
+/*************************************************************************************************/
+/**
+	AddressSet::AnyInRange()
+*/
+/*************************************************************************************************/
+bool AddressSet::AnyInRange( int start, int end ) const
+{
+	return FindFirst( start, end ) != end;
+}
+
+
+
+/*************************************************************************************************/
+/**
+	AddressSet::FindFirst()
+
+	Returns the lowest address in [start, end) which is in the set, or end if there is none
+*/
+/*************************************************************************************************/
+int AddressSet::FindFirst( int start, int end ) const
+{
+	assert( start >= 0 && start <= end && end <= m_size );
+
+	for ( int word = start >> 6; word * 64 < end; word++ )
+	{
+		uint64_t bits = m_words[ word ] & RangeMask( word, start, end );
+		if ( bits != 0 )
+		{
+			return word * 64 + LowestBit( bits );
+		}
+	}
+
+	return end;
+}
+
+
+
+/*************************************************************************************************/
+/**
+	AddressSet::Any()
+*/
+/*************************************************************************************************/
+bool AddressSet::Any() const
+{
+	for ( Bits::const_iterator it = m_words.begin(); it != m_words.end(); ++it )
+	{
+		if ( *it != 0 )
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
+
+
+/*************************************************************************************************/
+/**
+	AddressSet::GetBits()
+
+	Returns up to 64 bits starting at any address, in the low bits of the result
+*/
+/*************************************************************************************************/
+uint64_t AddressSet::GetBits( int addr, int count ) const
+{
+	assert( count > 0 && count <= 64 );
+
+	int word = addr >> 6;
+	int shift = addr & 63;
+
+	uint64_t bits = m_words[ word ] >> shift;
+	if ( shift != 0 && shift + count > 64 )
+	{
+		bits |= m_words[ word + 1 ] << ( 64 - shift );
+	}
+
+	return ( count == 64 ) ? bits : ( bits & ( Bit( count ) - 1 ) );
+}
+
+
+
+/*************************************************************************************************/
+/**
+	AddressSet::SetBits()
+
+	Replaces up to 64 bits starting at any address with the low bits of the supplied value
+*/
+/*************************************************************************************************/
+void AddressSet::SetBits( int addr, int count, uint64_t bits )
+{
+	assert( count > 0 && count <= 64 );
+
+	int word = addr >> 6;
+	int shift = addr & 63;
+
+	uint64_t mask = ( count == 64 ) ? ~static_cast<uint64_t>( 0 ) : ( Bit( count ) - 1 );
+	bits &= mask;
+
+	m_words[ word ] = ( m_words[ word ] & ~( mask << shift ) ) | ( bits << shift );
+	if ( shift != 0 && shift + count > 64 )
+	{
+		m_words[ word + 1 ] = ( m_words[ word + 1 ] & ~( mask >> ( 64 - shift ) ) ) | ( bits >> ( 64 - shift ) );
+	}
+}
+
+
+
+/*************************************************************************************************/
+/**
+	AddressSet::GetRange()
+
+	Copies the membership of the addresses [start, start + length) out of the set, packed from
+	bit 0 of the first word of bits
+*/
+/*************************************************************************************************/
+void AddressSet::GetRange( int start, int length, Bits& bits ) const
+{
+	assert( start >= 0 && length >= 0 && start + length <= m_size );
+
+	bits.assign( ( length + 63 ) / 64, 0 );
+
+	for ( int i = 0; i < length; i += 64 )
+	{
+		bits[ i >> 6 ] = GetBits( start + i, min( length - i, 64 ) );
+	}
+}
+
+
+
+/*************************************************************************************************/
+/**
+	AddressSet::PutRange()
+
+	Replaces the membership of the addresses [start, start + length) with bits previously
+	obtained from GetRange()
+*/
+/*************************************************************************************************/
+void AddressSet::PutRange( int start, int length, const Bits& bits )
+{
+	assert( start >= 0 && length >= 0 && start + length <= m_size );
+	assert( bits.size() * 64 >= static_cast<size_t>( length ) );
+
+	for ( int i = 0; i < length; i += 64 )
+	{
+		SetBits( start + i, min( length - i, 64 ), bits[ i >> 6 ] );
+	}
+}
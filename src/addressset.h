@@ -0,0 +1,79 @@
+/*************************************************************************************************/
+/**
+	addressset.h
+
+
+	Copyright (C) Rich Talbot-Watkins 2007 - 2012
+
+	This file is part of BeebAsm.
+
+	BeebAsm is free software: you can redistribute it and/or modify it under the terms of the GNU
+	General Public License as published by the Free Software Foundation, either version 3 of the
+	License, or (at your option) any later version.
+
+	BeebAsm is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without
+	even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License along with BeebAsm, as
+	COPYING.txt.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/*************************************************************************************************/
+
+#ifndef ADDRESSSET_H_
+#define ADDRESSSET_H_
+
+#include <cassert>
+#include <cstdint>
+#include <vector>
+
+
+/*************************************************************************************************/
+/**
+	AddressSet
+
+	A set of addresses in the memory image, stored as packed bits so that operations over a range
+	of addresses work on 64 addresses at a time.
+*/
+/*************************************************************************************************/
+class AddressSet
+{
+public:
+
+	typedef std::vector<std::uint64_t> Bits;
+
+	explicit AddressSet( int size );
+
+	inline bool	Test( int addr ) const	{ assert( addr >= 0 && addr < m_size ); return ( m_words[ addr >> 6 ] & Bit( addr ) ) != 0; }
+	inline void	Set( int addr )			{ assert( addr >= 0 && addr < m_size ); m_words[ addr >> 6 ] |= Bit( addr ); }
+
+	// Ranges are half-open, i.e. [start, end)
+
+	void		SetRange( int start, int end );
+	void		ResetRange( int start, int end );
+	bool		AnyInRange( int start, int end ) const;
+	int			FindFirst( int start, int end ) const;
+	bool		Any() const;
+
+	void		GetRange( int start, int length, Bits& bits ) const;
+	void		PutRange( int start, int length, const Bits& bits );
+
+	inline int	GetSize() const			{ return m_size; }
+
+
+private:
+
+	static inline std::uint64_t Bit( int addr ) { return static_cast<std::uint64_t>( 1 ) << ( addr & 63 ); }
+
+	static std::uint64_t	RangeMask( int word, int start, int end );
+	static int				LowestBit( std::uint64_t word );
+
+	std::uint64_t	GetBits( int addr, int count ) const;
+	void			SetBits( int addr, int count, std::uint64_t bits );
+
+	int				m_size;
+	Bits			m_words;
+};
+
+
+#endif // ADDRESSSET_H_
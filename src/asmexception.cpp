@@ -37,12 +37,27 @@ using namespace std;
 /**
 	AsmException_FileAccessError::Print()
 
-	Outputs to stderr an error message relating to an I/O exception
+	Outputs to the error stream an error message relating to an I/O exception
 */
 /*************************************************************************************************/
 void AsmException_FileError::Print() const
 {
-	cerr << "Error: " << m_filename << ": " << Message() << endl;
+	GlobalData::Instance().GetErrorStream() << "Error: " << m_filename << ": " << Message() << endl;
+}
+
+
+
+/*************************************************************************************************/
+/**
+	AsmException_LayoutNotSettled::Print()
+
+	Outputs to the error stream an error message naming a symbol which kept changing between passes
+*/
+/*************************************************************************************************/
+void AsmException_LayoutNotSettled::Print() const
+{
+	GlobalData::Instance().GetErrorStream() << "Error: " << m_filename << ": Layout did not settle after " << m_passes
+		 << " passes; the value of '" << m_symbol << "' keeps changing." << endl;
 }
 
 
@@ -51,7 +66,7 @@ void AsmException_FileError::Print() const
 /**
 	AsmException_SyntaxError::Print()
 
-	Outputs to stderr an error message regarding a syntax error
+	Outputs to the error stream an error message regarding a syntax error
 */
 /*************************************************************************************************/
 void AsmException_SyntaxError::Print() const
@@ -60,19 +75,21 @@ void AsmException_SyntaxError::Print() const
 	assert( !m_lineNumber.empty() );
 	assert( m_filename.size() == m_lineNumber.size() ) ;
 
-	cerr << ErrorLocation(0);
-	cerr << ": error: ";
-	cerr << Message() << m_extra << endl << endl;
-	cerr << m_line << endl;
-	cerr << string( m_column, ' ' ) << "^" << endl;
+	ostream& err = GlobalData::Instance().GetErrorStream();
+
+	err << ErrorLocation(0);
+	err << ": error: ";
+	err << Message() << m_extra << endl << endl;
+	err << m_line << endl;
+	err << string( m_column, ' ' ) << "^" << endl;
 
 	if ( m_filename.size() > 1 )
 	{
-		cerr << endl;
-		cerr << "Call stack:" << endl;
+		err << endl;
+		err << "Call stack:" << endl;
 		for (size_t i = 1; i < m_filename.size(); i++)
 		{
-			cerr << ErrorLocation(i) << endl;
+			err << ErrorLocation(i) << endl;
 		}
 	}
 }
@@ -232,6 +232,10 @@ DEFINE_SYNTAX_EXCEPTION( EndMacroUnexpected, "ENDMACRO encountered without a mat
 DEFINE_SYNTAX_EXCEPTION( NoEndMacro, "Unterminated macro (ENDMACRO not found)." );
 DEFINE_SYNTAX_EXCEPTION( DuplicateMacroName, "Macro name already defined." );
 DEFINE_SYNTAX_EXCEPTION( AssertionFailed, "Assertion failed." );
+DEFINE_SYNTAX_EXCEPTION( BranchCrossesPage, "Branch crosses a page boundary inside NOPAGECROSS." );
+DEFINE_SYNTAX_EXCEPTION( TableCrossesPage, "Indexed access to a table which spans a page boundary inside NOPAGECROSS." );
+DEFINE_SYNTAX_EXCEPTION( EndNoPageCrossUnexpected, "ENDNOPAGECROSS encountered without a matching NOPAGECROSS directive." );
+DEFINE_SYNTAX_EXCEPTION( NoEndNoPageCross, "Unterminated NOPAGECROSS block (ENDNOPAGECROSS not found)." );
 
 // meta-language parsing exceptions
 DEFINE_SYNTAX_EXCEPTION( NextWithoutFor, "NEXT without FOR." );
@@ -329,4 +333,37 @@ protected:
 
 
 
+
+/*************************************************************************************************/
+/**
+	@class		AsmException_LayoutNotSettled
+
+	Exception class used when repeating the first pass with -relax doesn't reach a stable layout
+*/
+/*************************************************************************************************/
+class AsmException_LayoutNotSettled : public AsmException
+{
+public:
+
+	AsmException_LayoutNotSettled( const std::string& filename, const std::string& symbol, int passes )
+		:	m_filename( filename ),
+			m_symbol( symbol ),
+			m_passes( passes )
+	{
+	}
+
+	virtual ~AsmException_LayoutNotSettled() {}
+
+	virtual void Print() const;
+
+
+protected:
+
+	std::string		m_filename;
+	std::string		m_symbol;
+	int				m_passes;
+};
+
+
+
 #endif // ASMEXCEPTION_H_
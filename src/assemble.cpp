@@ -22,6 +22,7 @@
 */
 /*************************************************************************************************/
 
+#include <algorithm>
 #include <iostream>
 #include <iomanip>
 #include <cstring>
@@ -33,91 +34,171 @@
 #include "asmexception.h"
 #include "sourcecode.h"
 #include "stringutils.h"
+#include "keywordtrie.h"
 
 
 using namespace std;
 
 
 
-#define DATA( cpu, op, imp, acc, imm, zp, zpx, zpy, abs, absx, absy, ind, indx, indy, ind16, ind16x, rel )  \
-	{ { imp, acc, imm, zp, zpx, zpy, abs, absx, absy, ind, indx, indy, ind16, ind16x, rel }, op, sizeof(op)-1, cpu }
+#define DATA( cpu, op, imp, acc, imm, zp, zpx, zpy, abs, absx, absy, ind, indx, indy, ind16, ind16x, rel, cycles )  \
+	{ { imp, acc, imm, zp, zpx, zpy, abs, absx, absy, ind, indx, indy, ind16, ind16x, rel }, op, sizeof(op)-1, cpu, cycles }
+
+#define CYCLES( imp, acc, imm, zp, zpx, zpy, abs, absx, absy, ind, indx, indy, ind16, ind16x, rel )  \
+	{ imp, acc, imm, zp, zpx, zpy, abs, absx, absy, ind, indx, indy, ind16, ind16x, rel }
+
+// The cycles are the 6502's, and for a branch, when it isn't taken (BRA is always taken); the
+// flags say where the 65C02 differs, or where crossing a page costs another cycle
 
 #define X -1
+#define P CYCLES_PAGE_CROSSED
+#define M CYCLES_65C02_MORE
+#define F CYCLES_65C02_FEWER
 
 const LineParser::OpcodeData	LineParser::m_gaOpcodeTable[] =
 {
 //					IMP		ACC		IMM		ZP		ZPX		ZPY		ABS		ABSX	ABSY	IND		INDX	INDY	IND16	IND16X	REL
 
-	DATA( 0, "ADC",	 X,		 X,		0x69,	0x65,	0x75,	 X,		0x6D,	0x7D,	0x79,	0x172,	0x61,	0x71,	 X,		 X,		 X		),
-	DATA( 0, "AND",	 X,		 X,		0x29,	0x25,	0x35,	 X,		0x2D,	0x3D,	0x39,	0x132,	0x21,	0x31,	 X,		 X,		 X		),
-	DATA( 0, "ASL",	 X,		0x0A,	 X,		0x06,	0x16,	 X,		0x0E,	0x1E,	 X,		 X,		 X,		 X,		 X,		 X,		 X		),
-	DATA( 0, "BCC",	 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		0x90	),
-	DATA( 0, "BCS",	 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		0xB0	),
-	DATA( 0, "BEQ",	 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		0xF0	),
-	DATA( 0, "BIT",	 X,		 X,		0x189,	0x24,	0x134,	 X,		0x2C,	0x13C,	 X,		 X,		 X,		 X,		 X,		 X,		 X		),
-	DATA( 0, "BMI",	 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		0x30	),
-	DATA( 0, "BNE",	 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		0xD0	),
-	DATA( 0, "BPL",	 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		0x10	),
-	DATA( 1, "BRA",	 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		0x180	),
-	DATA( 0, "BRK",	0x00,	 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X		),
-	DATA( 0, "BVC",	 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		0x50	),
-	DATA( 0, "BVS",	 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		0x70	),
-	DATA( 0, "CLC",	0x18,	 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X		),
-	DATA( 0, "CLD",	0xD8,	 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X		),
-	DATA( 0, "CLI",	0x58,	 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X		),
-	DATA( 1, "CLR",	 X,		 X,		 X,		0x164,	0x174,	 X,		0x19C,	0x19E,	 X,		 X,		 X,		 X,		 X,		 X,		 X		),
-	DATA( 0, "CLV",	0xB8,	 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X		),
-	DATA( 0, "CMP",	 X,		 X,		0xC9,	0xC5,	0xD5,	 X,		0xCD,	0xDD,	0xD9,	0x1D2,	0xC1,	0xD1,	 X,		 X,		 X		),
-	DATA( 0, "CPX",	 X,		 X,		0xE0,	0xE4,	 X,		 X,		0xEC,	 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X		),
-	DATA( 0, "CPY",	 X,		 X,		0xC0,	0xC4,	 X,		 X,		0xCC,	 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X		),
-	DATA( 1, "DEA",	0x13A,	 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X		),
-	DATA( 0, "DEC",	 X,		0x13A,	 X,		0xC6,	0xD6,	 X,		0xCE,	0xDE,	 X,		 X,		 X,		 X,		 X,		 X,		 X		),
-	DATA( 0, "DEX",	0xCA,	 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X		),
-	DATA( 0, "DEY",	0x88,	 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X		),
-	DATA( 0, "EOR",	 X,		 X,		0x49,	0x45,	0x55,	 X,		0x4D,	0x5D,	0x59,	0x152,	0x41,	0x51,	 X,		 X,		 X		),
-	DATA( 1, "INA",	0x11A,	 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X		),
-	DATA( 0, "INC",	 X,		0x11A,	 X,		0xE6,	0xF6,	 X,		0xEE,	0xFE,	 X,		 X,		 X,		 X,		 X,		 X,		 X		),
-	DATA( 0, "INX",	0xE8,	 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X		),
-	DATA( 0, "INY",	0xC8,	 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X		),
-	DATA( 0, "JMP",	 X,		 X,		 X,		 X,		 X,		 X,		0x4C,	 X,		 X,		 X,		 X,		 X,		0x6C,	0x17C,	 X		),
-	DATA( 0, "JSR",	 X,		 X,		 X,		 X,		 X,		 X,		0x20,	 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X		),
-	DATA( 0, "LDA",	 X,		 X,		0xA9,	0xA5,	0xB5,	 X,		0xAD,	0xBD,	0xB9,	0x1B2,	0xA1,	0xB1,	 X,		 X,		 X		),
-	DATA( 0, "LDX",	 X,		 X,		0xA2,	0xA6,	 X,		0xB6,	0xAE,	 X,		0xBE,	 X,		 X,		 X,		 X,		 X,		 X		),
-	DATA( 0, "LDY",	 X,		 X,		0xA0,	0xA4,	0xB4,	 X,		0xAC,	0xBC,	 X,		 X,		 X,		 X,		 X,		 X,		 X		),
-	DATA( 0, "LSR",	 X,		0x4A,	 X,		0x46,	0x56,	 X,		0x4E,	0x5E,	 X,		 X,		 X,		 X,		 X,		 X,		 X		),
-	DATA( 0, "NOP",	0xEA,	 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X		),
-	DATA( 0, "ORA",	 X,		 X,		0x09,	0x05,	0x15,	 X,		0x0D,	0x1D,	0x19,	0x112,	0x01,	0x11,	 X,		 X,		 X		),
-	DATA( 0, "PHA",	0x48,	 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X		),
-	DATA( 0, "PHP",	0x08,	 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X		),
-	DATA( 1, "PHX",	0x1DA,	 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X		),
-	DATA( 1, "PHY",	0x15A,	 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X		),
-	DATA( 0, "PLA",	0x68,	 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X		),
-	DATA( 0, "PLP",	0x28,	 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X		),
-	DATA( 1, "PLX",	0x1FA,	 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X		),
-	DATA( 1, "PLY",	0x17A,	 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X		),
-	DATA( 0, "ROL",	 X,		0x2A,	 X,		0x26,	0x36,	 X,		0x2E,	0x3E,	 X,		 X,		 X,		 X,		 X,		 X,		 X		),
-	DATA( 0, "ROR",	 X,		0x6A,	 X,		0x66,	0x76,	 X,		0x6E,	0x7E,	 X,		 X,		 X,		 X,		 X,		 X,		 X		),
-	DATA( 0, "RTI",	0x40,	 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X		),
-	DATA( 0, "RTS",	0x60,	 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X		),
-	DATA( 0, "SBC",	 X,		 X,		0xE9,	0xE5,	0xF5,	 X,		0xED,	0xFD,	0xF9,	0x1F2,	0xE1,	0xF1,	 X,		 X,		 X		),
-	DATA( 0, "SEC",	0x38,	 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X		),
-	DATA( 0, "SED",	0xF8,	 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X		),
-	DATA( 0, "SEI",	0x78,	 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X		),
-	DATA( 0, "STA",	 X,		 X,		 X,		0x85,	0x95,	 X,		0x8D,	0x9D,	0x99,	0x192,	0x81,	0x91,	 X,		 X,		 X		),
-	DATA( 0, "STX",	 X,		 X,		 X,		0x86,	 X,		0x96,	0x8E,	 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X		),
-	DATA( 0, "STY",	 X,		 X,		 X,		0x84,	0x94,	 X,		0x8C,	 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X		),
-	DATA( 1, "STZ",	 X,		 X,		 X,		0x164,	0x174,	 X,		0x19C,	0x19E,	 X,		 X,		 X,		 X,		 X,		 X,		 X		),
-	DATA( 0, "TAX",	0xAA,	 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X		),
-	DATA( 0, "TAY",	0xA8,	 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X		),
-	DATA( 1, "TRB",	 X,		 X,		 X,		0x114,	 X,		 X,		0x11C,	 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X		),
-	DATA( 1, "TSB",	 X,		 X,		 X,		0x104,	 X,		 X,		0x10C,	 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X		),
-	DATA( 0, "TSX",	0xBA,	 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X		),
-	DATA( 0, "TXA",	0x8A,	 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X		),
-	DATA( 0, "TXS",	0x9A,	 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X		),
-	DATA( 0, "TYA",	0x98,	 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X		)
+	DATA( 0, "ADC",	 X,		 X,		0x69,	0x65,	0x75,	 X,		0x6D,	0x7D,	0x79,	0x172,	0x61,	0x71,	 X,		 X,		 X,
+	      CYCLES(	 0,		 0,		 2,		 3,		 4,		 0,		 4,		4+P,	4+P,	 5,		 6,		5+P,	 0,		 0,		 0		) ),
+	DATA( 0, "AND",	 X,		 X,		0x29,	0x25,	0x35,	 X,		0x2D,	0x3D,	0x39,	0x132,	0x21,	0x31,	 X,		 X,		 X,
+	      CYCLES(	 0,		 0,		 2,		 3,		 4,		 0,		 4,		4+P,	4+P,	 5,		 6,		5+P,	 0,		 0,		 0		) ),
+	DATA( 0, "ASL",	 X,		0x0A,	 X,		0x06,	0x16,	 X,		0x0E,	0x1E,	 X,		 X,		 X,		 X,		 X,		 X,		 X,
+	      CYCLES(	 0,		 2,		 0,		 5,		 6,		 0,		 6,		7+F,	 0,		 0,		 0,		 0,		 0,		 0,		 0		) ),
+	DATA( 0, "BCC",	 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		0x90,
+	      CYCLES(	 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 2		) ),
+	DATA( 0, "BCS",	 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		0xB0,
+	      CYCLES(	 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 2		) ),
+	DATA( 0, "BEQ",	 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		0xF0,
+	      CYCLES(	 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 2		) ),
+	DATA( 0, "BIT",	 X,		 X,		0x189,	0x24,	0x134,	 X,		0x2C,	0x13C,	 X,		 X,		 X,		 X,		 X,		 X,		 X,
+	      CYCLES(	 0,		 0,		 2,		 3,		 4,		 0,		 4,		4+P,	 0,		 0,		 0,		 0,		 0,		 0,		 0		) ),
+	DATA( 0, "BMI",	 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		0x30,
+	      CYCLES(	 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 2		) ),
+	DATA( 0, "BNE",	 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		0xD0,
+	      CYCLES(	 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 2		) ),
+	DATA( 0, "BPL",	 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		0x10,
+	      CYCLES(	 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 2		) ),
+	DATA( 1, "BRA",	 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		0x180,
+	      CYCLES(	 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 3		) ),
+	DATA( 0, "BRK",	0x00,	 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,
+	      CYCLES(	 7,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0		) ),
+	DATA( 0, "BVC",	 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		0x50,
+	      CYCLES(	 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 2		) ),
+	DATA( 0, "BVS",	 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		0x70,
+	      CYCLES(	 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 2		) ),
+	DATA( 0, "CLC",	0x18,	 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,
+	      CYCLES(	 2,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0		) ),
+	DATA( 0, "CLD",	0xD8,	 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,
+	      CYCLES(	 2,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0		) ),
+	DATA( 0, "CLI",	0x58,	 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,
+	      CYCLES(	 2,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0		) ),
+	DATA( 1, "CLR",	 X,		 X,		 X,		0x164,	0x174,	 X,		0x19C,	0x19E,	 X,		 X,		 X,		 X,		 X,		 X,		 X,
+	      CYCLES(	 0,		 0,		 0,		 3,		 4,		 0,		 4,		 5,		 0,		 0,		 0,		 0,		 0,		 0,		 0		) ),
+	DATA( 0, "CLV",	0xB8,	 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,
+	      CYCLES(	 2,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0		) ),
+	DATA( 0, "CMP",	 X,		 X,		0xC9,	0xC5,	0xD5,	 X,		0xCD,	0xDD,	0xD9,	0x1D2,	0xC1,	0xD1,	 X,		 X,		 X,
+	      CYCLES(	 0,		 0,		 2,		 3,		 4,		 0,		 4,		4+P,	4+P,	 5,		 6,		5+P,	 0,		 0,		 0		) ),
+	DATA( 0, "CPX",	 X,		 X,		0xE0,	0xE4,	 X,		 X,		0xEC,	 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,
+	      CYCLES(	 0,		 0,		 2,		 3,		 0,		 0,		 4,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0		) ),
+	DATA( 0, "CPY",	 X,		 X,		0xC0,	0xC4,	 X,		 X,		0xCC,	 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,
+	      CYCLES(	 0,		 0,		 2,		 3,		 0,		 0,		 4,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0		) ),
+	DATA( 1, "DEA",	0x13A,	 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,
+	      CYCLES(	 2,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0		) ),
+	DATA( 0, "DEC",	 X,		0x13A,	 X,		0xC6,	0xD6,	 X,		0xCE,	0xDE,	 X,		 X,		 X,		 X,		 X,		 X,		 X,
+	      CYCLES(	 0,		 2,		 0,		 5,		 6,		 0,		 6,		 7,		 0,		 0,		 0,		 0,		 0,		 0,		 0		) ),
+	DATA( 0, "DEX",	0xCA,	 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,
+	      CYCLES(	 2,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0		) ),
+	DATA( 0, "DEY",	0x88,	 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,
+	      CYCLES(	 2,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0		) ),
+	DATA( 0, "EOR",	 X,		 X,		0x49,	0x45,	0x55,	 X,		0x4D,	0x5D,	0x59,	0x152,	0x41,	0x51,	 X,		 X,		 X,
+	      CYCLES(	 0,		 0,		 2,		 3,		 4,		 0,		 4,		4+P,	4+P,	 5,		 6,		5+P,	 0,		 0,		 0		) ),
+	DATA( 1, "INA",	0x11A,	 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,
+	      CYCLES(	 2,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0		) ),
+	DATA( 0, "INC",	 X,		0x11A,	 X,		0xE6,	0xF6,	 X,		0xEE,	0xFE,	 X,		 X,		 X,		 X,		 X,		 X,		 X,
+	      CYCLES(	 0,		 2,		 0,		 5,		 6,		 0,		 6,		 7,		 0,		 0,		 0,		 0,		 0,		 0,		 0		) ),
+	DATA( 0, "INX",	0xE8,	 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,
+	      CYCLES(	 2,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0		) ),
+	DATA( 0, "INY",	0xC8,	 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,
+	      CYCLES(	 2,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0		) ),
+	DATA( 0, "JMP",	 X,		 X,		 X,		 X,		 X,		 X,		0x4C,	 X,		 X,		 X,		 X,		 X,		0x6C,	0x17C,	 X,
+	      CYCLES(	 0,		 0,		 0,		 0,		 0,		 0,		 3,		 0,		 0,		 0,		 0,		 0,		5+M,	 6,		 0		) ),
+	DATA( 0, "JSR",	 X,		 X,		 X,		 X,		 X,		 X,		0x20,	 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,
+	      CYCLES(	 0,		 0,		 0,		 0,		 0,		 0,		 6,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0		) ),
+	DATA( 0, "LDA",	 X,		 X,		0xA9,	0xA5,	0xB5,	 X,		0xAD,	0xBD,	0xB9,	0x1B2,	0xA1,	0xB1,	 X,		 X,		 X,
+	      CYCLES(	 0,		 0,		 2,		 3,		 4,		 0,		 4,		4+P,	4+P,	 5,		 6,		5+P,	 0,		 0,		 0		) ),
+	DATA( 0, "LDX",	 X,		 X,		0xA2,	0xA6,	 X,		0xB6,	0xAE,	 X,		0xBE,	 X,		 X,		 X,		 X,		 X,		 X,
+	      CYCLES(	 0,		 0,		 2,		 3,		 0,		 4,		 4,		 0,		4+P,	 0,		 0,		 0,		 0,		 0,		 0		) ),
+	DATA( 0, "LDY",	 X,		 X,		0xA0,	0xA4,	0xB4,	 X,		0xAC,	0xBC,	 X,		 X,		 X,		 X,		 X,		 X,		 X,
+	      CYCLES(	 0,		 0,		 2,		 3,		 4,		 0,		 4,		4+P,	 0,		 0,		 0,		 0,		 0,		 0,		 0		) ),
+	DATA( 0, "LSR",	 X,		0x4A,	 X,		0x46,	0x56,	 X,		0x4E,	0x5E,	 X,		 X,		 X,		 X,		 X,		 X,		 X,
+	      CYCLES(	 0,		 2,		 0,		 5,		 6,		 0,		 6,		7+F,	 0,		 0,		 0,		 0,		 0,		 0,		 0		) ),
+	DATA( 0, "NOP",	0xEA,	 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,
+	      CYCLES(	 2,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0		) ),
+	DATA( 0, "ORA",	 X,		 X,		0x09,	0x05,	0x15,	 X,		0x0D,	0x1D,	0x19,	0x112,	0x01,	0x11,	 X,		 X,		 X,
+	      CYCLES(	 0,		 0,		 2,		 3,		 4,		 0,		 4,		4+P,	4+P,	 5,		 6,		5+P,	 0,		 0,		 0		) ),
+	DATA( 0, "PHA",	0x48,	 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,
+	      CYCLES(	 3,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0		) ),
+	DATA( 0, "PHP",	0x08,	 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,
+	      CYCLES(	 3,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0		) ),
+	DATA( 1, "PHX",	0x1DA,	 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,
+	      CYCLES(	 3,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0		) ),
+	DATA( 1, "PHY",	0x15A,	 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,
+	      CYCLES(	 3,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0		) ),
+	DATA( 0, "PLA",	0x68,	 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,
+	      CYCLES(	 4,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0		) ),
+	DATA( 0, "PLP",	0x28,	 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,
+	      CYCLES(	 4,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0		) ),
+	DATA( 1, "PLX",	0x1FA,	 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,
+	      CYCLES(	 4,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0		) ),
+	DATA( 1, "PLY",	0x17A,	 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,
+	      CYCLES(	 4,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0		) ),
+	DATA( 0, "ROL",	 X,		0x2A,	 X,		0x26,	0x36,	 X,		0x2E,	0x3E,	 X,		 X,		 X,		 X,		 X,		 X,		 X,
+	      CYCLES(	 0,		 2,		 0,		 5,		 6,		 0,		 6,		7+F,	 0,		 0,		 0,		 0,		 0,		 0,		 0		) ),
+	DATA( 0, "ROR",	 X,		0x6A,	 X,		0x66,	0x76,	 X,		0x6E,	0x7E,	 X,		 X,		 X,		 X,		 X,		 X,		 X,
+	      CYCLES(	 0,		 2,		 0,		 5,		 6,		 0,		 6,		7+F,	 0,		 0,		 0,		 0,		 0,		 0,		 0		) ),
+	DATA( 0, "RTI",	0x40,	 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,
+	      CYCLES(	 6,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0		) ),
+	DATA( 0, "RTS",	0x60,	 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,
+	      CYCLES(	 6,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0		) ),
+	DATA( 0, "SBC",	 X,		 X,		0xE9,	0xE5,	0xF5,	 X,		0xED,	0xFD,	0xF9,	0x1F2,	0xE1,	0xF1,	 X,		 X,		 X,
+	      CYCLES(	 0,		 0,		 2,		 3,		 4,		 0,		 4,		4+P,	4+P,	 5,		 6,		5+P,	 0,		 0,		 0		) ),
+	DATA( 0, "SEC",	0x38,	 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,
+	      CYCLES(	 2,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0		) ),
+	DATA( 0, "SED",	0xF8,	 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,
+	      CYCLES(	 2,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0		) ),
+	DATA( 0, "SEI",	0x78,	 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,
+	      CYCLES(	 2,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0		) ),
+	DATA( 0, "STA",	 X,		 X,		 X,		0x85,	0x95,	 X,		0x8D,	0x9D,	0x99,	0x192,	0x81,	0x91,	 X,		 X,		 X,
+	      CYCLES(	 0,		 0,		 0,		 3,		 4,		 0,		 4,		 5,		 5,		 5,		 6,		 6,		 0,		 0,		 0		) ),
+	DATA( 0, "STX",	 X,		 X,		 X,		0x86,	 X,		0x96,	0x8E,	 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,
+	      CYCLES(	 0,		 0,		 0,		 3,		 0,		 4,		 4,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0		) ),
+	DATA( 0, "STY",	 X,		 X,		 X,		0x84,	0x94,	 X,		0x8C,	 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,
+	      CYCLES(	 0,		 0,		 0,		 3,		 4,		 0,		 4,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0		) ),
+	DATA( 1, "STZ",	 X,		 X,		 X,		0x164,	0x174,	 X,		0x19C,	0x19E,	 X,		 X,		 X,		 X,		 X,		 X,		 X,
+	      CYCLES(	 0,		 0,		 0,		 3,		 4,		 0,		 4,		 5,		 0,		 0,		 0,		 0,		 0,		 0,		 0		) ),
+	DATA( 0, "TAX",	0xAA,	 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,
+	      CYCLES(	 2,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0		) ),
+	DATA( 0, "TAY",	0xA8,	 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,
+	      CYCLES(	 2,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0		) ),
+	DATA( 1, "TRB",	 X,		 X,		 X,		0x114,	 X,		 X,		0x11C,	 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,
+	      CYCLES(	 0,		 0,		 0,		 5,		 0,		 0,		 6,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0		) ),
+	DATA( 1, "TSB",	 X,		 X,		 X,		0x104,	 X,		 X,		0x10C,	 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,
+	      CYCLES(	 0,		 0,		 0,		 5,		 0,		 0,		 6,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0		) ),
+	DATA( 0, "TSX",	0xBA,	 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,
+	      CYCLES(	 2,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0		) ),
+	DATA( 0, "TXA",	0x8A,	 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,
+	      CYCLES(	 2,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0		) ),
+	DATA( 0, "TXS",	0x9A,	 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,
+	      CYCLES(	 2,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0		) ),
+	DATA( 0, "TYA",	0x98,	 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,		 X,
+	      CYCLES(	 2,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0,		 0		) )
 };
 
 #undef X
+#undef P
+#undef M
+#undef F
 
 /*************************************************************************************************/
 /**
@@ -150,52 +231,74 @@ int LineParser::GetInstructionAndAdvanceColumn()
 /*************************************************************************************************/
 int LineParser::GetInstructionAndAdvanceColumn(bool requireDistinctOpcodes)
 {
-	for ( int i = 0; i < static_cast<int>( sizeof m_gaOpcodeTable / sizeof( OpcodeData ) ); i++ )
+	static const KeywordTrie opcodeTrie( GetOpcodeNames() );
+
+	KeywordTrie::Match matches[ MAX_KEYWORD_MATCHES ];
+	int matchCount = opcodeTrie.FindPrefixes( m_line, m_column, matches );
+
+	// If several instructions match, the one earliest in the table wins
+
+	int best = -1;
+
+	for ( int i = 0; i < matchCount; i++ )
 	{
-		int			cpu		= m_gaOpcodeTable[ i ].m_cpu;
-		const char*	token	= m_gaOpcodeTable[ i ].m_pName;
-		size_t		len		= m_gaOpcodeTable[ i ].m_nameLength;
-		assert(len == strlen( token ));
+		int		index	= matches[ i ].m_index;
+		size_t	len		= matches[ i ].m_length;
 
 		// ignore instructions not for current cpu
-		if ( cpu > ObjectCode::Instance().GetCPU() )
+		if ( m_gaOpcodeTable[ index ].m_cpu > ObjectCode::Instance().GetCPU() )
 			continue;
 
-		// see if token matches
-
-		bool bMatch = true;
-		for ( unsigned int j = 0; j < len; j++ )
-		{
-			if ( token[ j ] != Ascii::ToUpper( m_line[ m_column + j ] ) )
-			{
-				bMatch = false;
-				break;
-			}
-		}
-
 		// The token matches so far, but (optionally) check there's nothing after it; this prevents 
 		// false matches where a macro name begins with an opcode, at the cost of disallowing 
 		// things like "foo=&70:stafoo".
-		if ( requireDistinctOpcodes && bMatch )
+		if ( requireDistinctOpcodes )
 		{
 			std::string::size_type k = m_column + len;
 			if ( k < m_line.length() )
 			{
 				if ( !isspace( m_line[ k ] ) && m_line[ k ] != ':' )
 				{
-					bMatch = false;
+					continue;
 				}
 			}
 		}
 
-		if ( bMatch )
+		if ( best == -1 || index < matches[ best ].m_index )
 		{
-			m_column += len;
-			return i;
+			best = i;
 		}
 	}
 
-	return -1;
+	if ( best == -1 )
+	{
+		return -1;
+	}
+
+	m_column += matches[ best ].m_length;
+	return matches[ best ].m_index;
+}
+
+
+
+/*************************************************************************************************/
+/**
+	LineParser::GetOpcodeNames()
+
+	Returns the names of the instructions in m_gaOpcodeTable, in table order
+*/
+/*************************************************************************************************/
+vector<const char*> LineParser::GetOpcodeNames()
+{
+	vector<const char*> names;
+
+	for ( int i = 0; i < static_cast<int>( sizeof m_gaOpcodeTable / sizeof( OpcodeData ) ); i++ )
+	{
+		assert( static_cast<size_t>( m_gaOpcodeTable[ i ].m_nameLength ) == strlen( m_gaOpcodeTable[ i ].m_pName ) );
+		names.push_back( m_gaOpcodeTable[ i ].m_pName );
+	}
+
+	return names;
 }
 
 
@@ -238,17 +341,18 @@ void LineParser::Assemble1( int instructionIndex, ADDRESSING_MODE mode )
 
 	if ( m_sourceCode->ShouldOutputAsm() )
 	{
-		cout << uppercase << hex << setfill( '0' ) << "     ";
-		cout << setw(4) << ObjectCode::Instance().GetPC() << "   ";
-		cout << setw(2) << GetOpcode( instructionIndex, mode ) << "         ";
-		cout << m_gaOpcodeTable[ instructionIndex ].m_pName;
+		ostringstream out;
+		out << uppercase << hex << setfill( '0' ) << "     ";
+		out << setw(4) << ObjectCode::Instance().GetPC() << "   ";
+		out << setw(2) << GetOpcode( instructionIndex, mode ) << "         ";
+		out << m_gaOpcodeTable[ instructionIndex ].m_pName;
 
 		if ( mode == ACC )
 		{
-			cout << " A";
+			out << " A";
 		}
 
-		cout << endl << nouppercase << dec << setfill( ' ' );
+		ListInstruction( out.str(), instructionIndex, mode, 0 );
 	}
 
 	try
@@ -277,52 +381,63 @@ void LineParser::Assemble2( int instructionIndex, ADDRESSING_MODE mode, unsigned
 
 	if ( m_sourceCode->ShouldOutputAsm() )
 	{
-		cout << uppercase << hex << setfill( '0' ) << "     ";
-		cout << setw(4) << ObjectCode::Instance().GetPC() << "   ";
-		cout << setw(2) << GetOpcode( instructionIndex, mode ) << " ";
-		cout << setw(2) << value << "      ";
-		cout << m_gaOpcodeTable[ instructionIndex ].m_pName << " ";
+		ostringstream out;
+		out << uppercase << hex << setfill( '0' ) << "     ";
+		out << setw(4) << ObjectCode::Instance().GetPC() << "   ";
+		out << setw(2) << GetOpcode( instructionIndex, mode ) << " ";
+		out << setw(2) << value << "      ";
+		out << m_gaOpcodeTable[ instructionIndex ].m_pName << " ";
 
 		if ( mode == IMM )
 		{
-			cout << "#";
+			out << "#";
 		}
 		else if ( mode == IND || mode == INDX || mode == INDY )
 		{
-			cout << "(";
+			out << "(";
 		}
 
 		if ( mode == REL )
 		{
-			cout << "&" << setw(4) << ObjectCode::Instance().GetPC() + 2 + static_cast< signed char >( value );
+			out << "&" << setw(4) << ObjectCode::Instance().GetPC() + 2 + static_cast< signed char >( value );
 		}
 		else
 		{
-			cout << "&" << setw(2) << value;
+			out << "&" << setw(2) << value;
 		}
 
 		if ( mode == ZPX )
 		{
-			cout << ",X";
+			out << ",X";
 		}
 		else if ( mode == ZPY )
 		{
-			cout << ",Y";
+			out << ",Y";
 		}
 		else if ( mode == IND )
 		{
-			cout << ")";
+			out << ")";
 		}
 		else if ( mode == INDX )
 		{
-			cout << ",X)";
+			out << ",X)";
 		}
 		else if ( mode == INDY )
 		{
-			cout << "),Y";
+			out << "),Y";
 		}
 
-		cout << endl << nouppercase << dec << setfill( ' ' );
+		ListInstruction( out.str(), instructionIndex, mode, value );
+	}
+
+	// Where a branch goes is only certain on the second pass
+
+	if ( mode == REL &&
+		 GlobalData::Instance().IsSecondPass() &&
+		 m_sourceCode->IsNoPageCross() &&
+		 BranchCrossesPage( value ) )
+	{
+		throw AsmException_SyntaxError_BranchCrossesPage( m_line, m_column );
 	}
 
 	try
@@ -351,38 +466,47 @@ void LineParser::Assemble3( int instructionIndex, ADDRESSING_MODE mode, unsigned
 
 	if ( m_sourceCode->ShouldOutputAsm() )
 	{
-		cout << uppercase << hex << setfill( '0' ) << "     ";
-		cout << setw(4) << ObjectCode::Instance().GetPC() << "   ";
-		cout << setw(2) << GetOpcode( instructionIndex, mode ) << " ";
-		cout << setw(2) << ( value & 0xFF ) << " ";
-		cout << setw(2) << ( ( value >> 8 ) & 0xFF ) << "   ";
-		cout << m_gaOpcodeTable[ instructionIndex ].m_pName << " ";
+		ostringstream out;
+		out << uppercase << hex << setfill( '0' ) << "     ";
+		out << setw(4) << ObjectCode::Instance().GetPC() << "   ";
+		out << setw(2) << GetOpcode( instructionIndex, mode ) << " ";
+		out << setw(2) << ( value & 0xFF ) << " ";
+		out << setw(2) << ( ( value >> 8 ) & 0xFF ) << "   ";
+		out << m_gaOpcodeTable[ instructionIndex ].m_pName << " ";
 
 		if ( mode == IND16 || mode == IND16X )
 		{
-			cout << "(";
+			out << "(";
 		}
 
-		cout << "&" << setw(4) << value;
+		out << "&" << setw(4) << value;
 
 		if ( mode == ABSX )
 		{
-			cout << ",X";
+			out << ",X";
 		}
 		else if ( mode == ABSY )
 		{
-			cout << ",Y";
+			out << ",Y";
 		}
 		else if ( mode == IND16 )
 		{
-			cout << ")";
+			out << ")";
 		}
 		else if ( mode == IND16X )
 		{
-			cout << ",X)";
+			out << ",X)";
 		}
 
-		cout << endl << nouppercase << dec << setfill( ' ' );
+		ListInstruction( out.str(), instructionIndex, mode, value );
+	}
+
+	// Tables after the code aren't known until the first pass is over; every assembly, however
+	// it lays out the code, ends with a second pass which checks them all
+
+	if ( ( mode == ABSX || mode == ABSY ) && GlobalData::Instance().IsSecondPass() )
+	{
+		CheckIndexedTable( value );
 	}
 
 	try
@@ -399,6 +523,206 @@ void LineParser::Assemble3( int instructionIndex, ADDRESSING_MODE mode, unsigned
 
 
 
+/*************************************************************************************************/
+/**
+	LineParser::GetCycles()
+
+	Works out how many cycles an instruction about to be assembled at the PC will take
+
+	@param		instructionIndex	The instruction
+	@param		mode				Its addressing mode
+	@param		value				Its operand
+	@param		minCycles			Filled in with the fewest cycles it can take
+	@param		maxCycles			Filled in with the most cycles it can take
+	@param		cycles				Filled in with the cycles for the listing, e.g. "4+p" for an
+									indexed read which may cross a page, or "2/3" for a branch
+									which takes 2 cycles if not taken and 3 if taken
+*/
+/*************************************************************************************************/
+void LineParser::GetCycles( int instructionIndex, ADDRESSING_MODE mode, unsigned int value,
+							int& minCycles, int& maxCycles, string& cycles )
+{
+	int data = m_gaOpcodeTable[ instructionIndex ].m_aCycles[ mode ];
+	int base = data & CYCLES_MASK;
+	bool bPageCrossingCosts = ( data & CYCLES_PAGE_CROSSED ) != 0;
+
+	if ( ObjectCode::Instance().GetCPU() != 0 )
+	{
+		if ( data & CYCLES_65C02_MORE )
+		{
+			base++;
+		}
+
+		if ( data & CYCLES_65C02_FEWER )
+		{
+			base--;
+			bPageCrossingCosts = true;
+		}
+	}
+
+	ostringstream text;
+
+	if ( mode == REL )
+	{
+		// The destination is known, so it's known whether a taken branch crosses a page
+
+		int taken = BranchCrossesPage( value ) ? 4 : 3;
+
+		// BRA is always taken
+		minCycles = ( GetOpcode( instructionIndex, mode ) == 0x80 ) ? taken : base;
+		maxCycles = taken;
+
+		text << minCycles;
+
+		if ( maxCycles != minCycles )
+		{
+			text << "/" << maxCycles;
+		}
+	}
+	else
+	{
+		// Indexing from a page-aligned address never crosses a page; indexing from a pointer in
+		// zero page might
+
+		minCycles = base;
+		maxCycles = base;
+
+		if ( bPageCrossingCosts && ( mode == INDY || ( value & 0xFF ) != 0 ) )
+		{
+			maxCycles++;
+		}
+
+		text << minCycles;
+
+		if ( maxCycles != minCycles )
+		{
+			text << "+p";
+		}
+	}
+
+	cycles = text.str();
+}
+
+
+
+/*************************************************************************************************/
+/**
+	LineParser::BranchCrossesPage()
+
+	@param		value				The operand of a branch about to be assembled at the PC
+
+	@return		Whether the branch, if taken, goes to a different page from the instruction after
+				it, which costs an extra cycle
+*/
+/*************************************************************************************************/
+bool LineParser::BranchCrossesPage( unsigned int value ) const
+{
+	int next = ObjectCode::Instance().GetPC() + 2;
+	int destination = next + static_cast< signed char >( value );
+
+	return ( ( next ^ destination ) & 0xFF00 ) != 0;
+}
+
+
+
+/*************************************************************************************************/
+/**
+	LineParser::CheckIndexedTable()
+
+	Checks an abs,X or abs,Y access about to be assembled against the table it indexes, if any.
+	If the part of the table the index can reach spans a page, some accesses will cost an extra
+	cycle: inside NOPAGECROSS that's an error, and otherwise a warning, given once for each table.
+
+	@param		value				The operand
+*/
+/*************************************************************************************************/
+void LineParser::CheckIndexedTable( unsigned int value )
+{
+	int start;
+	int end;
+
+	if ( !ObjectCode::Instance().FindTable( static_cast< int >( value ), start, end ) )
+	{
+		return;
+	}
+
+	// The index reaches at most 255 bytes past the operand
+
+	int first = static_cast< int >( value );
+	int last = min( end - 1, first + 0xFF );
+
+	if ( ( ( first ^ last ) & 0xFF00 ) == 0 )
+	{
+		return;
+	}
+
+	if ( m_sourceCode->IsNoPageCross() )
+	{
+		throw AsmException_SyntaxError_TableCrossesPage( m_line, m_column );
+	}
+
+	if ( ObjectCode::Instance().MarkTableWarned( start ) )
+	{
+		ostringstream warning;
+		warning << uppercase << hex << setfill( '0' )
+				<< "warning: indexed table at &" << setw(4) << start
+				<< " spans a page boundary (&" << setw(4) << first << "-&" << setw(4) << last << ")";
+
+		GlobalData::Instance().GetErrorStream()
+			<< StringUtils::FormattedErrorLocation( m_sourceCode->GetFilename(), m_sourceCode->GetLineNumber() )
+			<< ": " << warning.str() << endl;
+	}
+}
+
+
+
+/*************************************************************************************************/
+/**
+	LineParser::ListInstruction()
+
+	Lists an instruction about to be assembled at the PC, with its cycles and the cycles since
+	the last label if they were asked for
+
+	@param		listing				The address, bytes and disassembly of the instruction
+	@param		instructionIndex	The instruction
+	@param		mode				Its addressing mode
+	@param		value				Its operand
+*/
+/*************************************************************************************************/
+void LineParser::ListInstruction( const string& listing, int instructionIndex, ADDRESSING_MODE mode, unsigned int value )
+{
+	ostream& out = GlobalData::Instance().GetOutputStream();
+
+	out << listing;
+
+	if ( GlobalData::Instance().ShowCycles() )
+	{
+		int minCycles;
+		int maxCycles;
+		string cycles;
+		GetCycles( instructionIndex, mode, value, minCycles, maxCycles, cycles );
+
+		GlobalData& globalData = GlobalData::Instance();
+		globalData.AddCycles( minCycles, maxCycles );
+
+		ostringstream total;
+		total << globalData.GetMinCycleTotal();
+
+		if ( globalData.GetMaxCycleTotal() != globalData.GetMinCycleTotal() )
+		{
+			total << "-" << globalData.GetMaxCycleTotal();
+		}
+
+		out << string( listing.length() < CYCLES_COLUMN ? CYCLES_COLUMN - listing.length() : 1, ' ' )
+			<< cycles << string( cycles.length() < 8 ? 8 - cycles.length() : 1, ' ' )
+			<< total.str();
+	}
+
+	out << endl;
+}
+
+
+
 /*************************************************************************************************/
 /**
 	LineParser::HandleAssembler()
@@ -456,6 +780,12 @@ void LineParser::HandleAssembler( int instruction )
 			}
 		}
 
+		if ( GlobalData::Instance().IsRelaxing() && ( value < 0 || value > 0xFF ) )
+		{
+			// the value may depend on an estimate which hasn't settled; the second pass checks it
+			value = 0;
+		}
+
 		if ( value > 0xFF )
 		{
 			// Immediate constant too large
@@ -530,6 +860,14 @@ void LineParser::HandleAssembler( int instruction )
 			}
 		}
 
+		if ( GlobalData::Instance().IsRelaxing() && ( value < 0 || value > 0xFF ) )
+		{
+			// the value may depend on an estimate which hasn't settled; the second pass checks it.
+			// Which of the indirect modes this is depends only on the syntax, so the size of the
+			// instruction is unaffected.
+			value = 0;
+		}
+
 		// the only valid character to find here is ',' for (ind,X) or (ind16,X) and ')' for (ind),Y or (ind16) or (ind)
 		// we know that ind and ind16 forms are exclusive
 		// check (ind), (ind16) and (ind),Y
@@ -755,6 +1093,13 @@ void LineParser::HandleAssembler( int instruction )
 		}
 	}
 
+	if ( GlobalData::Instance().IsRelaxing() && ( value < 0 || value > 0xFFFF ) )
+	{
+		// the value may depend on an estimate which hasn't settled; as for an unknown value on the
+		// first pass, assume it's a 16-bit address and leave the second pass to check it
+		value = ObjectCode::Instance().GetPC();
+	}
+
 	if ( !AdvanceAndCheckEndOfStatement() )
 	{
 		// end of this instruction
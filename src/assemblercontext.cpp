@@ -0,0 +1,87 @@
+/*************************************************************************************************/
+/**
+	assemblercontext.cpp
+
+
+	Copyright (C) Rich Talbot-Watkins 2007 - 2012
+
+	This file is part of BeebAsm.
+
+	BeebAsm is free software: you can redistribute it and/or modify it under the terms of the GNU
+	General Public License as published by the Free Software Foundation, either version 3 of the
+	License, or (at your option) any later version.
+
+	BeebAsm is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without
+	even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License along with BeebAsm, as
+	COPYING.txt.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/*************************************************************************************************/
+
+#include "assemblercontext.h"
+#include "buildcache.h"
+#include "globaldata.h"
+#include "macro.h"
+#include "objectcode.h"
+#include "profiler.h"
+#include "scopedsymbolname.h"
+#include "statistics.h"
+#include "symboltable.h"
+#include "tracer.h"
+
+using namespace std;
+
+
+
+/*************************************************************************************************/
+/**
+	AssemblerContext::AssemblerContext()
+
+	Creates the singletons for an assembly on this thread.  Only one context can exist on a
+	thread at a time.
+
+	@param		out				Stream for what the assembly would otherwise write to stdout
+	@param		err				Stream for what the assembly would otherwise write to stderr
+*/
+/*************************************************************************************************/
+AssemblerContext::AssemblerContext( ostream& out, ostream& err )
+{
+	GlobalData::Create();
+	GlobalData::Instance().SetOutputStreams( out, err );
+	ScopedSymbolName::CreateInternTable();
+	SymbolTable::Create();
+	BuildCache::Create();
+	ObjectCode::Create();
+	MacroTable::Create();
+	Statistics::Create();
+	Tracer::Create();
+#ifdef BEEBASM_PROFILER
+	Profiler::Create();
+#endif
+}
+
+
+
+/*************************************************************************************************/
+/**
+	AssemblerContext::~AssemblerContext()
+
+	Destroys the singletons for the assembly, in the reverse order to their creation
+*/
+/*************************************************************************************************/
+AssemblerContext::~AssemblerContext()
+{
+#ifdef BEEBASM_PROFILER
+	Profiler::Destroy();
+#endif
+	Tracer::Destroy();
+	Statistics::Destroy();
+	MacroTable::Destroy();
+	ObjectCode::Destroy();
+	BuildCache::Destroy();
+	SymbolTable::Destroy();
+	ScopedSymbolName::DestroyInternTable();
+	GlobalData::Destroy();
+}
@@ -0,0 +1,59 @@
+/*************************************************************************************************/
+/**
+	assemblercontext.h
+
+
+	Copyright (C) Rich Talbot-Watkins 2007 - 2012
+
+	This file is part of BeebAsm.
+
+	BeebAsm is free software: you can redistribute it and/or modify it under the terms of the GNU
+	General Public License as published by the Free Software Foundation, either version 3 of the
+	License, or (at your option) any later version.
+
+	BeebAsm is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without
+	even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License along with BeebAsm, as
+	COPYING.txt.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/*************************************************************************************************/
+
+#ifndef ASSEMBLERCONTEXT_H_
+#define ASSEMBLERCONTEXT_H_
+
+#include <iosfwd>
+
+
+/*************************************************************************************************/
+/**
+	AssemblerContext
+
+	Everything one assembly changes as it runs: the GlobalData, SymbolTable, ObjectCode,
+	MacroTable, BuildCache, Statistics and Tracer singletons, the Profiler if it's built in, and
+	the table of interned symbol names, which live from the construction of an AssemblerContext
+	until its destruction, and the streams the assembly writes to in place of stdout and stderr.
+
+	The singletons belong to the thread which created them, as does the random number generator,
+	so each thread can run its own assembly at the same time as the others with nothing shared
+	between them.  Each thread needs a FileCache of its own too, which is left outside the
+	context so that it can outlive a single assembly.
+*/
+/*************************************************************************************************/
+class AssemblerContext
+{
+public:
+
+	AssemblerContext( std::ostream& out, std::ostream& err );
+	~AssemblerContext();
+
+
+private:
+
+	AssemblerContext( const AssemblerContext& );
+	AssemblerContext& operator=( const AssemblerContext& );
+};
+
+
+#endif // ASSEMBLERCONTEXT_H_
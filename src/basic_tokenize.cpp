@@ -9,7 +9,6 @@
 *************************************************************************************************/
 
 #include <assert.h>
-#include <cerrno>
 #include <cstring>
 #include "basic_keywords.h"
 #include "basic_tokenize.h"
@@ -19,12 +18,12 @@
 class Reader
 {
 public:
-	Reader(FILE* file) : m_file(file)
+	Reader(const unsigned char* data, size_t length) : m_data(data), m_length(length)
 	{
+		m_position = 0;
 		m_line = 1;
 		m_current = 0;
 		m_end = false;
-		m_errno = 0;
 		m_lastcr = false;
 		Next();
 	}
@@ -43,17 +42,13 @@ public:
 			}
 			m_line++;
 		}
-		int next = fgetc(m_file);
+		int next = Read();
 		if (m_lastcr && (next == 0x0A))
 		{
-			next = fgetc(m_file);
+			next = Read();
 		}
 		if (next == EOF)
 		{
-			if (ferror(m_file))
-			{
-				m_errno = errno;
-			}
 			// m_lastcr no longer matters
 			m_end = true;
 			m_current = 0x0D;
@@ -72,11 +67,17 @@ public:
 	}
 
 private:
-	FILE* m_file;
+	int Read()
+	{
+		return (m_position < m_length) ? m_data[m_position++] : EOF;
+	}
+
+	const unsigned char* m_data;
+	size_t m_length;
+	size_t m_position;
 	bool m_end;
 	bool m_lastcr;
 	char m_current;
-	int m_errno;
 	int m_line;
 };
 
@@ -448,10 +449,10 @@ void tokenize_line(Reader &reader, Writer &writer)
 	}
 }
 
-// Read a plain text BBC BASIC program from `file` and write it tokenized to `tokenized`
-TokenizeError tokenize_file(FILE* file, std::vector<unsigned char>& tokenized)
+// Tokenize the plain text BBC BASIC program in `data` and write it tokenized to `tokenized`
+TokenizeError tokenize_buffer(const unsigned char* data, size_t length, std::vector<unsigned char>& tokenized)
 {
-	Reader reader(file);
+	Reader reader(data, length);
 
 	int last_line = -1;
 
@@ -31,7 +31,7 @@ struct TokenizeError
 	int lineNumber;
 };
 
-// Read a plain text BBC BASIC program from `file` and write it tokenized to `tokenized`
-TokenizeError tokenize_file(FILE* file, std::vector<unsigned char>& tokenized);
+// Tokenize the plain text BBC BASIC program in `data` and write it tokenized to `tokenized`
+TokenizeError tokenize_buffer(const unsigned char* data, size_t length, std::vector<unsigned char>& tokenized);
 
 #endif // TOKENIZE_H_
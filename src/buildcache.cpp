@@ -0,0 +1,585 @@
+/*************************************************************************************************/
+/**
+	buildcache.cpp
+
+
+	Copyright (C) Rich Talbot-Watkins 2007 - 2012
+
+	This file is part of BeebAsm.
+
+	BeebAsm is free software: you can redistribute it and/or modify it under the terms of the GNU
+	General Public License as published by the Free Software Foundation, either version 3 of the
+	License, or (at your option) any later version.
+
+	BeebAsm is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without
+	even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License along with BeebAsm, as
+	COPYING.txt.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/*************************************************************************************************/
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <streambuf>
+#include <vector>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#ifdef _WIN32
+#include <direct.h>
+#endif
+
+#include "buildcache.h"
+#include "filecache.h"
+#include "globaldata.h"
+#include "sha256.h"
+#include "version.h"
+
+using namespace std;
+
+
+/*************************************************************************************************/
+/**
+	TeeBuffer
+
+	The buffer behind a stream which passes everything written to it on to another stream,
+	keeping a copy
+*/
+/*************************************************************************************************/
+class TeeBuffer : public streambuf
+{
+public:
+
+	explicit TeeBuffer( ostream& target )
+		:	m_target( target ),
+			m_stream( this )
+	{
+	}
+
+	inline ostream& GetStream()				{ return m_stream; }
+	inline ostream& GetTarget() const		{ return m_target; }
+	inline const string& GetText() const	{ return m_text; }
+
+
+protected:
+
+	virtual int overflow( int c )
+	{
+		if ( traits_type::eq_int_type( c, traits_type::eof() ) )
+		{
+			return traits_type::not_eof( c );
+		}
+
+		m_text += traits_type::to_char_type( c );
+		return m_target.rdbuf()->sputc( traits_type::to_char_type( c ) );
+	}
+
+	virtual streamsize xsputn( const char* pData, streamsize length )
+	{
+		m_text.append( pData, static_cast< size_t >( length ) );
+		return m_target.rdbuf()->sputn( pData, length );
+	}
+
+	virtual int sync()
+	{
+		return m_target.rdbuf()->pubsync();
+	}
+
+
+private:
+
+	ostream&		m_target;
+	ostream			m_stream;
+	string			m_text;
+};
+
+
+thread_local BuildCache* BuildCache::m_gInstance = NULL;
+
+
+/*************************************************************************************************/
+/**
+	BuildCache::Create()
+
+	Creates the BuildCache singleton
+*/
+/*************************************************************************************************/
+void BuildCache::Create()
+{
+	assert( m_gInstance == NULL );
+
+	m_gInstance = new BuildCache;
+}
+
+
+
+/*************************************************************************************************/
+/**
+	BuildCache::Destroy()
+
+	Destroys the BuildCache singleton
+*/
+/*************************************************************************************************/
+void BuildCache::Destroy()
+{
+	assert( m_gInstance != NULL );
+
+	delete m_gInstance;
+	m_gInstance = NULL;
+}
+
+
+
+/*************************************************************************************************/
+/**
+	BuildCache::BuildCache()
+
+	BuildCache constructor
+*/
+/*************************************************************************************************/
+BuildCache::BuildCache()
+	:	m_pUncacheableReason( NULL ),
+		m_bRandomSeeded( false )
+{
+}
+
+
+
+/*************************************************************************************************/
+/**
+	BuildCache::~BuildCache()
+
+	BuildCache destructor
+*/
+/*************************************************************************************************/
+BuildCache::~BuildCache()
+{
+	StopCapture();
+}
+
+
+
+/*************************************************************************************************/
+/**
+	BuildCache::Restore()
+
+	Looks for the manifest for this command line, and if none of the files it lists as inputs
+	has changed, restores the outputs and prints what was printed
+
+	@param		argc			Number of parameters passed
+	@param		argv			Array of parameters
+
+	@return		true if the outputs were restored, so that there is no need to assemble
+*/
+/*************************************************************************************************/
+bool BuildCache::Restore( int argc, char* argv[] )
+{
+	assert( IsEnabled() );
+
+	// The manifest is named by everything about the command line except the cache itself, and
+	// the statistics, which don't change what is assembled
+
+	Sha256 key;
+	key.Update( "beebasm " VERSION );
+
+	// The directory the files are relative to, which for a server job isn't the current one
+	key.Update( FileCache::Instance().GetPath( "." ) );
+
+	for ( int i = 1; i < argc; i++ )
+	{
+		if ( strcmp( argv[ i ], "-cache" ) == 0 || strcmp( argv[ i ], "-stats" ) == 0 )
+		{
+			i++;
+			continue;
+		}
+
+		key.Update( argv[ i ] );
+	}
+
+	m_key = key.HexDigest();
+
+	ifstream manifest( GetManifestName().c_str() );
+	string line;
+
+	if ( !getline( manifest, line ) || line != MANIFEST_HEADER )
+	{
+		return false;
+	}
+
+	// Each line is the kind of entry, a digest, and for files, the filename
+
+	vector< pair< string, string > > outputs;
+	string outDigest;
+	string errDigest;
+
+	while ( getline( manifest, line ) )
+	{
+		size_t kindEnd = line.find( ' ' );
+		size_t digestEnd = ( kindEnd == string::npos ) ? string::npos : line.find( ' ', kindEnd + 1 );
+
+		if ( kindEnd == string::npos )
+		{
+			return false;
+		}
+
+		string kind = line.substr( 0, kindEnd );
+		string digest = line.substr( kindEnd + 1, digestEnd - kindEnd - 1 );
+		string filename = ( digestEnd == string::npos ) ? "" : line.substr( digestEnd + 1 );
+
+		if ( kind == "in" )
+		{
+			string currentDigest;
+
+			if ( !HashFile( filename, currentDigest ) || currentDigest != digest )
+			{
+				return false;
+			}
+		}
+		else if ( kind == "out" )
+		{
+			outputs.push_back( make_pair( filename, digest ) );
+		}
+		else if ( kind == "stdout" )
+		{
+			outDigest = digest;
+		}
+		else if ( kind == "stderr" )
+		{
+			errDigest = digest;
+		}
+		else
+		{
+			return false;
+		}
+	}
+
+	// Read everything before writing anything, in case the cache has been partly cleared
+
+	vector< string > contents( outputs.size() );
+	string outText;
+	string errText;
+
+	for ( size_t i = 0; i < outputs.size(); i++ )
+	{
+		if ( !ReadObject( outputs[ i ].second, contents[ i ] ) )
+		{
+			return false;
+		}
+	}
+
+	if ( !ReadObject( outDigest, outText ) || !ReadObject( errDigest, errText ) )
+	{
+		return false;
+	}
+
+	for ( size_t i = 0; i < outputs.size(); i++ )
+	{
+		const unsigned char* pData = reinterpret_cast< const unsigned char* >( contents[ i ].data() );
+
+		if ( FileCache::Instance().WriteFile( outputs[ i ].first, pData, contents[ i ].size() ) != FileSystem::FILE_OK )
+		{
+			return false;
+		}
+
+		GlobalData::Instance().AddOutputFile( outputs[ i ].first );
+	}
+
+	GlobalData::Instance().GetOutputStream() << outText << flush;
+	GlobalData::Instance().GetErrorStream() << errText;
+
+	if ( GlobalData::Instance().IsVerbose() )
+	{
+		GlobalData::Instance().GetErrorStream() << "Restored " << outputs.size() << ( outputs.size() == 1 ? " file" : " files" ) << " from build cache" << endl;
+	}
+
+	return true;
+}
+
+
+
+/*************************************************************************************************/
+/**
+	BuildCache::StartCapture()
+
+	Starts keeping a copy of everything the assembly writes to its output and error streams, to
+	be stored with the outputs
+*/
+/*************************************************************************************************/
+void BuildCache::StartCapture()
+{
+	GlobalData& globalData = GlobalData::Instance();
+
+	m_pOut.reset( new TeeBuffer( globalData.GetOutputStream() ) );
+	m_pErr.reset( new TeeBuffer( globalData.GetErrorStream() ) );
+
+	globalData.SetOutputStreams( m_pOut->GetStream(), m_pErr->GetStream() );
+}
+
+
+
+/*************************************************************************************************/
+/**
+	BuildCache::StopCapture()
+
+	Puts the assembly's output and error streams back as they were
+*/
+/*************************************************************************************************/
+void BuildCache::StopCapture()
+{
+	if ( m_pOut && m_pErr )
+	{
+		GlobalData::Instance().SetOutputStreams( m_pOut->GetTarget(), m_pErr->GetTarget() );
+	}
+
+	m_pOut.reset();
+	m_pErr.reset();
+}
+
+
+
+/*************************************************************************************************/
+/**
+	BuildCache::SetUncacheable()
+
+	Prevents the result of this assembly being stored
+
+	@param		pReason			What the assembly used which could change its result
+*/
+/*************************************************************************************************/
+void BuildCache::SetUncacheable( const char* pReason )
+{
+	if ( m_pUncacheableReason == NULL )
+	{
+		m_pUncacheableReason = pReason;
+	}
+}
+
+
+
+/*************************************************************************************************/
+/**
+	BuildCache::Store()
+
+	Stores the outputs of a successful assembly, along with what it printed, and writes the
+	manifest which lists them with the inputs they were made from
+*/
+/*************************************************************************************************/
+void BuildCache::Store()
+{
+	if ( !IsEnabled() )
+	{
+		return;
+	}
+
+	assert( m_pOut && m_pErr );
+
+	string outText = m_pOut->GetText();
+	string errText = m_pErr->GetText();
+
+	StopCapture();
+
+	if ( m_pUncacheableReason != NULL )
+	{
+		if ( GlobalData::Instance().IsVerbose() )
+		{
+			GlobalData::Instance().GetErrorStream() << "Not stored in build cache, as the source uses " << m_pUncacheableReason << endl;
+		}
+
+		return;
+	}
+
+#ifdef _WIN32
+	_mkdir( m_directory.c_str() );
+#else
+	mkdir( m_directory.c_str(), 0777 );
+#endif
+
+	ostringstream manifest;
+	manifest << MANIFEST_HEADER << '\n';
+
+	bool bOK = true;
+
+	const set< string >& inputs = FileCache::Instance().GetDependencies();
+
+	for ( set< string >::const_iterator it = inputs.begin(); it != inputs.end(); ++it )
+	{
+		string digest;
+
+		if ( !HashFile( *it, digest ) )
+		{
+			digest = "-";
+		}
+
+		manifest << "in " << digest << ' ' << *it << '\n';
+	}
+
+	const set< string >& outputs = GlobalData::Instance().GetOutputFiles();
+
+	for ( set< string >::const_iterator it = outputs.begin(); bOK && it != outputs.end(); ++it )
+	{
+		string contents;
+		string digest;
+
+		bOK = ReadFile( FileCache::Instance().GetPath( *it ), contents ) && WriteObject( contents, digest );
+		manifest << "out " << digest << ' ' << *it << '\n';
+	}
+
+	string outDigest;
+	string errDigest;
+
+	bOK = bOK && WriteObject( outText, outDigest ) && WriteObject( errText, errDigest );
+
+	manifest << "stdout " << outDigest << '\n';
+	manifest << "stderr " << errDigest << '\n';
+
+	// Write the manifest under another name first, so that another build never sees half of it
+
+	string manifestName = GetManifestName();
+	string tempName = manifestName + ".tmp";
+
+	if ( !bOK || !WriteFile( tempName, manifest.str() ) ||
+		 ( rename( tempName.c_str(), manifestName.c_str() ) != 0 &&
+		   ( remove( manifestName.c_str() ), rename( tempName.c_str(), manifestName.c_str() ) != 0 ) ) )
+	{
+		GlobalData::Instance().GetErrorStream() << "warning: unable to store the result in build cache " << m_directory << endl;
+	}
+}
+
+
+
+/*************************************************************************************************/
+/**
+	BuildCache::HashFile()
+
+	Gets the digest of an input file, through the FileCache so that it isn't read again when
+	assembling
+
+	@return		false if the file couldn't be read
+*/
+/*************************************************************************************************/
+bool BuildCache::HashFile( const string& filename, string& digest ) const
+{
+	shared_ptr< const FileCache::Contents > contents;
+
+	if ( FileCache::Instance().GetContents( filename, contents ) != FileSystem::FILE_OK )
+	{
+		digest = "-";
+		return false;
+	}
+
+	Sha256 hash;
+	hash.Update( contents->data(), contents->size() );
+	digest = hash.HexDigest();
+
+	return true;
+}
+
+
+
+/*************************************************************************************************/
+/**
+	BuildCache::ReadObject()
+
+	Reads a file from the cache by its digest
+*/
+/*************************************************************************************************/
+bool BuildCache::ReadObject( const string& digest, string& contents ) const
+{
+	return ReadFile( m_directory + "/" + digest, contents );
+}
+
+
+
+/*************************************************************************************************/
+/**
+	BuildCache::ReadFile()
+
+	Reads a whole file
+*/
+/*************************************************************************************************/
+bool BuildCache::ReadFile( const string& filename, string& contents ) const
+{
+	ifstream file( filename.c_str(), ios_base::in | ios_base::binary );
+
+	if ( !file )
+	{
+		return false;
+	}
+
+	ostringstream buffer;
+
+	// Copying an empty file leaves the stream failed even though it was read
+	if ( file.peek() != char_traits< char >::eof() && !( buffer << file.rdbuf() ) )
+	{
+		return false;
+	}
+
+	contents = buffer.str();
+	return true;
+}
+
+
+
+/*************************************************************************************************/
+/**
+	BuildCache::WriteObject()
+
+	Adds a file to the cache, unless a file with the same contents is already there
+
+	@param		contents		Contents of the file
+	@param		digest			Set to the name it's stored under
+*/
+/*************************************************************************************************/
+bool BuildCache::WriteObject( const string& contents, string& digest ) const
+{
+	Sha256 hash;
+	hash.Update( contents.data(), contents.size() );
+	digest = hash.HexDigest();
+
+	string filename = m_directory + "/" + digest;
+	struct stat info;
+
+	if ( stat( filename.c_str(), &info ) == 0 )
+	{
+		return true;
+	}
+
+	string tempName = filename + ".tmp";
+
+	return WriteFile( tempName, contents ) && rename( tempName.c_str(), filename.c_str() ) == 0;
+}
+
+
+
+/*************************************************************************************************/
+/**
+	BuildCache::WriteFile()
+
+	Writes a whole file
+*/
+/*************************************************************************************************/
+bool BuildCache::WriteFile( const string& filename, const string& contents ) const
+{
+	ofstream file( filename.c_str(), ios_base::out | ios_base::binary | ios_base::trunc );
+
+	return file && file.write( contents.data(), static_cast< streamsize >( contents.size() ) ) && ( file.close(), !file.fail() );
+}
+
+
+
+/*************************************************************************************************/
+/**
+	BuildCache::GetManifestName()
+
+	Gets the filename of the manifest for the current command line
+*/
+/*************************************************************************************************/
+string BuildCache::GetManifestName() const
+{
+	return m_directory + "/" + m_key + ".manifest";
+}
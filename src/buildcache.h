@@ -0,0 +1,100 @@
+/*************************************************************************************************/
+/**
+	buildcache.h
+
+
+	Copyright (C) Rich Talbot-Watkins 2007 - 2012
+
+	This file is part of BeebAsm.
+
+	BeebAsm is free software: you can redistribute it and/or modify it under the terms of the GNU
+	General Public License as published by the Free Software Foundation, either version 3 of the
+	License, or (at your option) any later version.
+
+	BeebAsm is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without
+	even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License along with BeebAsm, as
+	COPYING.txt.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/*************************************************************************************************/
+
+#ifndef BUILDCACHE_H_
+#define BUILDCACHE_H_
+
+#include <cassert>
+#include <cstdlib>
+#include <memory>
+#include <set>
+#include <string>
+
+class TeeBuffer;
+
+
+/*************************************************************************************************/
+/**
+	BuildCache
+
+	With -cache, the results of an assembly are kept in a directory, named by the SHA-256 digest
+	of their contents.  Alongside them, a manifest for the command line records the digest of
+	every file the assembly read and names the files it wrote.  The next assembly with the same
+	command line in the same directory checks those input files first, and if none of them has
+	changed, it restores the output files and what was printed instead of assembling.
+
+	An assembly which uses TIME$, or RND without a RANDOMIZE before it, isn't cached, as it
+	could give different results with the same inputs.
+*/
+/*************************************************************************************************/
+class BuildCache
+{
+public:
+
+	static void Create();
+	static void Destroy();
+	static inline BuildCache& Instance() { assert( m_gInstance != NULL ); return *m_gInstance; }
+
+	// The first line of a manifest; changing it invalidates every manifest already written
+
+	#define MANIFEST_HEADER		"beebasm-cache 1"
+
+	inline void			SetDirectory( const std::string& directory )	{ m_directory = directory; }
+	inline bool			IsEnabled() const								{ return !m_directory.empty(); }
+
+	bool				Restore( int argc, char* argv[] );
+	void				StartCapture();
+	void				Store();
+
+	// Things which make the result depend on more than the inputs
+
+	void				SetUncacheable( const char* pReason );
+	inline void			SeedRandom()								{ m_bRandomSeeded = true; }
+	inline void			UseRandom()									{ if ( !m_bRandomSeeded ) SetUncacheable( "RND without RANDOMIZE" ); }
+
+
+private:
+
+	BuildCache();
+	~BuildCache();
+
+	void				StopCapture();
+	bool				HashFile( const std::string& filename, std::string& digest ) const;
+	bool				ReadObject( const std::string& digest, std::string& contents ) const;
+	bool				ReadFile( const std::string& filename, std::string& contents ) const;
+	bool				WriteObject( const std::string& contents, std::string& digest ) const;
+	bool				WriteFile( const std::string& filename, const std::string& contents ) const;
+	std::string			GetManifestName() const;
+
+	std::string							m_directory;
+	std::string							m_key;
+	const char*							m_pUncacheableReason;
+	bool								m_bRandomSeeded;
+
+	std::unique_ptr< TeeBuffer >		m_pOut;
+	std::unique_ptr< TeeBuffer >		m_pErr;
+
+	static thread_local BuildCache*		m_gInstance;
+};
+
+
+#endif // BUILDCACHE_H_
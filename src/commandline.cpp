@@ -0,0 +1,795 @@
+/*************************************************************************************************/
+/**
+	commandline.cpp
+
+	Runs an assembly as described by a command line
+
+
+	Copyright (C) Rich Talbot-Watkins 2007 - 2012
+
+	This file is part of BeebAsm.
+
+	BeebAsm is free software: you can redistribute it and/or modify it under the terms of the GNU
+	General Public License as published by the Free Software Foundation, either version 3 of the
+	License, or (at your option) any later version.
+
+	BeebAsm is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without
+	even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License along with BeebAsm, as
+	COPYING.txt.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/*************************************************************************************************/
+
+#include <iostream>
+#include <cstring>
+#include <cstdlib>
+#include <ctime>
+#include <set>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "commandline.h"
+#include "sourcefile.h"
+#include "asmexception.h"
+#include "assemblercontext.h"
+#include "buildcache.h"
+#include "globaldata.h"
+#include "objectcode.h"
+#include "symboltable.h"
+#include "discimage.h"
+#include "filecache.h"
+#include "macro.h"
+#include "profiler.h"
+#include "random.h"
+#include "statistics.h"
+#include "tracer.h"
+#include "version.h"
+
+
+using namespace std;
+
+
+static bool WriteDependencies( const char* pFilename );
+static bool WriteStatistics( const char* pFilename, const char* pInputFile, bool bSucceeded, bool bRestoredFromCache );
+static void StartPhase( const char* pName );
+
+
+/*************************************************************************************************/
+/**
+	Assemble()
+
+	Runs one assembly with the given command line, in an AssemblerContext of its own.  The
+	FileCache must already exist on this thread, and is left holding the files which were read,
+	so that the server can reuse them for the next job.
+
+	@param		argc			Number of parameters passed
+	@param		argv			Array of parameters
+	@param		out				Stream for everything the assembly would write to stdout
+	@param		err				Stream for everything the assembly would write to stderr
+
+	@return		The exit code for the assembly
+*/
+/*************************************************************************************************/
+
+int Assemble( int argc, char* argv[], ostream& out, ostream& err )
+{
+	AssemblerContext context( out, err );
+
+	FileCache::Instance().ClearDependencies();
+
+	return AssembleWithOptions( argc, argv );
+}
+
+
+
+/*************************************************************************************************/
+/**
+	AssembleWithOptions()
+
+	Parses the command line and, if it's valid, assembles the source file in the current
+	AssemblerContext
+
+	@param		argc			Number of parameters passed
+	@param		argv			Array of parameters
+
+	@return		The exit code for the assembly
+*/
+/*************************************************************************************************/
+
+int AssembleWithOptions( int argc, char* argv[] )
+{
+	// Only for the command line; once the build cache starts capturing, the streams change
+
+	ostream& out = GlobalData::Instance().GetOutputStream();
+	ostream& err = GlobalData::Instance().GetErrorStream();
+
+	const char* pInputFile = NULL;
+	const char* pOutputFile = NULL;
+	const char* pDiscInputFile = NULL;
+	const char* pDiscOutputFile = NULL;
+	const char* pLabelsOutputFile = NULL;
+	const char* pCacheDirectory = NULL;
+	const char* pDependencyFile = NULL;
+	const char* pProfileFile = NULL;
+	const char* pStatisticsFile = NULL;
+	const char* pTraceFile = NULL;
+
+	enum STATES
+	{
+		READY,
+		WAITING_FOR_INPUT_FILENAME,
+		WAITING_FOR_OUTPUT_FILENAME,
+		WAITING_FOR_DISC_INPUT_FILENAME,
+		WAITING_FOR_DISC_OUTPUT_FILENAME,
+		WAITING_FOR_BOOT_FILENAME,
+		WAITING_FOR_DISC_OPTION,
+		WAITING_FOR_DISC_TITLE,
+		WAITING_FOR_DISC_CYCLE,
+		WAITING_FOR_SYMBOL,
+		WAITING_FOR_STRING_SYMBOL,
+		WAITING_FOR_LABELS_FILE,
+		WAITING_FOR_CACHE_DIRECTORY,
+		WAITING_FOR_DEPENDENCY_FILE,
+		WAITING_FOR_PROFILE_FILE,
+		WAITING_FOR_STATISTICS_FILE,
+		WAITING_FOR_TRACE_FILE
+
+	} state = READY;
+
+	bool bDumpSymbols = false;
+	bool bDumpAllSymbols = false;
+
+	// Parse command line parameters
+
+	for ( int i = 1; i < argc; i++ )
+	{
+		switch ( state )
+		{
+			case READY:
+
+				if ( strcmp( argv[i], "-i" ) == 0 )
+				{
+					state = WAITING_FOR_INPUT_FILENAME;
+				}
+				else if ( strcmp( argv[i], "-o" ) == 0 )
+				{
+					state = WAITING_FOR_OUTPUT_FILENAME;
+				}
+				else if ( strcmp( argv[i], "-do" ) == 0 )
+				{
+					state = WAITING_FOR_DISC_OUTPUT_FILENAME;
+				}
+				else if ( strcmp( argv[i], "-di" ) == 0 )
+				{
+					state = WAITING_FOR_DISC_INPUT_FILENAME;
+				}
+				else if ( strcmp( argv[i], "-boot" ) == 0 )
+				{
+					state = WAITING_FOR_BOOT_FILENAME;
+				}
+				else if ( strcmp( argv[i], "-labels" ) == 0 )
+				{
+					state = WAITING_FOR_LABELS_FILE;
+				}
+				else if ( strcmp( argv[i], "-deps" ) == 0 )
+				{
+					state = WAITING_FOR_DEPENDENCY_FILE;
+				}
+				else if ( strcmp( argv[i], "-cache" ) == 0 )
+				{
+					state = WAITING_FOR_CACHE_DIRECTORY;
+				}
+				else if ( strcmp( argv[i], "-profile" ) == 0 )
+				{
+#ifdef BEEBASM_PROFILER
+					state = WAITING_FOR_PROFILE_FILE;
+#else
+					err << "-profile is only available when beebasm is built with BEEBASM_PROFILER defined" << endl;
+					return EXIT_FAILURE;
+#endif
+				}
+				else if ( strcmp( argv[i], "-stats" ) == 0 )
+				{
+					state = WAITING_FOR_STATISTICS_FILE;
+				}
+				else if ( strcmp( argv[i], "-trace" ) == 0 )
+				{
+					state = WAITING_FOR_TRACE_FILE;
+				}
+				else if ( strcmp( argv[i], "-opt" ) == 0 )
+				{
+					state = WAITING_FOR_DISC_OPTION;
+				}
+				else if ( strcmp( argv[i], "-title" ) == 0 )
+				{
+					state = WAITING_FOR_DISC_TITLE;
+				}
+				else if ( strcmp( argv[i], "-cycle" ) == 0 )
+				{
+					state = WAITING_FOR_DISC_CYCLE;
+				}
+				else if ( strcmp( argv[i], "-w" ) == 0 )
+				{
+					GlobalData::Instance().SetRequireDistinctOpcodes( true );
+				}
+				else if ( strcmp( argv[i], "-vc" ) == 0 )
+				{
+					GlobalData::Instance().SetUseVisualCppErrorFormat( true );
+				}
+				else if ( strcmp( argv[i], "-relax" ) == 0 )
+				{
+					GlobalData::Instance().SetRelaxLayout( true );
+				}
+				else if ( strcmp( argv[i], "-v" ) == 0 )
+				{
+					GlobalData::Instance().SetVerbose( true );
+				}
+				else if ( strcmp( argv[i], "-cycles" ) == 0 )
+				{
+					GlobalData::Instance().SetShowCycles( true );
+				}
+				else if ( strcmp( argv[i], "-q" ) == 0 )
+				{
+					GlobalData::Instance().SetVerbose( false );
+				}
+				else if ( strcmp( argv[i], "-d" ) == 0 )
+				{
+					bDumpSymbols = true;
+				}
+				else if ( strcmp( argv[i], "-dd" ) == 0 )
+				{
+					bDumpAllSymbols = true;
+				}
+				else if ( strcmp( argv[i], "-D" ) == 0 )
+				{
+					state = WAITING_FOR_SYMBOL;
+				}
+				else if ( strcmp( argv[i], "-S" ) == 0 )
+				{
+					state = WAITING_FOR_STRING_SYMBOL;
+				}
+				else if ( ( strcmp( argv[i], "--help" ) == 0 ) ||
+					  ( strcmp( argv[i], "-help" ) == 0 ) ||
+					  ( strcmp( argv[i], "-h" ) == 0 ) )
+				{
+					out << "beebasm " VERSION << endl << endl;
+					out << "Possible options:" << endl;
+					out << " -i <file>      Specify source filename" << endl;
+					out << " -o <file>      Specify output filename (when not specified by SAVE command)" << endl;
+					out << " -di <file>     Specify a disc image file to be added to" << endl;
+					out << " -do <file>     Specify a disc image file to output" << endl;
+					out << " -boot <file>   Specify a filename to be run by !BOOT on a new disc image" << endl;
+					out << " -labels <file> Specify a filename to export any labels dumped with -d or -dd to" << endl;
+					out << " -deps <file>   Write a makefile rule making the files written depend on the files read" << endl;
+					out << " -cache <dir>   Reuse the outputs of a previous assembly whose inputs are unchanged" << endl;
+#ifdef BEEBASM_PROFILER
+					out << " -profile <file>" << endl;
+					out << "                Write the time spent on each source line to a file, and list" << endl;
+					out << "                the hottest lines" << endl;
+#endif
+					out << " -stats <file>  Write what the assembly did in each pass, and how long it took, to a" << endl;
+					out << "                file as JSON" << endl;
+					out << " -trace <file>  Write a timeline of the assembly to a file, for chrome://tracing or" << endl;
+					out << "                Perfetto" << endl;
+					out << " -opt <opt>     Specify the *OPT 4,n for the generated disc image" << endl;
+					out << " -title <title> Specify the title for the generated disc image" << endl;
+					out << " -cycle <n>     Specify the cycle for the generated disc image" << endl;
+					out << " -v             Verbose output" << endl;
+					out << " -cycles        Show the cycles each instruction takes in the verbose output, and" << endl;
+					out << "                the cycles since the last label" << endl;
+					out << " -d             Dump all global symbols after assembly" << endl;
+					out << " -dd            Dump all global and local symbols after assembly" << endl;
+					out << " -w             Require whitespace between opcodes and labels" << endl;
+					out << " -vc            Use Visual C++-style error messages" << endl;
+					out << " -relax         Repeat the first pass until all labels settle, so that forward" << endl;
+					out << "                references to zero page use zero page addressing" << endl;
+					out << " -D <sym>=<val> Define numeric symbol prior to assembly" << endl;
+					out << " -S <sym>=<str> Define string symbol prior to assembly" << endl;
+					out << " --help         See this help again" << endl;
+					out << endl;
+					out << "beebasm --watch <options>" << endl;
+					out << "                Assemble, and again whenever any file read changes" << endl;
+					out << "beebasm --server <socket>" << endl;
+					out << "                Run as a server, assembling jobs sent to the socket with the" << endl;
+					out << "                files read by previous jobs still cached" << endl;
+					out << "beebasm --client <socket> <options>" << endl;
+					out << "                Have the server listening on the socket assemble with the" << endl;
+					out << "                options, as if run in the current directory" << endl;
+					return EXIT_SUCCESS;
+				}
+				else
+				{
+					err << "Bad parameter: " << argv[i] << endl;
+					err << "Type beebasm --help for options" << endl;
+					return EXIT_FAILURE;
+				}
+				break;
+
+
+			case WAITING_FOR_INPUT_FILENAME:
+
+				pInputFile = argv[i];
+				state = READY;
+				break;
+
+
+			case WAITING_FOR_OUTPUT_FILENAME:
+
+				pOutputFile = argv[i];
+				GlobalData::Instance().SetOutputFile( pOutputFile );
+				state = READY;
+				break;
+
+
+			case WAITING_FOR_DISC_OUTPUT_FILENAME:
+
+				pDiscOutputFile = argv[i];
+				GlobalData::Instance().SetUseDiscImage( true );
+				state = READY;
+				break;
+
+
+			case WAITING_FOR_DISC_INPUT_FILENAME:
+
+				pDiscInputFile = argv[i];
+				state = READY;
+				break;
+
+
+			case WAITING_FOR_BOOT_FILENAME:
+
+				GlobalData::Instance().SetBootFile( argv[i] );
+				state = READY;
+				break;
+
+			case WAITING_FOR_DISC_OPTION:
+
+				GlobalData::Instance().SetDiscOption( std::strtol( argv[i], NULL, 10 ) );
+				state = READY;
+				break;
+
+			case WAITING_FOR_DISC_TITLE:
+
+				if ( strlen( argv[i] ) > 12 )
+				{
+					err << "Disc title cannot be longer than 12 characters" << endl;
+					return EXIT_FAILURE;
+				}
+				GlobalData::Instance().SetDiscTitle( argv[i] );
+				state = READY;
+                                break;
+
+			case WAITING_FOR_DISC_CYCLE:
+
+				GlobalData::Instance().SetDiscCycle( std::strtol( argv[i], NULL, 10 ) );
+				state = READY;
+				break;
+
+			case WAITING_FOR_SYMBOL:
+
+				if ( ! SymbolTable::Instance().AddCommandLineSymbol( argv[i] ) )
+				{
+					err << "Invalid -D expression: " << argv[i] << endl;
+					return EXIT_FAILURE;
+				}
+				state = READY;
+				break;
+
+			case WAITING_FOR_STRING_SYMBOL:
+
+				if ( ! SymbolTable::Instance().AddCommandLineStringSymbol( argv[i] ) )
+				{
+					err << "Invalid -S expression: " << argv[i] << endl;
+					return EXIT_FAILURE;
+				}
+				state = READY;
+				break;
+
+			case WAITING_FOR_LABELS_FILE:
+
+				pLabelsOutputFile = argv[i];
+				state = READY;
+				break;
+
+
+			case WAITING_FOR_CACHE_DIRECTORY:
+
+				pCacheDirectory = argv[i];
+				state = READY;
+				break;
+
+
+			case WAITING_FOR_DEPENDENCY_FILE:
+
+				pDependencyFile = argv[i];
+				state = READY;
+				break;
+
+
+			case WAITING_FOR_PROFILE_FILE:
+
+				pProfileFile = argv[i];
+				state = READY;
+				break;
+
+
+			case WAITING_FOR_STATISTICS_FILE:
+
+				pStatisticsFile = argv[i];
+				state = READY;
+				break;
+
+
+			case WAITING_FOR_TRACE_FILE:
+
+				pTraceFile = argv[i];
+				state = READY;
+				break;
+		}
+	}
+
+	if ( state != READY )
+	{
+		err << "Parameter error -" << endl;
+		err << "Type beebasm --help for syntax" << endl;
+		return EXIT_FAILURE;
+	}
+
+	// Check parameters
+
+	if ( pInputFile == NULL )
+	{
+		err << "No source file" << endl;
+		return EXIT_FAILURE;
+	}
+
+	if ( ( pDiscInputFile != NULL && pDiscOutputFile == NULL ) ||
+		 ( pDiscInputFile != NULL && pDiscOutputFile != NULL && strcmp( pDiscInputFile, pDiscOutputFile ) == 0 ) )
+	{
+		err << "If a disc image file is provided as input, a different filename must be provided as output" << endl;
+		return EXIT_FAILURE;
+	}
+
+
+	// Note the files which are written other than by SAVE
+
+	if ( pDiscOutputFile != NULL )
+	{
+		GlobalData::Instance().AddOutputFile( pDiscOutputFile );
+	}
+
+	if ( pLabelsOutputFile != NULL && ( bDumpSymbols || bDumpAllSymbols ) )
+	{
+		GlobalData::Instance().AddOutputFile( pLabelsOutputFile );
+	}
+
+#ifdef BEEBASM_PROFILER
+	if ( pProfileFile != NULL )
+	{
+		GlobalData::Instance().AddOutputFile( pProfileFile );
+		Profiler::Instance().Enable();
+	}
+#endif
+
+	if ( pTraceFile != NULL )
+	{
+		Tracer::Instance().Enable();
+	}
+
+	// If nothing has changed since the last assembly with this command line, that's all.  When
+	// profiling or tracing, always assemble, so there's something to profile or trace.
+
+	if ( pCacheDirectory != NULL && pProfileFile == NULL && pTraceFile == NULL )
+	{
+		BuildCache& buildCache = BuildCache::Instance();
+
+		buildCache.SetDirectory( FileCache::Instance().GetPath( pCacheDirectory ) );
+
+		if ( buildCache.Restore( argc, argv ) )
+		{
+			bool bWritten = ( pDependencyFile == NULL || WriteDependencies( pDependencyFile ) );
+
+			if ( pStatisticsFile != NULL )
+			{
+				bWritten = WriteStatistics( pStatisticsFile, pInputFile, bWritten, true ) && bWritten;
+			}
+
+			return bWritten ? EXIT_SUCCESS : EXIT_FAILURE;
+		}
+
+		buildCache.StartCapture();
+	}
+
+	// All good, start the assembling
+
+	int exitCode = EXIT_SUCCESS;
+
+	time_t randomSeed = time( NULL );
+
+	DiscImage* pDiscIm = NULL;
+
+	try
+	{
+		if ( GlobalData::Instance().UsesDiscImage() )
+		{
+			pDiscIm = new DiscImage( pDiscOutputFile, pDiscInputFile );
+			GlobalData::Instance().SetDiscImage( pDiscIm );
+		}
+
+		if ( GlobalData::Instance().RelaxLayout() )
+		{
+			SymbolTable::Instance().SavePredefinedSymbols();
+		}
+
+		for ( int pass = 0; pass < 2; pass++ )
+		{
+			StartPhase( ( pass == 0 ) ? "pass1" : "pass2" );
+			GlobalData::Instance().SetPass( pass );
+			ObjectCode::Instance().InitialisePass();
+			GlobalData::Instance().ResetForId();
+			GlobalData::Instance().ResetCycleTotal();
+			beebasm_srand( static_cast< unsigned long >( randomSeed ) );
+			SourceFile input( pInputFile, 0 );
+			input.Process();
+
+			if ( pass == 0 && GlobalData::Instance().RelaxLayout() )
+			{
+				// Repeat the first pass, resolving forward references with the values from the
+				// previous attempt, until no symbol changes value.  Each repeat can only choose
+				// shorter encodings where the previous layout allows them.
+
+				int relaxPass = 1;
+				string changedSymbol;
+
+				GlobalData::Instance().SetRelaxing( true );
+
+				do
+				{
+					if ( relaxPass == MAX_RELAX_PASSES )
+					{
+						throw AsmException_LayoutNotSettled( pInputFile, changedSymbol, relaxPass );
+					}
+
+					StartPhase( "relax" );
+					SymbolTable::Instance().StartRelaxationPass();
+					MacroTable::Instance().Clear();
+					ObjectCode::Instance().InitialisePass();
+					GlobalData::Instance().ResetForId();
+					beebasm_srand( static_cast< unsigned long >( randomSeed ) );
+					SourceFile relaxInput( pInputFile, 0 );
+					relaxInput.Process();
+					relaxPass++;
+				}
+				while ( !SymbolTable::Instance().MatchesEstimates( changedSymbol ) );
+
+				SymbolTable::Instance().EndRelaxation();
+				GlobalData::Instance().SetRelaxing( false );
+
+				if ( GlobalData::Instance().IsVerbose() )
+				{
+					GlobalData::Instance().GetErrorStream() << "Layout settled after " << relaxPass << " passes" << endl;
+				}
+			}
+		}
+
+		StartPhase( "output" );
+
+		if ( pDiscIm != NULL )
+		{
+			pDiscIm->Write();
+		}
+	}
+	catch ( AsmException& e )
+	{
+		e.Print();
+		exitCode = EXIT_FAILURE;
+	}
+
+	delete pDiscIm;
+
+	if ( GlobalData::Instance().IsVerbose() )
+	{
+		GlobalData::Instance().GetErrorStream() << "File cache: " << FileCache::Instance().GetHits() << " hits, "
+			 << FileCache::Instance().GetMisses() << " misses" << endl;
+	}
+
+	if ( (bDumpSymbols || bDumpAllSymbols) && exitCode == EXIT_SUCCESS )
+	{
+		SymbolTable::Instance().Dump(bDumpSymbols, bDumpAllSymbols, pLabelsOutputFile);
+	}
+
+	if ( !GlobalData::Instance().IsSaved() && ObjectCode::Instance().AnyUsed() && exitCode == EXIT_SUCCESS )
+	{
+		GlobalData::Instance().GetErrorStream() << "warning: no SAVE command in source file." << endl;
+	}
+
+#ifdef BEEBASM_PROFILER
+	if ( pProfileFile != NULL && exitCode == EXIT_SUCCESS )
+	{
+		Profiler::Instance().PrintHottest( GlobalData::Instance().GetOutputStream(), PROFILE_TOP_LINES );
+
+		if ( !Profiler::Instance().WriteReport( pProfileFile ) )
+		{
+			GlobalData::Instance().GetErrorStream() << "Unable to write profile " << pProfileFile << endl;
+			exitCode = EXIT_FAILURE;
+		}
+	}
+#endif
+
+	if ( exitCode == EXIT_SUCCESS )
+	{
+		BuildCache::Instance().Store();
+
+		if ( pDependencyFile != NULL && !WriteDependencies( pDependencyFile ) )
+		{
+			exitCode = EXIT_FAILURE;
+		}
+	}
+
+	// Written whether or not the assembly succeeded, as they're most useful when it didn't
+
+	if ( pStatisticsFile != NULL && !WriteStatistics( pStatisticsFile, pInputFile, exitCode == EXIT_SUCCESS, false ) )
+	{
+		exitCode = EXIT_FAILURE;
+	}
+
+	if ( pTraceFile != NULL && !Tracer::Instance().Write( pTraceFile ) )
+	{
+		GlobalData::Instance().GetErrorStream() << "Unable to write trace file " << pTraceFile << endl;
+		exitCode = EXIT_FAILURE;
+	}
+
+	return exitCode;
+}
+
+
+
+/*************************************************************************************************/
+/**
+	EscapeForMake()
+
+	Escapes the characters in a filename which make would otherwise treat specially
+*/
+/*************************************************************************************************/
+
+static string EscapeForMake( const string& filename )
+{
+	string escaped;
+
+	for ( size_t i = 0; i < filename.length(); i++ )
+	{
+		char c = filename[ i ];
+
+		if ( c == ' ' || c == '#' )
+		{
+			escaped += '\\';
+		}
+		else if ( c == '$' )
+		{
+			escaped += '$';
+		}
+
+		escaped += c;
+	}
+
+	return escaped;
+}
+
+
+
+/*************************************************************************************************/
+/**
+	WriteDependencies()
+
+	Writes a makefile rule with every file written by the assembly as a target, and every file it
+	read as a prerequisite.  Like gcc -MP, an empty rule is added for each prerequisite, so that
+	make doesn't fail if one of them is deleted.
+
+	@param		pFilename		File to write the rule to
+
+	@return		false if the file couldn't be written
+*/
+/*************************************************************************************************/
+
+static bool WriteDependencies( const char* pFilename )
+{
+	const set<string>& targets = GlobalData::Instance().GetOutputFiles();
+	const set<string>& dependencies = FileCache::Instance().GetDependencies();
+
+	vector<string> prerequisites;
+
+	for ( set<string>::const_iterator it = dependencies.begin(); it != dependencies.end(); ++it )
+	{
+		if ( targets.count( *it ) == 0 )
+		{
+			prerequisites.push_back( EscapeForMake( *it ) );
+		}
+	}
+
+	ostringstream file;
+
+	if ( !targets.empty() )
+	{
+		for ( set<string>::const_iterator it = targets.begin(); it != targets.end(); ++it )
+		{
+			file << ( it == targets.begin() ? "" : " " ) << EscapeForMake( *it );
+		}
+
+		file << ":";
+
+		for ( size_t i = 0; i < prerequisites.size(); i++ )
+		{
+			file << " \\" << endl << "  " << prerequisites[ i ];
+		}
+
+		file << endl;
+	}
+
+	for ( size_t i = 0; i < prerequisites.size(); i++ )
+	{
+		file << endl << prerequisites[ i ] << ":" << endl;
+	}
+
+	const string& rule = file.str();
+
+	if ( FileCache::Instance().WriteFile( pFilename, reinterpret_cast< const unsigned char* >( rule.data() ), rule.size() ) != FileSystem::FILE_OK )
+	{
+		GlobalData::Instance().GetErrorStream() << "Unable to write dependency file " << pFilename << endl;
+		return false;
+	}
+
+	return true;
+}
+
+
+
+/*************************************************************************************************/
+/**
+	WriteStatistics()
+
+	Writes what the assembly counted, as JSON, reporting an error if the file can't be written
+
+	@param		pFilename			File to write the statistics to
+	@param		pInputFile			The source file assembled
+	@param		bSucceeded			Whether the assembly succeeded
+	@param		bRestoredFromCache	Whether the outputs were restored by -cache instead
+
+	@return		false if the file couldn't be written
+*/
+/*************************************************************************************************/
+
+static bool WriteStatistics( const char* pFilename, const char* pInputFile, bool bSucceeded, bool bRestoredFromCache )
+{
+	if ( !Statistics::Instance().Write( pFilename, pInputFile, bSucceeded, bRestoredFromCache ) )
+	{
+		GlobalData::Instance().GetErrorStream() << "Unable to write statistics file " << pFilename << endl;
+		return false;
+	}
+
+	return true;
+}
+
+
+
+/*************************************************************************************************/
+/**
+	StartPhase()
+
+	Ends the phase of the assembly in progress, and starts another, for -stats and -trace
+
+	@param		pName				Name of the new phase, e.g. "pass1"
+*/
+/*************************************************************************************************/
+
+static void StartPhase( const char* pName )
+{
+	Statistics::Instance().StartPhase( pName );
+
+	if ( Tracer::Instance().IsEnabled() )
+	{
+		Tracer::Instance().StartPhase( pName );
+	}
+}
@@ -0,0 +1,42 @@
+/*************************************************************************************************/
+/**
+	commandline.h
+
+
+	Copyright (C) Rich Talbot-Watkins 2007 - 2012
+
+	This file is part of BeebAsm.
+
+	BeebAsm is free software: you can redistribute it and/or modify it under the terms of the GNU
+	General Public License as published by the Free Software Foundation, either version 3 of the
+	License, or (at your option) any later version.
+
+	BeebAsm is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without
+	even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License along with BeebAsm, as
+	COPYING.txt.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/*************************************************************************************************/
+
+#ifndef COMMANDLINE_H_
+#define COMMANDLINE_H_
+
+#include <iosfwd>
+
+// The most times the first pass is run with -relax before giving up on the layout settling
+
+#define MAX_RELAX_PASSES	16
+
+
+// Runs one assembly with the given command line, in an AssemblerContext of its own
+
+int Assemble( int argc, char* argv[], std::ostream& out, std::ostream& err );
+
+// Runs one assembly with the given command line, in the AssemblerContext which already exists
+
+int AssembleWithOptions( int argc, char* argv[] );
+
+
+#endif // COMMANDLINE_H_
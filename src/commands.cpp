@@ -38,9 +38,12 @@
 #include "symboltable.h"
 #include "sourcefile.h"
 #include "asmexception.h"
+#include "buildcache.h"
 #include "discimage.h"
 #include "basic_tokenize.h"
 #include "random.h"
+#include "keywordtrie.h"
+#include "filecache.h"
 
 
 using namespace std;
@@ -88,13 +91,62 @@ const LineParser::Token	LineParser::m_gaTokenTable[] =
 	{ N("COPYBLOCK"),	&LineParser::HandleCopyBlock,			0 },
 	{ N("RANDOMIZE"),	&LineParser::HandleRandomize,			0 },
 	{ N("ASM"),			&LineParser::HandleAsm,					0 },
-	{ N("SOURCELINE"),  &LineParser::HandleSourceLine,          0 }
+	{ N("SOURCELINE"),  &LineParser::HandleSourceLine,          0 },
+	{ N("NOPAGECROSS"),	&LineParser::HandleNoPageCross,			0 },
+	{ N("ENDNOPAGECROSS"),	&LineParser::HandleEndNoPageCross,	0 }
 };
 
+
+
+/*************************************************************************************************/
+/**
+	LineParser::GetNumberOfTokens()
+*/
+/*************************************************************************************************/
+int LineParser::GetNumberOfTokens()
+{
+	return static_cast<int>( sizeof m_gaTokenTable / sizeof( Token ) );
+}
+
+
+
+/*************************************************************************************************/
+/**
+	LineParser::GetTokenName()
+*/
+/*************************************************************************************************/
+const char* LineParser::GetTokenName( int token )
+{
+	assert( token >= 0 && token < GetNumberOfTokens() );
+	return m_gaTokenTable[ token ].m_pName;
+}
+
 #undef N
 
 
 
+/*************************************************************************************************/
+/**
+	LineParser::GetTokenNames()
+
+	Returns the names of the tokens in m_gaTokenTable, in table order
+*/
+/*************************************************************************************************/
+vector<const char*> LineParser::GetTokenNames()
+{
+	vector<const char*> names;
+
+	for ( int i = 0; i < static_cast<int>( sizeof m_gaTokenTable / sizeof( Token ) ); i++ )
+	{
+		assert( static_cast<size_t>( m_gaTokenTable[ i ].m_nameLength ) == strlen( m_gaTokenTable[ i ].m_pName ) );
+		names.push_back( m_gaTokenTable[ i ].m_pName );
+	}
+
+	return names;
+}
+
+
+
 /*************************************************************************************************/
 /**
 	LineParser::GetTokenAndAdvanceColumn()
@@ -111,37 +163,30 @@ const LineParser::Token	LineParser::m_gaTokenTable[] =
 /*************************************************************************************************/
 int LineParser::GetTokenAndAdvanceColumn()
 {
-	size_t remaining = m_line.length() - m_column;
+	static const KeywordTrie tokenTrie( GetTokenNames() );
 
-	for ( int i = 0; i < static_cast<int>( sizeof m_gaTokenTable / sizeof( Token ) ); i++ )
-	{
-		const char*	token	= m_gaTokenTable[ i ].m_pName;
-		size_t		len		= m_gaTokenTable[ i ].m_nameLength;
-		assert( len == strlen( token ) );
+	KeywordTrie::Match matches[ MAX_KEYWORD_MATCHES ];
+	int matchCount = tokenTrie.FindPrefixes( m_line, m_column, matches );
 
-		if (len <= remaining)
-		{
-			// see if token matches
+	// Tokens earlier in the table take priority, e.g. SKIPTO is listed before SKIP
 
-			bool bMatch = true;
-			for ( unsigned int j = 0; j < len; j++ )
-			{
-				if ( token[ j ] != Ascii::ToUpper( m_line[ m_column + j ] ) )
-				{
-					bMatch = false;
-					break;
-				}
-			}
+	int best = -1;
 
-			if ( bMatch )
-			{
-				m_column += len;
-				return i;
-			}
+	for ( int i = 0; i < matchCount; i++ )
+	{
+		if ( best == -1 || matches[ i ].m_index < matches[ best ].m_index )
+		{
+			best = i;
 		}
 	}
 
-	return -1;
+	if ( best == -1 )
+	{
+		return -1;
+	}
+
+	m_column += matches[ best ].m_length;
+	return matches[ best ].m_index;
 }
 
 
@@ -518,6 +563,8 @@ void LineParser::HandleDefineLabel()
 			{
 				SymbolTable::Instance().AddSymbol( fullSymbolName, ObjectCode::Instance().GetPC(), true );
 			}
+
+			ObjectCode::Instance().NoteLabel();
 		}
 		else
 		{
@@ -534,7 +581,8 @@ void LineParser::HandleDefineLabel()
 
 		if ( m_sourceCode->ShouldOutputAsm() )
 		{
-			cout << "." << symbolName << endl;
+			GlobalData::Instance().GetOutputStream() << "." << symbolName << endl;
+			GlobalData::Instance().ResetCycleTotal();
 		}
 	}
 	else
@@ -599,7 +647,6 @@ void LineParser::HandleOrg()
 	args.CheckComplete();
 
 	ObjectCode::Instance().SetPC( newPC );
-	SymbolTable::Instance().ChangeBuiltInSymbol( "P%", newPC );
 }
 
 
@@ -713,6 +760,9 @@ void LineParser::HandleAlign()
 		throw AsmException_SyntaxError_BadAlignment( m_line, oldColumn );
 	}
 
+	// The padding isn't part of the table before it
+	ObjectCode::Instance().EndTable();
+
 	while ( ( ObjectCode::Instance().GetPC() & ( val - 1 ) ) != 0 )
 	{
 		try
@@ -753,8 +803,9 @@ void LineParser::HandleSkip()
 
 	if ( m_sourceCode->ShouldOutputAsm() )
 	{
-		cout << uppercase << hex << setfill( '0' ) << "     ";
-		cout << setw(4) << ObjectCode::Instance().GetPC() << endl;
+		ostream& out = GlobalData::Instance().GetOutputStream();
+		out << uppercase << hex << setfill( '0' ) << "     ";
+		out << setw(4) << ObjectCode::Instance().GetPC() << endl;
 	}
 
 	for ( int i = 0; i < val; i++ )
@@ -796,6 +847,9 @@ void LineParser::HandleSkipTo()
 		throw AsmException_SyntaxError_BackwardsSkip( m_line, addr.Column() );
 	}
 
+	// The padding isn't part of the table before it
+	ObjectCode::Instance().EndTable();
+
 	while ( ObjectCode::Instance().GetPC() < addr )
 	{
 		try
@@ -830,7 +884,7 @@ void LineParser::HandleInclude()
 
 	if ( m_sourceCode->ShouldOutputAsm() )
 	{
-		cerr << "Including file " << filename << endl;
+		GlobalData::Instance().GetErrorStream() << "Including file " << filename << endl;
 	}
 
 	SourceFile input( filename.c_str(), m_sourceCode );
@@ -851,18 +905,58 @@ void LineParser::HandleInclude()
 /*************************************************************************************************/
 void LineParser::HandleIncBin()
 {
-	string filename = EvaluateExpressionAsString();
+	// Syntax:
+	// INCBIN <filename> [, <offset> [, <length>]]
+
+	ArgListParser args(*this);
+
+	string filename = args.ParseString();
+	IntArg offset = args.ParseInt().Default(0);
+	IntArg length = args.ParseInt();
+
+	args.CheckComplete();
+
+	shared_ptr<const FileCache::Contents> contents;
+
+	try
+	{
+		switch ( FileCache::Instance().GetContents( filename, contents ) )
+		{
+			case FileSystem::FILE_OPEN_ERROR:
+				throw AsmException_AssembleError_FileOpen();
+
+			case FileSystem::FILE_READ_ERROR:
+			case FileSystem::FILE_WRITE_ERROR:
+				throw AsmException_AssembleError_FileRead();
+
+			case FileSystem::FILE_OK:
+				break;
+		}
+	}
+	catch ( AsmException_AssembleError& e )
+	{
+		e.SetString( m_line );
+		e.SetColumn( m_column );
+		throw;
+	}
+
+	// The slice to include must lie within the file
+
+	int fileSize = static_cast<int>( min<size_t>( contents->size(), 0x7FFFFFFF ) );
+	int sliceOffset = offset.Range( 0, fileSize );
+	int sliceLength = length.Default( fileSize - sliceOffset ).Range( 0, fileSize - sliceOffset );
+	const unsigned char* slice = contents->data() + sliceOffset;
 
 	if ( m_sourceCode->ShouldOutputAsm() )
 	{
-		cout << uppercase << hex << setfill( '0' ) << "     ";
-		cout << setw(4) << ObjectCode::Instance().GetPC() << "   ";
+		ostream& out = GlobalData::Instance().GetOutputStream();
+		out << uppercase << hex << setfill( '0' ) << "     ";
+		out << setw(4) << ObjectCode::Instance().GetPC() << "   ";
 	}
 
-	std::vector<unsigned char> firstFour;
 	try
 	{
-		ObjectCode::Instance().IncBin( filename.c_str(), firstFour );
+		ObjectCode::Instance().IncBin( slice, sliceLength );
 	}
 	catch ( AsmException_AssembleError& e )
 	{
@@ -873,32 +967,28 @@ void LineParser::HandleIncBin()
 
 	if ( m_sourceCode->ShouldOutputAsm() )
 	{
+		ostream& out = GlobalData::Instance().GetOutputStream();
 		size_t count = 0;
-		for ( size_t i = 0; i < firstFour.size(); i++ )
+		for ( int i = 0; i < min( sliceLength, 4 ); i++ )
 		{
 			if ( i < 3 )
 			{
-				cout << setw(2) << static_cast<int>(firstFour[i]) << " ";
+				out << setw(2) << static_cast<int>(slice[i]) << " ";
 				count += 3;
 			}
 			else if ( i == 3 )
 			{
-				cout << "... ";
+				out << "... ";
 				count += 4;
 			}
 		}
 		while (count < 11)
 		{
-			cout << " ";
+			out << " ";
 			++count;
 		}
-		cout << "INCBIN \"" << filename << '"';
-		cout << endl << nouppercase << dec << setfill( ' ' );
-	}
-
-	if ( AdvanceAndCheckEndOfStatement() )
-	{
-		throw AsmException_SyntaxError_InvalidCharacter( m_line, m_column );
+		out << "INCBIN \"" << filename << '"';
+		out << endl << nouppercase << dec << setfill( ' ' );
 	}
 }
 
@@ -934,10 +1024,11 @@ void LineParser::HandleEqub()
 
 			if ( m_sourceCode->ShouldOutputAsm() )
 			{
-				cout << uppercase << hex << setfill( '0' ) << "     ";
-				cout << setw(4) << ObjectCode::Instance().GetPC() << "   ";
-				cout << setw(2) << ( number & 0xFF );
-				cout << endl << nouppercase << dec << setfill( ' ' );
+				ostream& out = GlobalData::Instance().GetOutputStream();
+				out << uppercase << hex << setfill( '0' ) << "     ";
+				out << setw(4) << ObjectCode::Instance().GetPC() << "   ";
+				out << setw(2) << ( number & 0xFF );
+				out << endl << nouppercase << dec << setfill( ' ' );
 			}
 
 			try
@@ -979,8 +1070,9 @@ void LineParser::HandleEqus( const String& equs )
 {
 	if ( m_sourceCode->ShouldOutputAsm() )
 	{
-		cout << uppercase << hex << setfill( '0' ) << "     ";
-		cout << setw(4) << ObjectCode::Instance().GetPC() << "   ";
+		ostream& out = GlobalData::Instance().GetOutputStream();
+		out << uppercase << hex << setfill( '0' ) << "     ";
+		out << setw(4) << ObjectCode::Instance().GetPC() << "   ";
 	}
 
 	for ( size_t i = 0; i < equs.Length(); i++ )
@@ -989,13 +1081,14 @@ void LineParser::HandleEqus( const String& equs )
 
 		if ( m_sourceCode->ShouldOutputAsm() )
 		{
+			ostream& out = GlobalData::Instance().GetOutputStream();
 			if ( i < 3 )
 			{
-				cout << setw(2) << mappedchar << " ";
+				out << setw(2) << mappedchar << " ";
 			}
 			else if ( i == 3 )
 			{
-				cout << "...";
+				out << "...";
 			}
 		}
 
@@ -1014,7 +1107,7 @@ void LineParser::HandleEqus( const String& equs )
 
 	if ( m_sourceCode->ShouldOutputAsm() )
 	{
-		cout << endl << nouppercase << dec << setfill( ' ' );
+		GlobalData::Instance().GetOutputStream() << endl << nouppercase << dec << setfill( ' ' );
 	}
 }
 
@@ -1035,11 +1128,12 @@ void LineParser::HandleEquw()
 	{
 		if ( m_sourceCode->ShouldOutputAsm() )
 		{
-			cout << uppercase << hex << setfill( '0' ) << "     ";
-			cout << setw(4) << ObjectCode::Instance().GetPC() << "   ";
-			cout << setw(2) << ( value & 0xFF ) << " ";
-			cout << setw(2) << ( ( value & 0xFF00 ) >> 8 );
-			cout << endl << nouppercase << dec << setfill( ' ' );
+			ostream& out = GlobalData::Instance().GetOutputStream();
+			out << uppercase << hex << setfill( '0' ) << "     ";
+			out << setw(4) << ObjectCode::Instance().GetPC() << "   ";
+			out << setw(2) << ( value & 0xFF ) << " ";
+			out << setw(2) << ( ( value & 0xFF00 ) >> 8 );
+			out << endl << nouppercase << dec << setfill( ' ' );
 		}
 
 		try
@@ -1082,13 +1176,14 @@ void LineParser::HandleEqud()
 	{
 		if ( m_sourceCode->ShouldOutputAsm() )
 		{
-			cout << uppercase << hex << setfill( '0' ) << "     ";
-			cout << setw(4) << ObjectCode::Instance().GetPC() << "   ";
-			cout << setw(2) << ( value & 0xFF ) << " ";
-			cout << setw(2) << ( ( value & 0xFF00 ) >> 8 ) << " ";
-			cout << setw(2) << ( ( value & 0xFF0000 ) >> 16 ) << " ";
-			cout << setw(2) << ( ( value & 0xFF000000 ) >> 24 );
-			cout << endl << nouppercase << dec << setfill( ' ' );
+			ostream& out = GlobalData::Instance().GetOutputStream();
+			out << uppercase << hex << setfill( '0' ) << "     ";
+			out << setw(4) << ObjectCode::Instance().GetPC() << "   ";
+			out << setw(2) << ( value & 0xFF ) << " ";
+			out << setw(2) << ( ( value & 0xFF00 ) >> 8 ) << " ";
+			out << setw(2) << ( ( value & 0xFF0000 ) >> 16 ) << " ";
+			out << setw(2) << ( ( value & 0xFF000000 ) >> 24 );
+			out << endl << nouppercase << dec << setfill( ' ' );
 		}
 
 		try
@@ -1224,7 +1319,7 @@ void LineParser::HandleSave()
 
 	if ( m_sourceCode->ShouldOutputAsm() )
 	{
-		cout << "Saving file '" << saveFile << "'" << endl;
+		GlobalData::Instance().GetOutputStream() << "Saving file '" << saveFile << "'" << endl;
 	}
 
 	// OK - do it
@@ -1243,21 +1338,20 @@ void LineParser::HandleSave()
 		else
 		{
 			// regular save
-			ofstream objFile;
+			FileSystem::STATUS status = FileCache::Instance().WriteFile( saveFile,
+																		 ObjectCode::Instance().GetAddr( start ),
+																		 static_cast< size_t >( end - start ) );
 
-			objFile.open( saveFile.c_str(), ios_base::out | ios_base::binary | ios_base::trunc );
-
-			if ( !objFile )
+			if ( status == FileSystem::FILE_OPEN_ERROR )
 			{
 				throw AsmException_FileError_OpenObj( saveFile );
 			}
-
-			if ( !objFile.write( reinterpret_cast< const char* >( ObjectCode::Instance().GetAddr( start ) ), end - start ) )
+			else if ( status != FileSystem::FILE_OK )
 			{
 				throw AsmException_FileError_WriteObj( saveFile );
 			}
 
-			objFile.close();
+			GlobalData::Instance().AddOutputFile( saveFile );
 		}
 
 		GlobalData::Instance().SetSaved();
@@ -1402,6 +1496,7 @@ void LineParser::HandleIf()
 /*************************************************************************************************/
 void LineParser::HandlePrint()
 {
+	ostream& out = GlobalData::Instance().GetOutputStream();
 	bool bDemandComma = false;
 
 	while ( AdvanceAndCheckEndOfStatement() )
@@ -1441,7 +1536,7 @@ void LineParser::HandlePrint()
 
 			if ( GlobalData::Instance().IsSecondPass() )
 			{
-				cout << hex << uppercase << "&" << value << dec << nouppercase << " ";
+				out << hex << uppercase << "&" << value << dec << nouppercase << " ";
 			}
 		}
 		else
@@ -1456,7 +1551,7 @@ void LineParser::HandlePrint()
 			{
 				if ( !GlobalData::Instance().IsFirstPass() )
 				{
-					cout << StringUtils::FormattedErrorLocation( m_sourceCode->GetFilename(), m_sourceCode->GetLineNumber() );
+					out << StringUtils::FormattedErrorLocation( m_sourceCode->GetFilename(), m_sourceCode->GetLineNumber() );
 				}
 				m_column += filelineKeywordLength ;
 			}
@@ -1464,10 +1559,10 @@ void LineParser::HandlePrint()
 			{
 				if ( !GlobalData::Instance().IsFirstPass() )
 				{
-					cout << StringUtils::FormattedErrorLocation( m_sourceCode->GetFilename(), m_sourceCode->GetLineNumber() );
+					out << StringUtils::FormattedErrorLocation( m_sourceCode->GetFilename(), m_sourceCode->GetLineNumber() );
 					for ( const SourceCode* s = m_sourceCode->GetParent(); s; s = s->GetParent() )
 					{
-						cout << endl << StringUtils::FormattedErrorLocation( s->GetFilename(), s->GetLineNumber() );
+						out << endl << StringUtils::FormattedErrorLocation( s->GetFilename(), s->GetLineNumber() );
 					}
 				}
 				m_column += callstackKeywordLength;
@@ -1494,8 +1589,8 @@ void LineParser::HandlePrint()
 				{
 					if (value.GetType() == Value::NumberValue)
 					{
-						StringUtils::PrintNumber(cout, value.GetNumber());
-						cout << " ";
+						StringUtils::PrintNumber(out, value.GetNumber());
+						out << " ";
 					}
 					else if (value.GetType() == Value::StringValue)
 					{
@@ -1503,7 +1598,7 @@ void LineParser::HandlePrint()
 						const char* pstr = text.Text();
 						for (unsigned int i = 0; i != text.Length(); ++i)
 						{
-							cout << *pstr;
+							out << *pstr;
 							++pstr;
 						}
 					}
@@ -1514,7 +1609,7 @@ void LineParser::HandlePrint()
 
 	if ( GlobalData::Instance().IsSecondPass() )
 	{
-		cout << endl;
+		out << endl;
 	}
 }
 
@@ -1565,10 +1660,9 @@ void LineParser::HandlePutFileCommon( bool bText )
 
 	if ( GlobalData::Instance().IsSecondPass() )
 	{
-		ifstream inputFile;
-		inputFile.open( hostFilename.c_str(), ios_base::in | ios_base::binary );
+		shared_ptr<const FileCache::Contents> contents;
 
-		if ( !inputFile )
+		if ( FileCache::Instance().GetContents( hostFilename, contents ) != FileSystem::FILE_OK )
 		{
 			AsmException_AssembleError_FileOpen e;
 			e.SetString( m_line );
@@ -1576,53 +1670,46 @@ void LineParser::HandlePutFileCommon( bool bText )
 			throw e;
 		}
 
-		inputFile.seekg( 0, ios_base::end );
-		size_t fileSize = static_cast< size_t >( inputFile.tellg() );
-		inputFile.seekg( 0, ios_base::beg );
+		std::vector<unsigned char> text;
+		const FileCache::Contents* buffer = contents.get();
 
-		char* buffer = new char[ fileSize ];
 		if ( bText )
 		{
-			fileSize = 0;
-			int c;
-			while ( ( c = inputFile.get() ) != EOF )
+			text.reserve( contents->size() );
+
+			for ( size_t i = 0; i < contents->size(); i++ )
 			{
+				unsigned char c = ( *contents )[ i ];
+
 				if ( c == '\n' || c == '\r' )
 				{
 					// swallow other half of CRLF/LFCR, if present
-					int other_half = ( c == '\n' ) ? '\r' : '\n';
-					std::streampos p = inputFile.tellg();
-					if ( inputFile.get() != other_half )
+					unsigned char other_half = ( c == '\n' ) ? '\r' : '\n';
+					if ( i + 1 < contents->size() && ( *contents )[ i + 1 ] == other_half )
 					{
-						inputFile.seekg( p );
+						i++;
 					}
 
-					buffer[ fileSize ] = '\r';
+					text.push_back( '\r' );
 				}
 				else
 				{
-					buffer[ fileSize ] = c;
+					text.push_back( c );
 				}
-				++fileSize;
 			}
+
+			buffer = &text;
 		}
-		else
-		{
-			inputFile.read( buffer, fileSize );
-		}
-		inputFile.close();
 
 		if ( GlobalData::Instance().UsesDiscImage() )
 		{
 			// disc image version of the save
 			GlobalData::Instance().GetDiscImage()->AddFile( beebFilename.c_str(),
-															reinterpret_cast< unsigned char* >( buffer ),
+															buffer->data(),
 															start,
 															exec,
-															fileSize );
+															buffer->size() );
 		}
-
-		delete [] buffer;
 	}
 }
 
@@ -1642,8 +1729,8 @@ void LineParser::HandlePutBasic()
 	if ( GlobalData::Instance().IsSecondPass() &&
 		 GlobalData::Instance().UsesDiscImage() )
 	{
-		FILE* basic_file = fopen(hostFilename.c_str(), "rb");
-		if (!basic_file)
+		shared_ptr<const FileCache::Contents> contents;
+		if ( FileCache::Instance().GetContents( hostFilename, contents ) != FileSystem::FILE_OK )
 		{
 			AsmException_AssembleError_FileOpen e;
 			e.SetString( m_line );
@@ -1651,8 +1738,7 @@ void LineParser::HandlePutBasic()
 			throw e;
 		}
 		std::vector<unsigned char> tokenized;
-		TokenizeError err = tokenize_file(basic_file, tokenized);
-		fclose(basic_file);
+		TokenizeError err = tokenize_buffer(contents->data(), contents->size(), tokenized);
 		if (err.IsError())
 		{
 			std::stringstream message;
@@ -1851,6 +1937,7 @@ void LineParser::HandleRandomize()
 	}
 
 	beebasm_srand( value );
+	BuildCache::Instance().SeedRandom();
 
 	if ( m_column < m_line.length() && m_line[ m_column ] == ',' )
 	{
@@ -1914,3 +2001,42 @@ void LineParser::HandleSourceLine()
 		m_sourceCode->SetFileName(static_cast<string>(fileParam));
 	}
 }
+
+
+
+/*************************************************************************************************/
+/**
+	LineParser::HandleNoPageCross()
+
+	Starts a block in which no branch may cross a page, and no indexed access may be made to a
+	table which spans a page, as either would take an extra cycle
+*/
+/*************************************************************************************************/
+void LineParser::HandleNoPageCross()
+{
+	if ( AdvanceAndCheckEndOfStatement() )
+	{
+		// found something
+		throw AsmException_SyntaxError_InvalidCharacter( m_line, m_column );
+	}
+
+	m_sourceCode->StartNoPageCross( m_line, m_tokenColumn );
+}
+
+
+
+/*************************************************************************************************/
+/**
+	LineParser::HandleEndNoPageCross()
+*/
+/*************************************************************************************************/
+void LineParser::HandleEndNoPageCross()
+{
+	if ( AdvanceAndCheckEndOfStatement() )
+	{
+		// found something
+		throw AsmException_SyntaxError_InvalidCharacter( m_line, m_column );
+	}
+
+	m_sourceCode->EndNoPageCross( m_line, m_tokenColumn );
+}
@@ -25,8 +25,10 @@
 #include <sstream>
 #include "discimage.h"
 #include "asmexception.h"
+#include "filecache.h"
 #include "globaldata.h"
 #include "stringutils.h"
+#include "tracer.h"
 
 using namespace std;
 
@@ -41,32 +43,33 @@ using namespace std;
 DiscImage::DiscImage( const char* pOutput, const char* pInput )
 	:	m_outputFilename( pOutput )
 {
-	// open output file
-
-	m_outputFile.open( pOutput, ios_base::out | ios_base::binary | ios_base::trunc );
-
-	if ( !m_outputFile )
-	{
-		throw AsmException_FileError_OpenDiscDest( pOutput );
-	}
-
-	// open and load input file if necessary
+	// load input file if necessary
 
 	if ( pInput != NULL )
 	{
-		m_inputFile.open( pInput, ios_base::in | ios_base::binary );
+		shared_ptr<const FileCache::Contents> contents;
 
-		if ( !m_inputFile )
+		switch ( FileCache::Instance().GetContents( pInput, contents ) )
 		{
-			throw AsmException_FileError_OpenDiscSource( pInput );
+			case FileSystem::FILE_OPEN_ERROR:
+				throw AsmException_FileError_OpenDiscSource( pInput );
+
+			case FileSystem::FILE_READ_ERROR:
+			case FileSystem::FILE_WRITE_ERROR:
+				throw AsmException_FileError_ReadDiscSource( pInput );
+
+			case FileSystem::FILE_OK:
+				break;
 		}
 
-		if ( !m_inputFile.read( reinterpret_cast< char* >( m_aCatalog ), 0x200 ) )
+		if ( contents->size() < 0x200 )
 		{
 			throw AsmException_FileError_ReadDiscSource( pInput );
 		}
 
-		// copy the disc contents to the output file
+		memcpy( m_aCatalog, contents->data(), 0x200 );
+
+		// copy the disc contents to the output image
 
 		int endSectorAddr;
 
@@ -86,29 +89,13 @@ DiscImage::DiscImage( const char* pOutput, const char* pInput )
 			endSectorAddr = 2;
 		}
 
-#ifndef NDEBUG
-		m_inputFile.seekg( 0, ios::end );
-		int length = static_cast< int >( m_inputFile.tellg() );
-		m_inputFile.seekg( 0, ios::beg );
-
-		assert( length >= endSectorAddr * 0x100 );
-#endif
-
-		char sector[ 0x100 ];
-
-		for ( int sect = 0; sect < endSectorAddr; sect++ )
+		if ( contents->size() < static_cast< size_t >( endSectorAddr ) * 0x100 )
 		{
-			if ( !m_inputFile.read( sector, 0x100 ) )
-			{
-				throw AsmException_FileError_ReadDiscSource( pInput );
-			}
-
-			if ( !m_outputFile.write( sector, 0x100 ) )
-			{
-				throw AsmException_FileError_WriteDiscDest( pOutput );
-			}
+			throw AsmException_FileError_ReadDiscSource( pInput );
 		}
 
+		m_image.assign( contents->begin(), contents->begin() + endSectorAddr * 0x100 );
+
 	}
 	else
 	{
@@ -126,11 +113,7 @@ DiscImage::DiscImage( const char* pOutput, const char* pInput )
 			strncpy( reinterpret_cast< char* >( m_aCatalog + 0x100 ), title.substr(8, 4).c_str(), 4);
 		}
 
-		if ( !m_outputFile.write( reinterpret_cast< char* >( m_aCatalog ), 0x200 ) )
-		{
-			// write error
-			throw AsmException_FileError_WriteDiscDest( m_outputFilename );
-		}
+		m_image.assign( m_aCatalog, m_aCatalog + 0x200 );
 
 		// add in a boot file
 
@@ -158,16 +141,33 @@ DiscImage::DiscImage( const char* pOutput, const char* pInput )
 /*************************************************************************************************/
 DiscImage::~DiscImage()
 {
-	// write back the catalog
+}
+
+
+
+/*************************************************************************************************/
+/**
+	DiscImage::Write()
+
+	Writes out the disc image, with its catalog
+*/
+/*************************************************************************************************/
+void DiscImage::Write()
+{
+	memcpy( m_image.data(), m_aCatalog, 0x200 );
 
-	m_outputFile.seekp( 0, ios::beg );
-	if ( !m_outputFile.write( reinterpret_cast< char* >( m_aCatalog ), 0x200 ) )
+	switch ( FileCache::Instance().WriteFile( m_outputFilename, m_image.data(), m_image.size() ) )
 	{
-		// don't throw an exception in the destructor, just bear it silently..!
-	}
+		case FileSystem::FILE_OPEN_ERROR:
+			throw AsmException_FileError_OpenDiscDest( m_outputFilename );
 
-	m_outputFile.close();
-	m_inputFile.close();
+		case FileSystem::FILE_READ_ERROR:
+		case FileSystem::FILE_WRITE_ERROR:
+			throw AsmException_FileError_WriteDiscDest( m_outputFilename );
+
+		case FileSystem::FILE_OK:
+			break;
+	}
 }
 
 
@@ -179,6 +179,14 @@ DiscImage::~DiscImage()
 /*************************************************************************************************/
 void DiscImage::AddFile( const char* pName, const unsigned char* pAddr, int load, int exec, int len )
 {
+	TraceSpan span( "disc" );
+
+	if ( span.IsEnabled() )
+	{
+		span.SetName( pName );
+		span.SetArgs( "\"bytes\": " + to_string( len ) );
+	}
+
 	char dirName = '$';
 
 	if ( strlen( pName ) > 2 && pName[ 1 ] == '.' )
@@ -304,20 +312,8 @@ void DiscImage::AddFile( const char* pName, const unsigned char* pAddr, int load
 
 	// Now write the actual file
 
-	assert( static_cast< int >( m_outputFile.tellp() ) == sectorAddrOfThisFile * 0x100 );
-
-	if ( !m_outputFile.write( reinterpret_cast< const char* >( pAddr ), len ) )
-	{
-		// Write error
-		throw AsmException_FileError_WriteDiscDest( m_outputFilename );
-	}
+	assert( static_cast< int >( m_image.size() ) == sectorAddrOfThisFile * 0x100 );
 
-	while ( ( m_outputFile.tellp() & 0xFF ) != 0 )
-	{
-		if ( !m_outputFile.put( 0 ) )
-		{
-			// Write error
-			throw AsmException_FileError_WriteDiscDest( m_outputFilename );
-		}
-	}
+	m_image.insert( m_image.end(), pAddr, pAddr + len );
+	m_image.resize( static_cast< size_t >( sectorAddrOfThisFile + sectorLengthOfThisFile ) * 0x100, 0 );
 }
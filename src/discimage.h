@@ -23,7 +23,7 @@
 #ifndef DISCIMAGE_H_
 #define DISCIMAGE_H_
 
-#include <fstream>
+#include <vector>
 
 
 class DiscImage
@@ -34,12 +34,14 @@ public:
 	~DiscImage();
 
 	void AddFile( const char* pName, const unsigned char* pAddr, int load, int exec, int len );
+	void Write();
 
 
 private:
 
-	std::ofstream				m_outputFile;
-	std::ifstream				m_inputFile;
+	// The image is built up in memory, and written out once assembly has finished
+
+	std::vector<unsigned char>	m_image;
 	const char*					m_outputFilename;
 	unsigned char				m_aCatalog[ 0x200 ];
 
@@ -29,9 +29,11 @@
 #include <sstream>
 #include <iomanip>
 #include <climits>
+#include <memory>
 
 #include "lineparser.h"
 #include "asmexception.h"
+#include "buildcache.h"
 #include "symboltable.h"
 #include "globaldata.h"
 #include "objectcode.h"
@@ -40,6 +42,8 @@
 #include "constants.h"
 #include "stringutils.h"
 #include "literals.h"
+#include "sourcetext.h"
+#include "statistics.h"
 
 using namespace std;
 
@@ -137,13 +141,21 @@ const LineParser::Operator	LineParser::m_gaUnaryOperatorTable[] =
 	- a symbol (label)
 	- a special value such as * (PC)
 
+	@param		step			If not NULL, filled in with how to get the value again without
+								parsing it
+
 	@return		double
 */
 /*************************************************************************************************/
-Value LineParser::GetValue()
+Value LineParser::GetValue( CompiledExpression::Step* step )
 {
 	Value value;
 
+	if ( step != NULL )
+	{
+		step->m_type = CompiledExpression::PUSH_VALUE;
+	}
+
 	double double_value;
 	if ( Literals::ParseNumeric(m_line, m_column, double_value) )
 	{
@@ -155,6 +167,11 @@ Value LineParser::GetValue()
 
 		m_column++;
 		value = static_cast< double >( ObjectCode::Instance().GetPC() );
+
+		if ( step != NULL )
+		{
+			step->m_type = CompiledExpression::PUSH_PC;
+		}
 	}
 	else if ( m_column < m_line.length() && m_line[ m_column ] == '\'' )
 	{
@@ -215,11 +232,23 @@ Value LineParser::GetValue()
 		{
 			// Handle TIME$ with no parameters
 			value = FormatAssemblyTime("%a,%d %b %Y.%H:%M:%S");
+
+			if ( step != NULL )
+			{
+				step->m_type = CompiledExpression::PUSH_TIME;
+			}
 		}
 		else
 		{
 			// Regular symbol
 
+			if ( step != NULL )
+			{
+				step->m_type = CompiledExpression::PUSH_SYMBOL;
+				step->m_symbolColumn = oldColumn;
+				step->m_symbolName = ScopedSymbolName( symbolName );
+			}
+
 			if ( !m_sourceCode->GetSymbolValue(symbolName, value) )
 			{
 				// symbol not known
@@ -243,10 +272,34 @@ Value LineParser::GetValue()
 	LineParser::EvaluateExpression()
 
 	Evaluates an expression, and returns its value, also advancing the string pointer
+
+	If the line came from a SourceText, the expression is compiled as it is parsed, and the next
+	time it is evaluated (on the second pass, or the next iteration of a FOR loop) the compiled
+	form is used instead of parsing it again.
 */
 /*************************************************************************************************/
 Value LineParser::EvaluateExpression( bool bAllowOneMismatchedCloseBracket )
 {
+	Statistics::Count( Statistics::EXPRESSIONS );
+
+	size_t startColumn = m_column;
+	int compiledKey = 0;
+	unique_ptr<CompiledExpression> compiled;
+
+	if ( m_sourceText != NULL )
+	{
+		compiledKey = ( ( m_lineOffset + static_cast<int>( m_column ) ) << 1 ) | ( bAllowOneMismatchedCloseBracket ? 1 : 0 );
+
+		const CompiledExpression* existing = m_sourceText->GetCompiledExpression( compiledKey );
+
+		if ( existing != NULL )
+		{
+			return EvaluateCompiledExpression( *existing, bAllowOneMismatchedCloseBracket );
+		}
+
+		compiled.reset( new CompiledExpression );
+	}
+
 	// Reset stacks
 
 	m_valueStackPtr = 0;
@@ -321,10 +374,11 @@ Value LineParser::EvaluateExpression( bool bAllowOneMismatchedCloseBracket )
 				}
 
 				Value value;
+				CompiledExpression::Step step;
 
 				try
 				{
-					value = GetValue();
+					value = GetValue( compiled ? &step : NULL );
 				}
 				catch ( AsmException_SyntaxError_SymbolNotDefined& )
 				{
@@ -342,6 +396,23 @@ Value LineParser::EvaluateExpression( bool bAllowOneMismatchedCloseBracket )
 					throw;
 				}
 
+				if ( compiled )
+				{
+					step.m_column = static_cast<int>( m_column - startColumn );
+					step.m_bracketCount = bracketCount;
+
+					if ( step.m_type == CompiledExpression::PUSH_VALUE )
+					{
+						step.m_value = value;
+					}
+					else if ( step.m_type == CompiledExpression::PUSH_SYMBOL )
+					{
+						step.m_symbolColumn -= static_cast<int>( startColumn );
+					}
+
+					compiled->m_steps.push_back( step );
+				}
+
 				m_valueStack[ m_valueStackPtr++ ] = value;
 				expected = BINARY;
 			}
@@ -363,7 +434,7 @@ Value LineParser::EvaluateExpression( bool bAllowOneMismatchedCloseBracket )
 						OperatorHandler opHandler = m_operatorStack[ m_operatorStackPtr ].handler;
 						assert( opHandler != NULL );	// this should really not be possible!
 
-						( this->*opHandler )();
+						ApplyOperator( opHandler, compiled.get(), startColumn );
 					}
 				}
 				else
@@ -437,7 +508,7 @@ Value LineParser::EvaluateExpression( bool bAllowOneMismatchedCloseBracket )
 					OperatorHandler opHandler = m_operatorStack[ m_operatorStackPtr ].handler;
 					assert( opHandler != NULL );	// this means the operator has been given a precedence of < 0
 
-					( this->*opHandler )();
+					ApplyOperator( opHandler, compiled.get(), startColumn );
 				}
 
 				if ( m_operatorStackPtr == MAX_OPERATORS )
@@ -469,7 +540,7 @@ Value LineParser::EvaluateExpression( bool bAllowOneMismatchedCloseBracket )
 					OperatorHandler opHandler = m_operatorStack[ m_operatorStackPtr ].handler;
 					if ( opHandler != NULL )
 					{
-						( this->*opHandler )();
+						ApplyOperator( opHandler, compiled.get(), startColumn );
 					}
 					else
 					{
@@ -545,7 +616,7 @@ Value LineParser::EvaluateExpression( bool bAllowOneMismatchedCloseBracket )
 		}
 		else
 		{
-			( this->*opHandler )();
+			ApplyOperator( opHandler, compiled.get(), startColumn );
 		}
 	}
 
@@ -557,6 +628,107 @@ Value LineParser::EvaluateExpression( bool bAllowOneMismatchedCloseBracket )
 		throw AsmException_SyntaxError_EmptyExpression( m_line, m_column );
 	}
 
+	// The expression parsed successfully, so it can be evaluated from its compiled form next time
+
+	if ( compiled )
+	{
+		compiled->m_endColumn = static_cast<int>( m_column - startColumn );
+		m_sourceText->AddCompiledExpression( compiledKey, std::move( compiled ) );
+	}
+
+	return m_valueStack[ 0 ];
+}
+
+
+
+/*************************************************************************************************/
+/**
+	LineParser::ApplyOperator()
+
+	Applies an operator to the value stack, adding it to the compiled expression if there is one
+*/
+/*************************************************************************************************/
+void LineParser::ApplyOperator( OperatorHandler handler, CompiledExpression* compiled, size_t startColumn )
+{
+	if ( compiled != NULL )
+	{
+		CompiledExpression::Step step;
+		step.m_type = CompiledExpression::APPLY_OPERATOR;
+		step.m_column = static_cast<int>( m_column - startColumn );
+		step.m_handler = handler;
+		compiled->m_steps.push_back( step );
+	}
+
+	( this->*handler )();
+}
+
+
+
+/*************************************************************************************************/
+/**
+	LineParser::EvaluateCompiledExpression()
+
+	Evaluates a previously compiled expression starting at the current column.  The column is
+	set as it would have been while parsing the text before each operator is applied, so any
+	errors are reported exactly as EvaluateExpression would report them.
+*/
+/*************************************************************************************************/
+Value LineParser::EvaluateCompiledExpression( const CompiledExpression& compiled, bool bAllowOneMismatchedCloseBracket )
+{
+	Statistics::Count( Statistics::COMPILED_EXPRESSIONS );
+
+	size_t startColumn = m_column;
+
+	m_valueStackPtr = 0;
+
+	for ( vector<CompiledExpression::Step>::const_iterator it = compiled.m_steps.begin(); it != compiled.m_steps.end(); ++it )
+	{
+		const CompiledExpression::Step& step = *it;
+
+		m_column = startColumn + step.m_column;
+
+		switch ( step.m_type )
+		{
+			case CompiledExpression::PUSH_VALUE:
+				m_valueStack[ m_valueStackPtr++ ] = step.m_value;
+				break;
+
+			case CompiledExpression::PUSH_PC:
+				m_valueStack[ m_valueStackPtr++ ] = static_cast< double >( ObjectCode::Instance().GetPC() );
+				break;
+
+			case CompiledExpression::PUSH_TIME:
+				m_valueStack[ m_valueStackPtr++ ] = FormatAssemblyTime("%a,%d %b %Y.%H:%M:%S");
+				break;
+
+			case CompiledExpression::PUSH_SYMBOL:
+			{
+				Value value;
+
+				if ( !m_sourceCode->GetSymbolValue( step.m_symbolName, value ) )
+				{
+					AsmException_SyntaxError_SymbolNotDefined e( m_line, startColumn + step.m_symbolColumn );
+
+					if ( GlobalData::Instance().IsFirstPass() )
+					{
+						SkipExpression( step.m_bracketCount, bAllowOneMismatchedCloseBracket );
+					}
+
+					throw e;
+				}
+
+				m_valueStack[ m_valueStackPtr++ ] = value;
+				break;
+			}
+
+			case CompiledExpression::APPLY_OPERATOR:
+				( this->*step.m_handler )();
+				break;
+		}
+	}
+
+	m_column = startColumn + compiled.m_endColumn;
+
 	return m_valueStack[ 0 ];
 }
 
@@ -1419,6 +1591,8 @@ void LineParser::EvalRnd()
 		result = static_cast< double >( ConvertDoubleToInt( beebasm_rand() / ( static_cast< double >( BEEBASM_RAND_MAX ) + 1.0 ) * val ) );
 	}
 
+	BuildCache::Instance().UseRandom();
+
 	m_valueStack[ m_valueStackPtr - 1 ] = result;
 }
 
@@ -1443,10 +1617,19 @@ void LineParser::EvalTime()
 /*************************************************************************************************/
 Value LineParser::FormatAssemblyTime(const char* formatString)
 {
+	BuildCache::Instance().SetUncacheable( "TIME$" );
+
 	char timeString[256];
 	const time_t t = GlobalData::Instance().GetAssemblyTime();
-	const struct tm* t_tm = localtime( &t );
-	int length = strftime( timeString, sizeof( timeString ), formatString, t_tm );
+
+	// localtime() shares its result between threads, so use the reentrant version
+	struct tm t_tm;
+#ifdef _WIN32
+	localtime_s( &t_tm, &t );
+#else
+	localtime_r( &t, &t_tm );
+#endif
+	int length = strftime( timeString, sizeof( timeString ), formatString, &t_tm );
 	if ( length == 0 )
 	{
 		throw AsmException_SyntaxError_TimeResultTooBig( m_line, m_column );
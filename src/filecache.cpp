@@ -0,0 +1,304 @@
+/*************************************************************************************************/
+/**
+	filecache.cpp
+
+
+	Copyright (C) Rich Talbot-Watkins 2007 - 2012
+
+	This file is part of BeebAsm.
+
+	BeebAsm is free software: you can redistribute it and/or modify it under the terms of the GNU
+	General Public License as published by the Free Software Foundation, either version 3 of the
+	License, or (at your option) any later version.
+
+	BeebAsm is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without
+	even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License along with BeebAsm, as
+	COPYING.txt.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/*************************************************************************************************/
+
+#include "filecache.h"
+#include "sourcetext.h"
+#include "asmexception.h"
+#include "statistics.h"
+
+using namespace std;
+
+
+thread_local FileCache* FileCache::m_gInstance = NULL;
+
+
+/*************************************************************************************************/
+/**
+	FileCache::Create()
+
+	Creates the FileCache singleton
+
+	@param		pFileSystem		Where to read and write files, or NULL for the disk
+*/
+/*************************************************************************************************/
+void FileCache::Create( FileSystem* pFileSystem )
+{
+	assert( m_gInstance == NULL );
+
+	m_gInstance = new FileCache( pFileSystem );
+}
+
+
+
+/*************************************************************************************************/
+/**
+	FileCache::Destroy()
+
+	Destroys the FileCache singleton
+*/
+/*************************************************************************************************/
+void FileCache::Destroy()
+{
+	assert( m_gInstance != NULL );
+
+	delete m_gInstance;
+	m_gInstance = NULL;
+}
+
+
+
+/*************************************************************************************************/
+/**
+	FileCache::FileCache()
+
+	FileCache constructor
+*/
+/*************************************************************************************************/
+FileCache::FileCache( FileSystem* pFileSystem )
+	:	m_pFileSystem( ( pFileSystem != NULL ) ? pFileSystem : &m_diskFileSystem ),
+		m_hits( 0 ),
+		m_misses( 0 )
+{
+}
+
+
+
+/*************************************************************************************************/
+/**
+	FileCache::~FileCache()
+
+	FileCache destructor
+*/
+/*************************************************************************************************/
+FileCache::~FileCache()
+{
+}
+
+
+
+/*************************************************************************************************/
+/**
+	FileCache::Lookup()
+
+	Finds the cache entry for a file, reading the file if it isn't cached or has changed since
+	it was cached
+
+	@param		filename		File to look up
+	@param		entry			Set to the cache entry if the file could be read
+
+	@return		FILE_OK, or why the file couldn't be read
+*/
+/*************************************************************************************************/
+FileSystem::STATUS FileCache::Lookup( const string& filename, Entry*& entry )
+{
+	m_dependencies.insert( filename );
+
+	long long modificationTime;
+	long long size;
+
+	if ( !m_pFileSystem->GetInfo( filename, modificationTime, size ) )
+	{
+		return FileSystem::FILE_OPEN_ERROR;
+	}
+
+	string path = m_pFileSystem->GetPath( filename );
+	map< string, Entry >::iterator it = m_entries.find( path );
+
+	if ( it != m_entries.end() &&
+		 it->second.m_modificationTime == modificationTime &&
+		 it->second.m_size == size )
+	{
+		m_hits++;
+		it->second.m_bUsed = true;
+		entry = &it->second;
+		return FileSystem::FILE_OK;
+	}
+
+	m_misses++;
+	Statistics::Count( Statistics::FILES_OPENED );
+
+	shared_ptr<Contents> contents = make_shared<Contents>();
+	FileSystem::STATUS status = m_pFileSystem->Read( filename, *contents );
+
+	if ( status != FileSystem::FILE_OK )
+	{
+		return status;
+	}
+
+	Entry& newEntry = m_entries[ path ];
+	newEntry.m_modificationTime = modificationTime;
+	newEntry.m_size = size;
+	newEntry.m_contents = contents;
+	newEntry.m_sourceText.reset();
+	newEntry.m_bUsed = true;
+
+	entry = &newEntry;
+	return FileSystem::FILE_OK;
+}
+
+
+
+/*************************************************************************************************/
+/**
+	FileCache::GetContents()
+
+	Gets the raw contents of a file
+
+	@param		filename		File to read
+	@param		contents		Set to the contents of the file if it could be read
+
+	@return		FILE_OK, or why the file couldn't be read
+*/
+/*************************************************************************************************/
+FileSystem::STATUS FileCache::GetContents( const string& filename, shared_ptr<const Contents>& contents )
+{
+	Entry* entry = NULL;
+	FileSystem::STATUS status = Lookup( filename, entry );
+
+	if ( status == FileSystem::FILE_OK )
+	{
+		contents = entry->m_contents;
+	}
+
+	return status;
+}
+
+
+
+/*************************************************************************************************/
+/**
+	FileCache::GetSourceText()
+
+	Gets the normalised text of a source file.  While the file is unchanged the same SourceText
+	is returned every time, so that anything already lexed from it is reused.
+
+	@param		filename		Source file to read
+
+	If there is a problem reading the file, an AsmException will be thrown.
+*/
+/*************************************************************************************************/
+shared_ptr<SourceText> FileCache::GetSourceText( const string& filename )
+{
+	Entry* entry = NULL;
+	FileSystem::STATUS status = Lookup( filename, entry );
+
+	if ( status == FileSystem::FILE_OPEN_ERROR )
+	{
+		throw AsmException_FileError_OpenSourceFile( filename );
+	}
+	else if ( status != FileSystem::FILE_OK )
+	{
+		throw AsmException_FileError_ReadSourceFile( filename );
+	}
+
+	if ( !entry->m_sourceText )
+	{
+		const Contents& contents = *entry->m_contents;
+		entry->m_sourceText = make_shared<SourceText>( SourceText::Normalise( reinterpret_cast< const char* >( contents.data() ), contents.size() ) );
+	}
+
+	return entry->m_sourceText;
+}
+
+
+
+/*************************************************************************************************/
+/**
+	FileCache::WriteFile()
+
+	Creates or replaces a file, forgetting anything cached for it
+
+	@param		filename		File to write
+	@param		pData			What to write to it
+	@param		length			Number of bytes to write
+
+	@return		FILE_OK, or why the file couldn't be written
+*/
+/*************************************************************************************************/
+FileSystem::STATUS FileCache::WriteFile( const string& filename, const unsigned char* pData, size_t length )
+{
+	Invalidate( filename );
+
+	return m_pFileSystem->Write( filename, pData, length );
+}
+
+
+
+/*************************************************************************************************/
+/**
+	FileCache::Invalidate()
+
+	Forgets a file, so that it is read again next time even if its modification time and size
+	haven't changed - which can happen when a file is changed twice within a second on a file
+	system which only records modification times to the second
+
+	@param		filename		File which is known to have changed
+*/
+/*************************************************************************************************/
+void FileCache::Invalidate( const string& filename )
+{
+	m_entries.erase( m_pFileSystem->GetPath( filename ) );
+}
+
+
+
+/*************************************************************************************************/
+/**
+	FileCache::ClearDependencies()
+
+	Starts a new list of the files looked up, as the start of an assembly
+*/
+/*************************************************************************************************/
+void FileCache::ClearDependencies()
+{
+	m_dependencies.clear();
+
+	for ( map< string, Entry >::iterator it = m_entries.begin(); it != m_entries.end(); ++it )
+	{
+		it->second.m_bUsed = false;
+	}
+}
+
+
+
+/*************************************************************************************************/
+/**
+	FileCache::ForgetUnused()
+
+	Forgets every file which hasn't been looked up since ClearDependencies(), so that a cache
+	kept between assemblies only holds the files the last assembly used
+*/
+/*************************************************************************************************/
+void FileCache::ForgetUnused()
+{
+	for ( map< string, Entry >::iterator it = m_entries.begin(); it != m_entries.end(); )
+	{
+		if ( it->second.m_bUsed )
+		{
+			++it;
+		}
+		else
+		{
+			m_entries.erase( it++ );
+		}
+	}
+}
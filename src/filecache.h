@@ -0,0 +1,105 @@
+/*************************************************************************************************/
+/**
+	filecache.h
+
+
+	Copyright (C) Rich Talbot-Watkins 2007 - 2012
+
+	This file is part of BeebAsm.
+
+	BeebAsm is free software: you can redistribute it and/or modify it under the terms of the GNU
+	General Public License as published by the Free Software Foundation, either version 3 of the
+	License, or (at your option) any later version.
+
+	BeebAsm is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without
+	even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License along with BeebAsm, as
+	COPYING.txt.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/*************************************************************************************************/
+
+#ifndef FILECACHE_H_
+#define FILECACHE_H_
+
+#include <cassert>
+#include <cstdlib>
+#include <map>
+#include <set>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "filesystem.h"
+
+class SourceText;
+
+
+/*************************************************************************************************/
+/**
+	FileCache
+
+	Holds the contents of every file read during assembly, so that each file is read from disk
+	once however many passes, INCLUDEs, INCBINs or PUTFILEs refer to it.  Entries are kept by
+	absolute path, so that files of the same name in different directories are told apart, and
+	an entry is only reused while the file's modification time and size are unchanged.
+
+	Files are read from, and written to, the FileSystem the FileCache was created with.
+*/
+/*************************************************************************************************/
+class FileCache
+{
+public:
+
+	static void Create( FileSystem* pFileSystem = NULL );
+	static void Destroy();
+	static inline FileCache& Instance() { assert( m_gInstance != NULL ); return *m_gInstance; }
+
+	typedef std::vector<unsigned char>	Contents;
+
+	FileSystem::STATUS				GetContents( const std::string& filename, std::shared_ptr<const Contents>& contents );
+	std::shared_ptr<SourceText>		GetSourceText( const std::string& filename );
+	FileSystem::STATUS				WriteFile( const std::string& filename, const unsigned char* pData, size_t length );
+	inline std::string				GetPath( const std::string& filename )	{ return m_pFileSystem->GetPath( filename ); }
+
+	void							Invalidate( const std::string& filename );
+	void							ForgetUnused();
+
+	inline int						GetHits() const		{ return m_hits; }
+	inline int						GetMisses() const	{ return m_misses; }
+
+	// Every file looked up since ClearDependencies(), including those which couldn't be read
+
+	void							ClearDependencies();
+	inline const std::set< std::string >&	GetDependencies() const	{ return m_dependencies; }
+
+
+private:
+
+	explicit FileCache( FileSystem* pFileSystem );
+	~FileCache();
+
+	struct Entry
+	{
+		long long						m_modificationTime;
+		long long						m_size;
+		std::shared_ptr<const Contents>	m_contents;
+		std::shared_ptr<SourceText>		m_sourceText;
+		bool							m_bUsed;		// looked up since ClearDependencies()
+	};
+
+	FileSystem::STATUS				Lookup( const std::string& filename, Entry*& entry );
+
+	DiskFileSystem					m_diskFileSystem;
+	FileSystem*						m_pFileSystem;
+	std::map< std::string, Entry >	m_entries;
+	std::set< std::string >			m_dependencies;
+	int								m_hits;
+	int								m_misses;
+
+	static thread_local FileCache*	m_gInstance;
+};
+
+
+#endif // FILECACHE_H_
@@ -0,0 +1,383 @@
+/*************************************************************************************************/
+/**
+	filesystem.cpp
+
+
+	Copyright (C) Rich Talbot-Watkins 2007 - 2012
+
+	This file is part of BeebAsm.
+
+	BeebAsm is free software: you can redistribute it and/or modify it under the terms of the GNU
+	General Public License as published by the Free Software Foundation, either version 3 of the
+	License, or (at your option) any later version.
+
+	BeebAsm is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without
+	even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License along with BeebAsm, as
+	COPYING.txt.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/*************************************************************************************************/
+
+#include <fstream>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#ifdef _WIN32
+#include <cstdlib>
+#else
+#include <climits>
+#include <unistd.h>
+#endif
+
+#include "filesystem.h"
+
+using namespace std;
+
+
+
+/*************************************************************************************************/
+/**
+	DiskFileSystem::Resolve()
+
+	Gets the name by which a file can be opened, which is the filename unless it is relative and
+	a directory has been set
+
+	@param		filename		File to look at, relative to the directory
+*/
+/*************************************************************************************************/
+string DiskFileSystem::Resolve( const string& filename ) const
+{
+	if ( m_directory.empty() || filename.empty() || filename[ 0 ] == '/' )
+	{
+		return filename;
+	}
+
+#ifdef _WIN32
+	if ( filename[ 0 ] == '\\' || ( filename.size() > 1 && filename[ 1 ] == ':' ) )
+	{
+		return filename;
+	}
+#endif
+
+	return m_directory + '/' + filename;
+}
+
+
+
+/*************************************************************************************************/
+/**
+	DiskFileSystem::GetPath()
+
+	Gets the absolute path of a file, so that files with the same name in different directories
+	can be told apart
+
+	@param		filename		File to look at, relative to the directory
+
+	@return		The absolute path, or the filename if the current directory can't be found
+*/
+/*************************************************************************************************/
+string DiskFileSystem::GetPath( const string& filename )
+{
+	string resolved = Resolve( filename );
+
+#ifdef _WIN32
+	char path[ _MAX_PATH ];
+
+	return ( _fullpath( path, resolved.c_str(), sizeof path ) != NULL ) ? string( path ) : resolved;
+#else
+	if ( !resolved.empty() && resolved[ 0 ] == '/' )
+	{
+		return resolved;
+	}
+
+	char directory[ PATH_MAX ];
+
+	if ( getcwd( directory, sizeof directory ) == NULL )
+	{
+		return resolved;
+	}
+
+	return string( directory ) + '/' + resolved;
+#endif
+}
+
+
+
+/*************************************************************************************************/
+/**
+	DiskFileSystem::GetInfo()
+
+	Gets the modification time and size of a file
+
+	@param		filename		File to look at
+	@param		modificationTime	Set to the time the file was last modified, in nanoseconds
+								where the platform records them, so that two changes within the
+								same second are told apart
+	@param		size			Set to the size of the file
+
+	@return		false if the file doesn't exist
+*/
+/*************************************************************************************************/
+bool DiskFileSystem::GetInfo( const string& filename, long long& modificationTime, long long& size )
+{
+	struct stat info;
+
+	if ( stat( Resolve( filename ).c_str(), &info ) != 0 )
+	{
+		return false;
+	}
+
+#if defined( __APPLE__ )
+	modificationTime = static_cast< long long >( info.st_mtimespec.tv_sec ) * 1000000000LL + info.st_mtimespec.tv_nsec;
+#elif defined( _WIN32 )
+	modificationTime = static_cast< long long >( info.st_mtime ) * 1000000000LL;
+#else
+	modificationTime = static_cast< long long >( info.st_mtim.tv_sec ) * 1000000000LL + info.st_mtim.tv_nsec;
+#endif
+	size = static_cast< long long >( info.st_size );
+	return true;
+}
+
+
+
+/*************************************************************************************************/
+/**
+	DiskFileSystem::Read()
+
+	Reads the whole of a file
+
+	@param		filename		File to read
+	@param		contents		Set to the contents of the file
+
+	@return		FILE_OK, or why the file couldn't be read
+*/
+/*************************************************************************************************/
+FileSystem::STATUS DiskFileSystem::Read( const string& filename, vector<unsigned char>& contents )
+{
+	// we have to open in binary, due to a bug in MinGW which means that calling
+	// tellg() on a text-mode file ruins the file pointer!
+	// http://www.mingw.org/MinGWiki/index.php/Known%20Problems
+	ifstream file;
+	file.open( Resolve( filename ).c_str(), ios_base::in | ios_base::binary );
+
+	if ( !file )
+	{
+		return FILE_OPEN_ERROR;
+	}
+
+	file.seekg( 0, ios_base::end );
+	streamoff length = file.tellg();
+	file.seekg( 0, ios_base::beg );
+
+	if ( length < 0 )
+	{
+		return FILE_READ_ERROR;
+	}
+
+	contents.resize( static_cast< size_t >( length ) );
+
+	if ( length > 0 && !file.read( reinterpret_cast< char* >( contents.data() ), length ) )
+	{
+		return FILE_READ_ERROR;
+	}
+
+	return FILE_OK;
+}
+
+
+
+/*************************************************************************************************/
+/**
+	DiskFileSystem::Write()
+
+	Creates or replaces a file
+
+	@param		filename		File to write
+	@param		pData			What to write to it
+	@param		length			Number of bytes to write
+
+	@return		FILE_OK, or why the file couldn't be written
+*/
+/*************************************************************************************************/
+FileSystem::STATUS DiskFileSystem::Write( const string& filename, const unsigned char* pData, size_t length )
+{
+	ofstream file;
+	file.open( Resolve( filename ).c_str(), ios_base::out | ios_base::binary | ios_base::trunc );
+
+	if ( !file )
+	{
+		return FILE_OPEN_ERROR;
+	}
+
+	if ( !file.write( reinterpret_cast< const char* >( pData ), static_cast< streamsize >( length ) ) )
+	{
+		return FILE_WRITE_ERROR;
+	}
+
+	file.close();
+
+	return file ? FILE_OK : FILE_WRITE_ERROR;
+}
+
+
+
+/*************************************************************************************************/
+/**
+	MemoryFileSystem::MemoryFileSystem()
+
+	MemoryFileSystem constructor
+
+	@param		files			Names and contents of the files which can be read; the map must
+								outlive the MemoryFileSystem
+	@param		resolver		Called for files which aren't in the map, or empty
+*/
+/*************************************************************************************************/
+MemoryFileSystem::MemoryFileSystem( const map<string, string>& files, const Resolver& resolver )
+	:	m_files( files ),
+		m_resolver( resolver ),
+		m_nextVersion( 1 )
+{
+}
+
+
+
+/*************************************************************************************************/
+/**
+	MemoryFileSystem::Find()
+
+	Finds a file, asking the resolver for it the first time if it isn't in the map.  A file which
+	has been written is found in preference to one from the map.
+
+	@param		filename		File to find
+	@param		version			Set to a number which changes whenever the file is written
+
+	@return		The contents of the file, or NULL if there is no such file
+*/
+/*************************************************************************************************/
+const string* MemoryFileSystem::Find( const string& filename, long long& version )
+{
+	map<string, File>::const_iterator other = m_otherFiles.find( filename );
+
+	if ( other != m_otherFiles.end() )
+	{
+		version = other->second.m_version;
+		return &other->second.m_contents;
+	}
+
+	map<string, string>::const_iterator it = m_files.find( filename );
+
+	if ( it != m_files.end() )
+	{
+		version = 0;
+		return &it->second;
+	}
+
+	string contents;
+
+	if ( !m_resolver || !m_resolver( filename, contents ) )
+	{
+		return NULL;
+	}
+
+	File& file = m_otherFiles[ filename ];
+	file.m_contents.swap( contents );
+	file.m_version = 0;
+	file.m_bWritten = false;
+
+	version = 0;
+	return &file.m_contents;
+}
+
+
+
+/*************************************************************************************************/
+/**
+	MemoryFileSystem::GetPath()
+
+	Files in memory have no current directory, so their names already identify them
+*/
+/*************************************************************************************************/
+string MemoryFileSystem::GetPath( const string& filename )
+{
+	return filename;
+}
+
+
+
+/*************************************************************************************************/
+/**
+	MemoryFileSystem::GetInfo()
+*/
+/*************************************************************************************************/
+bool MemoryFileSystem::GetInfo( const string& filename, long long& modificationTime, long long& size )
+{
+	const string* pContents = Find( filename, modificationTime );
+
+	if ( pContents == NULL )
+	{
+		return false;
+	}
+
+	size = static_cast< long long >( pContents->size() );
+	return true;
+}
+
+
+
+/*************************************************************************************************/
+/**
+	MemoryFileSystem::Read()
+*/
+/*************************************************************************************************/
+FileSystem::STATUS MemoryFileSystem::Read( const string& filename, vector<unsigned char>& contents )
+{
+	long long version;
+	const string* pContents = Find( filename, version );
+
+	if ( pContents == NULL )
+	{
+		return FILE_OPEN_ERROR;
+	}
+
+	contents.assign( pContents->begin(), pContents->end() );
+	return FILE_OK;
+}
+
+
+
+/*************************************************************************************************/
+/**
+	MemoryFileSystem::Write()
+*/
+/*************************************************************************************************/
+FileSystem::STATUS MemoryFileSystem::Write( const string& filename, const unsigned char* pData, size_t length )
+{
+	File& file = m_otherFiles[ filename ];
+	file.m_contents.assign( reinterpret_cast< const char* >( pData ), length );
+	file.m_version = m_nextVersion++;
+	file.m_bWritten = true;
+
+	return FILE_OK;
+}
+
+
+
+/*************************************************************************************************/
+/**
+	MemoryFileSystem::GetWrittenFiles()
+
+	Gets the names and contents of the files which have been written
+*/
+/*************************************************************************************************/
+void MemoryFileSystem::GetWrittenFiles( map<string, string>& files ) const
+{
+	for ( map<string, File>::const_iterator it = m_otherFiles.begin(); it != m_otherFiles.end(); ++it )
+	{
+		if ( it->second.m_bWritten )
+		{
+			files[ it->first ] = it->second.m_contents;
+		}
+	}
+}
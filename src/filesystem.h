@@ -0,0 +1,146 @@
+/*************************************************************************************************/
+/**
+	filesystem.h
+
+
+	Copyright (C) Rich Talbot-Watkins 2007 - 2012
+
+	This file is part of BeebAsm.
+
+	BeebAsm is free software: you can redistribute it and/or modify it under the terms of the GNU
+	General Public License as published by the Free Software Foundation, either version 3 of the
+	License, or (at your option) any later version.
+
+	BeebAsm is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without
+	even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License along with BeebAsm, as
+	COPYING.txt.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/*************************************************************************************************/
+
+#ifndef FILESYSTEM_H_
+#define FILESYSTEM_H_
+
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+
+
+/*************************************************************************************************/
+/**
+	FileSystem
+
+	Where the assembler reads and writes its files.  Everything goes through the FileCache, which
+	uses the disk unless it is given another FileSystem.
+*/
+/*************************************************************************************************/
+class FileSystem
+{
+public:
+
+	enum STATUS
+	{
+		FILE_OK,
+		FILE_OPEN_ERROR,
+		FILE_READ_ERROR,
+		FILE_WRITE_ERROR
+	};
+
+	virtual ~FileSystem() {}
+
+	// Gets a name for a file which is the same whatever the current directory
+
+	virtual std::string	GetPath( const std::string& filename ) = 0;
+
+	// Gets what identifies this version of a file, without reading it; false if it doesn't exist.
+	// The modification time is in nanoseconds, where the file system can tell.
+
+	virtual bool	GetInfo( const std::string& filename, long long& modificationTime, long long& size ) = 0;
+
+	virtual STATUS	Read( const std::string& filename, std::vector<unsigned char>& contents ) = 0;
+	virtual STATUS	Write( const std::string& filename, const unsigned char* pData, size_t length ) = 0;
+};
+
+
+
+/*************************************************************************************************/
+/**
+	DiskFileSystem
+
+	Reads and writes files on disk, relative to the current directory unless it is given another
+*/
+/*************************************************************************************************/
+class DiskFileSystem : public FileSystem
+{
+public:
+
+	virtual std::string	GetPath( const std::string& filename );
+	virtual bool	GetInfo( const std::string& filename, long long& modificationTime, long long& size );
+	virtual STATUS	Read( const std::string& filename, std::vector<unsigned char>& contents );
+	virtual STATUS	Write( const std::string& filename, const unsigned char* pData, size_t length );
+
+	// An empty directory means the current directory
+
+	inline void		SetDirectory( const std::string& directory )	{ m_directory = directory; }
+
+
+private:
+
+	std::string		Resolve( const std::string& filename ) const;
+
+	std::string		m_directory;
+};
+
+
+
+/*************************************************************************************************/
+/**
+	MemoryFileSystem
+
+	Reads files from a map of names to contents, falling back to a resolver function for any
+	which aren't in it, and keeps the files written in memory
+*/
+/*************************************************************************************************/
+class MemoryFileSystem : public FileSystem
+{
+public:
+
+	// Fills in the contents of a file which isn't in the map, returning false if there is no such
+	// file
+
+	typedef std::function<bool( const std::string& filename, std::string& contents )>	Resolver;
+
+	MemoryFileSystem( const std::map<std::string, std::string>& files, const Resolver& resolver );
+
+	virtual std::string	GetPath( const std::string& filename );
+	virtual bool	GetInfo( const std::string& filename, long long& modificationTime, long long& size );
+	virtual STATUS	Read( const std::string& filename, std::vector<unsigned char>& contents );
+	virtual STATUS	Write( const std::string& filename, const unsigned char* pData, size_t length );
+
+	void			GetWrittenFiles( std::map<std::string, std::string>& files ) const;
+
+
+private:
+
+	struct File
+	{
+		std::string						m_contents;
+		long long						m_version;		// stands in for the modification time
+		bool							m_bWritten;
+	};
+
+	const std::string*					Find( const std::string& filename, long long& version );
+
+	const std::map<std::string, std::string>&	m_files;
+	Resolver							m_resolver;
+
+	// Files from the resolver, and files written
+	std::map<std::string, File>			m_otherFiles;
+	long long							m_nextVersion;
+};
+
+
+#endif // FILESYSTEM_H_
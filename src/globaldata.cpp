@@ -23,7 +23,7 @@
 #include "globaldata.h"
 #include <iostream>
 
-GlobalData* GlobalData::m_gInstance = NULL;
+thread_local GlobalData* GlobalData::m_gInstance = NULL;
 
 
 
@@ -80,7 +80,14 @@ GlobalData::GlobalData()
 		m_discCycle( 0 ),
 		m_assemblyTime( time( NULL ) ),
 		m_bRequireDistinctOpcodes( false ),
-		m_bUseVisualCppErrorFormat( false )
+		m_bUseVisualCppErrorFormat( false ),
+		m_bRelaxLayout( false ),
+		m_bRelaxing( false ),
+		m_bShowCycles( false ),
+		m_minCycleTotal( 0 ),
+		m_maxCycleTotal( 0 ),
+		m_pOutputStream( &std::cout ),
+		m_pErrorStream( &std::cerr )
 {
 	// We populate m_assemblyTime with a time on startup so that all uses of TIME$ during 
 	// assembly refer to the exact same time, however long we spend assembling.
@@ -26,6 +26,9 @@
 #include <cassert>
 #include <cstdlib>
 #include <ctime>
+#include <functional>
+#include <iosfwd>
+#include <set>
 #include <string>
 
 
@@ -39,7 +42,7 @@ public:
 	static void Destroy();
 	static inline GlobalData& Instance() { assert( m_gInstance != NULL ); return *m_gInstance; }
 
-	inline void SetPass( int i )				{ m_pass = i; }
+	inline void SetPass( int i )				{ m_pass = i; if ( m_passObserver ) m_passObserver( i ); }
 	inline void SetBootFile( const char* p )	{ m_pBootFile = p; }
 	inline void SetVerbose( bool b )			{ m_bVerboseSet = true; m_bVerbose = b; }
 	inline void SetUseDiscImage( bool b )		{ m_bUseDiscImage = b; }
@@ -47,6 +50,8 @@ public:
 	inline void ResetForId()					{ m_forId = 0; }
 	inline void SetSaved()						{ m_bSaved = true; }
 	inline void SetOutputFile( const char* p )	{ m_pOutputFile = p; }
+	inline void AddOutputFile( const std::string& f )
+												{ m_outputFiles.insert( f ); }
 	inline void IncNumAnonSaves()				{ m_numAnonSaves++; }
 	inline void SetDiscOption( int opt )		{ m_discOption = opt; }
 	inline void SetDiscCycle( int num )		    { m_discCycle = num; }
@@ -56,6 +61,16 @@ public:
 												{ m_bRequireDistinctOpcodes = b; }
 	inline void SetUseVisualCppErrorFormat( bool b )
 												{ m_bUseVisualCppErrorFormat = b; }
+	inline void SetRelaxLayout( bool b )		{ m_bRelaxLayout = b; }
+	inline void SetRelaxing( bool b )			{ m_bRelaxing = b; }
+	inline void SetShowCycles( bool b )			{ m_bShowCycles = b; }
+	inline void SetOutputStreams( std::ostream& out, std::ostream& err )
+												{ m_pOutputStream = &out; m_pErrorStream = &err; }
+
+	// Called with the number of each pass as it starts, e.g. to measure each pass
+	typedef std::function<void( int pass )> PassObserver;
+	inline void SetPassObserver( const PassObserver& o )
+												{ m_passObserver = o; }
 
 	inline int GetPass() const					{ return m_pass; }
 	inline bool IsFirstPass() const				{ return ( m_pass == 0 ); }
@@ -68,6 +83,8 @@ public:
 	inline int GetNextForId()					{ return m_forId++; }
 	inline bool IsSaved() const					{ return m_bSaved; }
 	inline const char* GetOutputFile() const	{ return m_pOutputFile; }
+	inline const std::set<std::string>& GetOutputFiles() const
+												{ return m_outputFiles; }
 	inline int GetNumAnonSaves() const			{ return m_numAnonSaves; }
 	inline int GetDiscOption() const			{ return m_discOption; }
 	inline int GetDiscCycle() const			    { return m_discCycle; }
@@ -76,13 +93,28 @@ public:
 	inline time_t GetAssemblyTime() const		{ return m_assemblyTime; }
 	inline bool RequireDistinctOpcodes() const  { return m_bRequireDistinctOpcodes; }
 	inline bool UseVisualCppErrorFormat() const { return m_bUseVisualCppErrorFormat; }
+	inline bool RelaxLayout() const				{ return m_bRelaxLayout; }
+
+	// Whether the first pass is being repeated by -relax, when forward references are estimates
+	inline bool IsRelaxing() const				{ return m_bRelaxing; }
+	inline bool ShowCycles() const				{ return m_bShowCycles; }
+
+	// The cycles listed since the last label, at least and at most
+	inline void ResetCycleTotal()				{ m_minCycleTotal = 0; m_maxCycleTotal = 0; }
+	inline void AddCycles( int min, int max )	{ m_minCycleTotal += min; m_maxCycleTotal += max; }
+	inline int GetMinCycleTotal() const			{ return m_minCycleTotal; }
+	inline int GetMaxCycleTotal() const			{ return m_maxCycleTotal; }
+
+	// Where the assembly writes what would otherwise go to stdout and stderr
+	inline std::ostream& GetOutputStream() const	{ return *m_pOutputStream; }
+	inline std::ostream& GetErrorStream() const		{ return *m_pErrorStream; }
 
 private:
 
 	GlobalData();
 	~GlobalData();
 
-	static GlobalData*			m_gInstance;
+	static thread_local GlobalData*	m_gInstance;
 
 	int							m_pass;
 	const char*					m_pBootFile;
@@ -93,6 +125,7 @@ private:
 	int							m_forId;
 	bool						m_bSaved;
 	const char*					m_pOutputFile;
+	std::set<std::string>		m_outputFiles;
 	int							m_numAnonSaves;
 	int							m_discOption;
 	int							m_discCycle;
@@ -100,6 +133,14 @@ private:
 	time_t						m_assemblyTime;
 	bool						m_bRequireDistinctOpcodes;
 	bool						m_bUseVisualCppErrorFormat;
+	bool						m_bRelaxLayout;
+	bool						m_bRelaxing;
+	bool						m_bShowCycles;
+	int							m_minCycleTotal;
+	int							m_maxCycleTotal;
+	std::ostream*				m_pOutputStream;
+	std::ostream*				m_pErrorStream;
+	PassObserver				m_passObserver;
 };
 
 
@@ -0,0 +1,148 @@
+/*************************************************************************************************/
+/**
+	keywordtrie.cpp
+
+
+	Copyright (C) Rich Talbot-Watkins 2007 - 2012
+
+	This file is part of BeebAsm.
+
+	BeebAsm is free software: you can redistribute it and/or modify it under the terms of the GNU
+	General Public License as published by the Free Software Foundation, either version 3 of the
+	License, or (at your option) any later version.
+
+	BeebAsm is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without
+	even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License along with BeebAsm, as
+	COPYING.txt.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/*************************************************************************************************/
+
+#include <cassert>
+
+#include "keywordtrie.h"
+#include "stringutils.h"
+
+using namespace std;
+
+
+
+/*************************************************************************************************/
+/**
+	KeywordTrie::KeywordTrie()
+
+	Constructor for KeywordTrie
+
+	@param		keywords		The keywords, in upper case.  A match is reported with the index
+								of the keyword in this list.
+*/
+/*************************************************************************************************/
+KeywordTrie::KeywordTrie( const vector<const char*>& keywords )
+	:	m_alphabetSize( 0 )
+{
+	// Only characters which appear in a keyword get a slot in each node; everything else can
+	// never match
+
+	for ( int c = 0; c < 256; c++ )
+	{
+		m_charIndex[ c ] = -1;
+	}
+
+	for ( size_t i = 0; i < keywords.size(); i++ )
+	{
+		for ( const char* p = keywords[ i ]; *p != '\0'; p++ )
+		{
+			unsigned char c = static_cast< unsigned char >( *p );
+
+			if ( m_charIndex[ c ] == -1 )
+			{
+				m_charIndex[ c ] = m_alphabetSize++;
+			}
+		}
+	}
+
+	for ( int c = 0; c < 256; c++ )
+	{
+		char lower = Ascii::ToLower( static_cast< char >( c ) );
+		m_charIndex[ static_cast< unsigned char >( lower ) ] = m_charIndex[ c ];
+	}
+
+	// Root node
+
+	m_children.resize( m_alphabetSize, 0 );
+	m_keyword.push_back( -1 );
+
+	for ( size_t i = 0; i < keywords.size(); i++ )
+	{
+		int node = 0;
+
+		for ( const char* p = keywords[ i ]; *p != '\0'; p++ )
+		{
+			int slot = node * m_alphabetSize + m_charIndex[ static_cast< unsigned char >( *p ) ];
+
+			if ( m_children[ slot ] == 0 )
+			{
+				m_children[ slot ] = static_cast< int >( m_keyword.size() );
+				m_children.resize( m_children.size() + m_alphabetSize, 0 );
+				m_keyword.push_back( -1 );
+			}
+
+			node = m_children[ slot ];
+		}
+
+		// Keywords must be unique
+		assert( m_keyword[ node ] == -1 );
+		m_keyword[ node ] = static_cast< int >( i );
+	}
+}
+
+
+
+/*************************************************************************************************/
+/**
+	KeywordTrie::FindPrefixes()
+
+	Finds all the keywords which the text at the given column begins with
+
+	@param		line			The string to search
+	@param		column			The column to start from
+	@param		matches			Filled in with the matching keywords, shortest first; must have
+								room for MAX_KEYWORD_MATCHES entries
+
+	@return		The number of matches
+*/
+/*************************************************************************************************/
+int KeywordTrie::FindPrefixes( const string& line, size_t column, Match* matches ) const
+{
+	int count = 0;
+	int node = 0;
+
+	for ( size_t i = column; i < line.length(); i++ )
+	{
+		int c = m_charIndex[ static_cast< unsigned char >( line[ i ] ) ];
+
+		if ( c == -1 )
+		{
+			break;
+		}
+
+		node = m_children[ node * m_alphabetSize + c ];
+
+		if ( node == 0 )
+		{
+			break;
+		}
+
+		if ( m_keyword[ node ] != -1 )
+		{
+			assert( count < MAX_KEYWORD_MATCHES );
+			matches[ count ].m_index = m_keyword[ node ];
+			matches[ count ].m_length = i + 1 - column;
+			count++;
+		}
+	}
+
+	return count;
+}
@@ -0,0 +1,71 @@
+/*************************************************************************************************/
+/**
+	keywordtrie.h
+
+
+	Copyright (C) Rich Talbot-Watkins 2007 - 2012
+
+	This file is part of BeebAsm.
+
+	BeebAsm is free software: you can redistribute it and/or modify it under the terms of the GNU
+	General Public License as published by the Free Software Foundation, either version 3 of the
+	License, or (at your option) any later version.
+
+	BeebAsm is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without
+	even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License along with BeebAsm, as
+	COPYING.txt.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/*************************************************************************************************/
+
+#ifndef KEYWORDTRIE_H_
+#define KEYWORDTRIE_H_
+
+#include <string>
+#include <vector>
+
+
+/*************************************************************************************************/
+/**
+	KeywordTrie
+
+	A case-insensitive trie over a table of upper case keywords, used to find which keywords the
+	text at a given column begins with, in time proportional to the length of the longest
+	keyword rather than the size of the table.
+*/
+/*************************************************************************************************/
+class KeywordTrie
+{
+public:
+
+	struct Match
+	{
+		int		m_index;
+		size_t	m_length;
+	};
+
+	// Maximum number of keywords which can prefix each other in one table
+
+	#define MAX_KEYWORD_MATCHES	16
+
+	KeywordTrie( const std::vector<const char*>& keywords );
+
+	int			FindPrefixes( const std::string& line, size_t column, Match* matches ) const;
+
+
+private:
+
+	int			m_alphabetSize;
+	int			m_charIndex[ 256 ];
+
+	// Child node of each node for each character in the alphabet (0 = none), and the index of
+	// the keyword which ends at each node (-1 = none)
+
+	std::vector<int>	m_children;
+	std::vector<int>	m_keyword;
+};
+
+
+#endif // KEYWORDTRIE_H_
@@ -0,0 +1,126 @@
+/*************************************************************************************************/
+/**
+	libbeebasm.cpp
+
+	The entry point for using beebasm as a library
+
+
+	Copyright (C) Rich Talbot-Watkins 2007 - 2012
+
+	This file is part of BeebAsm.
+
+	BeebAsm is free software: you can redistribute it and/or modify it under the terms of the GNU
+	General Public License as published by the Free Software Foundation, either version 3 of the
+	License, or (at your option) any later version.
+
+	BeebAsm is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without
+	even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License along with BeebAsm, as
+	COPYING.txt.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/*************************************************************************************************/
+
+#include <cstdlib>
+#include <sstream>
+
+#include "libbeebasm.h"
+#include "assemblercontext.h"
+#include "commandline.h"
+#include "filecache.h"
+#include "filesystem.h"
+#include "globaldata.h"
+#include "objectcode.h"
+#include "symboltable.h"
+
+using namespace std;
+
+
+
+/*************************************************************************************************/
+/**
+	AssembleInMemory()
+
+	Assembles a source file with the FileCache reading from, and writing to, memory
+
+	@param		sourceFile		Name of the source file to assemble
+	@param		files			Names and contents of the files the assembly can read
+	@param		options			Command line options, and where to find other files
+
+	@return		What the assembly produced
+*/
+/*************************************************************************************************/
+BeebAsmResult AssembleInMemory( const string& sourceFile,
+								const map<string, string>& files,
+								const BeebAsmOptions& options )
+{
+	BeebAsmResult result;
+	result.m_bSucceeded = false;
+
+	for ( size_t i = 0; i < options.m_arguments.size(); i++ )
+	{
+		if ( options.m_arguments[ i ] == "-cache" )
+		{
+			result.m_diagnostics = "-cache cannot be used when assembling in memory\n";
+			return result;
+		}
+	}
+
+	// Make the command line, with modifiable copies of the arguments
+
+	vector<string> arguments;
+	arguments.push_back( "beebasm" );
+	arguments.push_back( "-i" );
+	arguments.push_back( sourceFile );
+	arguments.insert( arguments.end(), options.m_arguments.begin(), options.m_arguments.end() );
+
+	vector<char*> argv;
+
+	for ( size_t i = 0; i < arguments.size(); i++ )
+	{
+		arguments[ i ].push_back( '\0' );
+		argv.push_back( &arguments[ i ][ 0 ] );
+	}
+
+	argv.push_back( NULL );
+
+	MemoryFileSystem fileSystem( files, options.m_resolver );
+	ostringstream out;
+	ostringstream err;
+
+	FileCache::Create( &fileSystem );
+
+	try
+	{
+		AssemblerContext context( out, err );
+		GlobalData::Instance().SetPassObserver( options.m_passObserver );
+
+		if ( AssembleWithOptions( static_cast< int >( arguments.size() ), &argv[ 0 ] ) == EXIT_SUCCESS )
+		{
+			const unsigned char* pMemory = ObjectCode::Instance().GetAddr( 0 );
+
+			result.m_bSucceeded = true;
+			result.m_memory.assign( pMemory, pMemory + MEMORY_SIZE );
+			SymbolTable::Instance().GetLabels( result.m_symbols );
+		}
+
+		if ( options.m_passObserver )
+		{
+			options.m_passObserver( -1 );
+		}
+	}
+	catch ( ... )
+	{
+		FileCache::Destroy();
+		throw;
+	}
+
+	FileCache::Destroy();
+
+	fileSystem.GetWrittenFiles( result.m_savedFiles );
+	result.m_output = out.str();
+	result.m_diagnostics = err.str();
+
+	return result;
+}
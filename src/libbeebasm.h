@@ -0,0 +1,82 @@
+/*************************************************************************************************/
+/**
+	libbeebasm.h
+
+
+	Copyright (C) Rich Talbot-Watkins 2007 - 2012
+
+	This file is part of BeebAsm.
+
+	BeebAsm is free software: you can redistribute it and/or modify it under the terms of the GNU
+	General Public License as published by the Free Software Foundation, either version 3 of the
+	License, or (at your option) any later version.
+
+	BeebAsm is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without
+	even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License along with BeebAsm, as
+	COPYING.txt.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/*************************************************************************************************/
+
+#ifndef LIBBEEBASM_H_
+#define LIBBEEBASM_H_
+
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+
+
+// How to assemble, for AssembleInMemory()
+
+struct BeebAsmOptions
+{
+	// Command line options as for the beebasm executable, other than -i, -cache and the -- modes,
+	// e.g. "-D", "LEVEL=3", "-do", "game.ssd"
+	std::vector<std::string>	m_arguments;
+
+	// Called for any file read which isn't one of the files passed in, to fill in its contents;
+	// returns false if there is no such file.  If empty, there are no other files.
+	std::function<bool( const std::string& filename, std::string& contents )>	m_resolver;
+
+	// If set, called with the number of each pass (0 or 1) as it starts, and with -1 once the
+	// assembly is over, whether or not it succeeded; e.g. to measure each pass
+	std::function<void( int pass )>	m_passObserver;
+};
+
+
+// What an assembly produced
+
+struct BeebAsmResult
+{
+	bool								m_bSucceeded;
+
+	// Memory as the assembly left it, MEMORY_SIZE bytes from address 0
+	std::vector<unsigned char>			m_memory;
+
+	// The files written by SAVE, -do, -labels and -deps
+	std::map<std::string, std::string>	m_savedFiles;
+
+	// Global labels with numeric values, as dumped by -d
+	std::map<std::string, double>		m_symbols;
+
+	// What the executable would have written to stdout and stderr, including any errors
+	std::string							m_output;
+	std::string							m_diagnostics;
+};
+
+
+// Assembles a source file without touching the disk.  Files are read from the map of names to
+// contents, or else from the resolver, and files written are returned in the result.
+//
+// The calling thread mustn't be running another assembly, but separate threads may call it at
+// the same time.
+
+BeebAsmResult AssembleInMemory( const std::string& sourceFile,
+								const std::map<std::string, std::string>& files,
+								const BeebAsmOptions& options = BeebAsmOptions() );
+
+
+#endif // LIBBEEBASM_H_
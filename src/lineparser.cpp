@@ -29,6 +29,9 @@
 #include "symboltable.h"
 #include "globaldata.h"
 #include "sourcefile.h"
+#include "sourcetext.h"
+#include "statistics.h"
+#include "tracer.h"
 
 
 using namespace std;
@@ -45,12 +48,18 @@ using namespace std;
 LineParser::LineParser( SourceCode* sourceCode, const string& line )
 	:	m_sourceCode( sourceCode ),
 		m_line( line ),
-		m_column( 0 )
+		m_column( 0 ),
+		m_tokenColumn( 0 ),
+		m_sourceText( NULL ),
+		m_lineOffset( 0 )
 {
 }
 
 LineParser::LineParser( SourceCode* sourceCode )
-	:	m_sourceCode( sourceCode )
+	:	m_sourceCode( sourceCode ),
+		m_tokenColumn( 0 ),
+		m_sourceText( NULL ),
+		m_lineOffset( 0 )
 {
 }
 
@@ -74,12 +83,21 @@ LineParser::~LineParser()
 	LineParser::ProcessLine()
 
 	Process one line of the file
+
+	@param		line			The line to process
+	@param		sourceText		The SourceText the line came from, or NULL
+	@param		lineOffset		Offset of the start of the line within sourceText
+
+	If a SourceText is given, the classification of each statement is looked up in (or added to)
+	its cache, so that lines revisited on the second pass or by a FOR loop aren't lexed again.
 */
 /*************************************************************************************************/
-void LineParser::Process( const string& line )
+void LineParser::Process( const string& line, SourceText* sourceText, int lineOffset )
 {
 	m_line = line;
 	m_column = 0;
+	m_sourceText = sourceText;
+	m_lineOffset = lineOffset;
 
 	bool bProcessedSomething = false;
 	while ( AdvanceAndCheckEndOfLine() )	// keep going until we reach the end of the line
@@ -89,53 +107,37 @@ void LineParser::Process( const string& line )
 
 		int oldColumn = m_column;
 
-		// Priority: check if it's symbol assignment and let it take priority over keywords
-		// This means symbols can begin with reserved words, e.g. PLAyer, but in the case of
-		// the line 'player = 1', the meaning is unambiguous, so we allow it as a symbol
-		// assignment.
-
-		bool bIsSymbolAssignment = false;
+		int lexed = LEXED_UNKNOWN;
 
-		if ( Ascii::IsAlpha( m_line[ m_column ] ) || m_line[ m_column ] == '_' )
+		if ( m_sourceText != NULL )
 		{
-			do
-			{
-				m_column++;
+			lexed = m_sourceText->LexedStatement( m_lineOffset + m_column );
+		}
 
-			} while ( m_column < m_line.length() &&
-					  ( Ascii::IsAlpha( m_line[ m_column ] ) ||
-						Ascii::IsDigit( m_line[ m_column ] ) ||
-						m_line[ m_column ] == '_' ||
-						m_line[ m_column ] == '%' ||
-						m_line[ m_column ] == '$' ) &&
-						m_line[ m_column - 1 ] != '%' &&
-						m_line[ m_column - 1 ] != '$' );
+		if ( lexed == LEXED_UNKNOWN )
+		{
+			lexed = LexStatement();
+			m_column = oldColumn;
 
-			if ( AdvanceAndCheckEndOfStatement() )
+			if ( m_sourceText != NULL )
 			{
-				if ( m_line[ m_column ] == '=' )
-				{
-					// if we have a valid symbol name, followed by an '=', it is definitely
-					// a symbol assignment.
-					bIsSymbolAssignment = true;
-				}
+				m_sourceText->LexedStatement( m_lineOffset + m_column ) = static_cast<unsigned char>( lexed );
 			}
 		}
 
-		m_column = oldColumn;
+		bool bIsSymbolAssignment = ( lexed == LEXED_ASSIGNMENT );
 
 		// first check tokens - they have priority over opcodes, so that they can have names
 		// like INCLUDE (which would otherwise be interpreted as INC LUDE)
 
-		if ( !bIsSymbolAssignment )
+		if ( lexed >= LEXED_TOKEN )
 		{
-			int token = GetTokenAndAdvanceColumn();
+			int token = lexed - LEXED_TOKEN;
 
-			if ( token != -1 )
-			{
-				HandleToken( token, oldColumn );
-				continue;
-			}
+			m_column += m_gaTokenTable[ token ].m_nameLength;
+			Statistics::CountStatement( token );
+			HandleToken( token, oldColumn );
+			continue;
 		}
 
 		// Next we see if we should even be trying to execute anything.... maybe the if condition is false
@@ -156,6 +158,7 @@ void LineParser::Process( const string& line )
 
 			if ( token != -1 )
 			{
+				Statistics::Count( Statistics::INSTRUCTIONS );
 				HandleAssembler( token );
 				continue;
 			}
@@ -166,6 +169,8 @@ void LineParser::Process( const string& line )
 			// Deal here with symbol assignment
 			bool bIsConditionalAssignment = false;
 
+			Statistics::Count( Statistics::ASSIGNMENTS );
+
 			ScopedSymbolName symbolName = m_sourceCode->GetScopedSymbolName( GetSymbolName() );
 
 			if ( !AdvanceAndCheckEndOfStatement() )
@@ -224,7 +229,7 @@ void LineParser::Process( const string& line )
 			{
 				if ( m_sourceCode->ShouldOutputAsm() )
 				{
-					cout << "Macro " << macroName << ":" << endl;
+					GlobalData::Instance().GetOutputStream() << "Macro " << macroName << ":" << endl;
 				}
 
 				// Evaluate parameters at outer scope.
@@ -275,7 +280,8 @@ void LineParser::Process( const string& line )
 					if ( parameterDefined[i] )
 					{
 						ScopedSymbolName paramName = m_sourceCode->GetScopedSymbolName( macro->GetParameter( i ) );
-						if ( !SymbolTable::Instance().IsSymbolDefined( paramName ) )
+						SymbolTable::Symbol* paramSymbol = SymbolTable::Instance().FindSymbol( paramName );
+						if ( paramSymbol == NULL )
 						{
 							SymbolTable::Instance().AddSymbol( paramName, parameterValues[i] );
 						}
@@ -283,19 +289,27 @@ void LineParser::Process( const string& line )
 						{
 							// The value may come from an outer scope on the first pass and the current scope on
 							// the second pass so it may need updating.
-							SymbolTable::Instance().ChangeSymbol( paramName, parameterValues[i] );
+							paramSymbol->SetValue( parameterValues[i] );
 						}
 					}
 				}
 
 				// Run the macro and tidy up
+				TraceSpan span( "macro" );
+
+				if ( span.IsEnabled() )
+				{
+					span.SetName( macroName );
+					span.SetArgs( Tracer::LocationArgs( m_sourceCode->GetFilename(), m_sourceCode->GetLineNumber() ) );
+				}
+
 				MacroInstance macroInstance( macro, m_sourceCode );
 				macroInstance.Process();
 				HandleCloseBrace();
 
 				if ( m_sourceCode->ShouldOutputAsm() )
 				{
-					cout << "End macro " << macroName << endl;
+					GlobalData::Instance().GetOutputStream() << "End macro " << macroName << endl;
 				}
 
 				continue;
@@ -322,6 +336,67 @@ void LineParser::Process( const string& line )
 
 
 
+/*************************************************************************************************/
+/**
+	LineParser::LexStatement()
+
+	Classifies the statement starting at the current column as a symbol assignment, a token or
+	something else.  This only depends on the text of the statement, so the result can be cached.
+
+	@return		LEXED_ASSIGNMENT, LEXED_NOT_TOKEN, or LEXED_TOKEN plus the token number
+				column is left somewhere undefined
+*/
+/*************************************************************************************************/
+int LineParser::LexStatement()
+{
+	size_t oldColumn = m_column;
+
+	// Priority: check if it's symbol assignment and let it take priority over keywords
+	// This means symbols can begin with reserved words, e.g. PLAyer, but in the case of
+	// the line 'player = 1', the meaning is unambiguous, so we allow it as a symbol
+	// assignment.
+
+	if ( Ascii::IsAlpha( m_line[ m_column ] ) || m_line[ m_column ] == '_' )
+	{
+		do
+		{
+			m_column++;
+
+		} while ( m_column < m_line.length() &&
+				  ( Ascii::IsAlpha( m_line[ m_column ] ) ||
+					Ascii::IsDigit( m_line[ m_column ] ) ||
+					m_line[ m_column ] == '_' ||
+					m_line[ m_column ] == '%' ||
+					m_line[ m_column ] == '$' ) &&
+					m_line[ m_column - 1 ] != '%' &&
+					m_line[ m_column - 1 ] != '$' );
+
+		if ( AdvanceAndCheckEndOfStatement() )
+		{
+			if ( m_line[ m_column ] == '=' )
+			{
+				// if we have a valid symbol name, followed by an '=', it is definitely
+				// a symbol assignment.
+				return LEXED_ASSIGNMENT;
+			}
+		}
+	}
+
+	m_column = oldColumn;
+
+	int token = GetTokenAndAdvanceColumn();
+
+	if ( token != -1 )
+	{
+		assert( LEXED_TOKEN + token <= 255 );
+		return LEXED_TOKEN + token;
+	}
+
+	return LEXED_NOT_TOKEN;
+}
+
+
+
 /*************************************************************************************************/
 /**
 	LineParser::SkipStatement()
@@ -424,12 +499,15 @@ void LineParser::SkipExpression( int bracketCount, bool bAllowOneMismatchedClose
 	Calls the handler for the specified token
 
 	@param		i				Index of the token to be handled
+	@param		oldColumn		Column at which the token starts
 */
 /*************************************************************************************************/
 void LineParser::HandleToken( int i, int oldColumn )
 {
 	assert( i >= 0 );
 
+	m_tokenColumn = oldColumn;
+
 	if ( m_gaTokenTable[ i ].m_directiveHandler )
 	{
 		( m_sourceCode->*m_gaTokenTable[ i ].m_directiveHandler )( m_line, m_column );
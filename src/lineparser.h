@@ -24,9 +24,12 @@
 #define LINEPARSER_H_
 
 #include <string>
+#include <vector>
+#include "scopedsymbolname.h"
 #include "value.h"
 
 class SourceCode;
+class SourceText;
 
 class LineParser
 {
@@ -40,10 +43,52 @@ public:
 
 	// Process the given line
 
-	void Process( const std::string& line );
+	void Process( const std::string& line, SourceText* sourceText = NULL, int lineOffset = 0 );
 
 	// Accessors
 
+	// The directives, e.g. for counting the statements of each kind
+	static int			GetNumberOfTokens();
+	static const char*	GetTokenName( int token );
+
+
+private:
+
+	typedef void ( LineParser::*OperatorHandler )();
+
+public:
+
+	// An expression reduced to the values and operators which EvaluateExpression found when it
+	// parsed it, so that it can be evaluated again without going back to the text.
+	// Columns are relative to the start of the expression.
+
+	struct CompiledExpression
+	{
+		enum STEP_TYPE
+		{
+			PUSH_VALUE,
+			PUSH_PC,
+			PUSH_TIME,
+			PUSH_SYMBOL,
+			APPLY_OPERATOR
+		};
+
+		struct Step
+		{
+			Step() : m_type( PUSH_VALUE ), m_column( 0 ), m_symbolColumn( 0 ), m_bracketCount( 0 ), m_handler( NULL ) {}
+
+			STEP_TYPE			m_type;
+			int					m_column;
+			int					m_symbolColumn;
+			int					m_bracketCount;
+			Value				m_value;
+			ScopedSymbolName	m_symbolName;
+			OperatorHandler		m_handler;
+		};
+
+		std::vector<Step>		m_steps;
+		int						m_endColumn;
+	};
 
 private:
 
@@ -79,17 +124,28 @@ private:
 		NUM_ADDRESSING_MODES
 	};
 
+	// The cycles in OpcodeData are the 6502's, with these flags added
+
+	#define CYCLES_MASK				0x0F
+	#define CYCLES_PAGE_CROSSED		0x10	// one more if the indexing crosses a page
+	#define CYCLES_65C02_MORE		0x20	// one more on the 65C02
+	#define CYCLES_65C02_FEWER		0x40	// one fewer on the 65C02, but one more if the indexing
+											// crosses a page
+
+	// Where the cycles start in the listing
+
+	#define CYCLES_COLUMN			40
+
 	struct OpcodeData
 	{
 		short			m_aOpcodes[NUM_ADDRESSING_MODES];
 		const char*		m_pName;
 		int             m_nameLength;
 		int				m_cpu;
+		unsigned char	m_aCycles[NUM_ADDRESSING_MODES];
 	};
 
 
-	typedef void ( LineParser::*OperatorHandler )();
-
 	struct Operator
 	{
 		const char*			token;
@@ -106,8 +162,21 @@ private:
 	};
 
 
+	// Statement classifications, as cached in a SourceText
+
+	enum LEXED_STATEMENT
+	{
+		LEXED_UNKNOWN,
+		LEXED_ASSIGNMENT,
+		LEXED_NOT_TOKEN,
+		LEXED_TOKEN
+	};
+
 	// line parsing methods
 
+	int				LexStatement();
+	static std::vector<const char*>	GetTokenNames();
+	static std::vector<const char*>	GetOpcodeNames();
 	int				GetTokenAndAdvanceColumn();
 	void			HandleToken( int i, int oldColumn );
 	int				GetInstructionAndAdvanceColumn();
@@ -129,6 +198,12 @@ private:
 	void			Assemble1( int instructionIndex, ADDRESSING_MODE mode );
 	void			Assemble2( int instructionIndex, ADDRESSING_MODE mode, unsigned int value );
 	void			Assemble3( int instructionIndex, ADDRESSING_MODE mode, unsigned int value );
+	void			GetCycles( int instructionIndex, ADDRESSING_MODE mode, unsigned int value,
+							   int& minCycles, int& maxCycles, std::string& cycles );
+	void			ListInstruction( const std::string& listing, int instructionIndex, ADDRESSING_MODE mode,
+									 unsigned int value );
+	bool			BranchCrossesPage( unsigned int value ) const;
+	void			CheckIndexedTable( unsigned int value );
 
 	// language handling methods
 
@@ -169,6 +244,8 @@ private:
 	void			HandleRandomize();
 	void			HandleAsm();
 	void			HandleSourceLine();
+	void			HandleNoPageCross();
+	void			HandleEndNoPageCross();
 
 	// expression evaluating methods
 
@@ -177,7 +254,9 @@ private:
 	int				EvaluateExpressionAsInt( bool bAllowOneMismatchedCloseBracket = false );
 	unsigned int	EvaluateExpressionAsUnsignedInt( bool bAllowOneMismatchedCloseBracket = false );
 	std::string		EvaluateExpressionAsString( bool bAllowOneMismatchedCloseBracket = false );
-	Value			GetValue();
+	Value			GetValue( CompiledExpression::Step* step = NULL );
+	Value			EvaluateCompiledExpression( const CompiledExpression& compiled, bool bAllowOneMismatchedCloseBracket );
+	void			ApplyOperator( OperatorHandler handler, CompiledExpression* compiled, size_t startColumn );
 
 	// convenience functions for getting operator parameters from the stack
 	std::pair<Value, Value> StackTopTwoValues();
@@ -248,6 +327,9 @@ private:
 	SourceCode*				m_sourceCode;
 	std::string				m_line;
 	size_t					m_column;
+	int						m_tokenColumn;
+	SourceText*				m_sourceText;
+	int						m_lineOffset;
 
 	static const Token		m_gaTokenTable[];
 	static const OpcodeData	m_gaOpcodeTable[];
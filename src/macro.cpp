@@ -22,12 +22,13 @@
 
 
 #include "macro.h"
+#include "statistics.h"
 
 
 using namespace std;
 
 
-MacroTable* MacroTable::m_gInstance = NULL;
+thread_local MacroTable* MacroTable::m_gInstance = NULL;
 
 
 /*************************************************************************************************/
@@ -48,6 +49,26 @@ Macro::Macro( const string& filename, int lineNumber )
 
 
 
+/*************************************************************************************************/
+/**
+	Macro::GetSourceText()
+
+	Returns the macro body as a SourceText, shared by every instance of the macro so that its
+	statements are only lexed once.  The body must be complete, i.e. ENDMACRO has been reached.
+*/
+/*************************************************************************************************/
+const shared_ptr<SourceText>& Macro::GetSourceText() const
+{
+	if ( !m_source )
+	{
+		m_source = make_shared<SourceText>( m_body );
+	}
+
+	return m_source;
+}
+
+
+
 /*************************************************************************************************/
 /**
 	MacroInstance::MacroInstance()
@@ -58,14 +79,16 @@ Macro::Macro( const string& filename, int lineNumber )
 */
 /*************************************************************************************************/
 MacroInstance::MacroInstance( const Macro* macro, const SourceCode* sourceCode )
-	:	SourceCode( macro->GetFilename(), macro->GetLineNumber(), macro->GetBody(), sourceCode )
+	:	SourceCode( macro->GetFilename(), macro->GetLineNumber(), macro->GetSourceText(), sourceCode )
 		//,m_macro( macro )
 {
 //	cout << "Instance macro: " << m_macro->GetName() << " (" << m_filename << ":" << m_lineNumber << ")" << endl;
 
-	// Copy FOR stack from the parent
+	// Share the FOR stack of the parent; the macro body is shared via GetSourceText()
 
-	CopyForStack( sourceCode );
+	InheritForStack( sourceCode );
+
+	Statistics::Count( Statistics::MACRO_INSTANCES );
 }
 
 
@@ -124,11 +147,27 @@ MacroTable::MacroTable()
 */
 /*************************************************************************************************/
 MacroTable::~MacroTable()
+{
+	Clear();
+}
+
+
+
+/*************************************************************************************************/
+/**
+	MacroTable::Clear()
+
+	Deletes all the macros, so that they can be defined again by a repeated first pass
+*/
+/*************************************************************************************************/
+void MacroTable::Clear()
 {
 	for ( map< std::string, Macro* >::iterator it = m_map.begin(); it != m_map.end(); ++it )
 	{
 		delete it->second;
 	}
+
+	m_map.clear();
 }
 
 
@@ -26,6 +26,7 @@
 #include <cassert>
 #include <cstdlib>
 #include <map>
+#include <memory>
 #include <string>
 #include <vector>
 #include "sourcecode.h"
@@ -73,6 +74,8 @@ public:
 		return m_body;
 	}
 
+	const std::shared_ptr<SourceText>& GetSourceText() const;
+
 	const std::string& GetFilename() const
 	{
 		return m_filename;
@@ -92,6 +95,7 @@ private:
 	std::string						m_name;
 	std::vector< std::string >		m_parameters;
 	std::string						m_body;
+	mutable std::shared_ptr<SourceText>	m_source;
 
 };
 
@@ -115,6 +119,7 @@ public:
 	static inline MacroTable& Instance() { assert( m_gInstance != NULL ); return *m_gInstance; }
 
 	void Add( Macro* macro );
+	void Clear();
 	bool Exists( const std::string& name ) const;
 	const Macro* Get( const std::string& name ) const;
 
@@ -125,7 +130,7 @@ private:
 
 	std::map< std::string, Macro* >	m_map;
 
-	static MacroTable*				m_gInstance;
+	static thread_local MacroTable*	m_gInstance;
 };
 
 
@@ -24,24 +24,17 @@
 
 #include <iostream>
 #include <cstring>
-#include <cstdlib>
-#include <ctime>
 
-#include "main.h"
-#include "sourcefile.h"
-#include "asmexception.h"
-#include "globaldata.h"
-#include "objectcode.h"
-#include "symboltable.h"
-#include "discimage.h"
-#include "macro.h"
-#include "random.h"
-#include "version.h"
+#include "commandline.h"
+#include "filecache.h"
+#include "server.h"
+#include "watch.h"
 
 
 using namespace std;
 
 
+
 /*************************************************************************************************/
 /**
 	main()
@@ -55,306 +48,26 @@ using namespace std;
 
 int main( int argc, char* argv[] )
 {
-	const char* pInputFile = NULL;
-	const char* pOutputFile = NULL;
-	const char* pDiscInputFile = NULL;
-	const char* pDiscOutputFile = NULL;
-	const char* pLabelsOutputFile = NULL;
-
-	enum STATES
-	{
-		READY,
-		WAITING_FOR_INPUT_FILENAME,
-		WAITING_FOR_OUTPUT_FILENAME,
-		WAITING_FOR_DISC_INPUT_FILENAME,
-		WAITING_FOR_DISC_OUTPUT_FILENAME,
-		WAITING_FOR_BOOT_FILENAME,
-		WAITING_FOR_DISC_OPTION,
-		WAITING_FOR_DISC_TITLE,
-		WAITING_FOR_DISC_CYCLE,
-		WAITING_FOR_SYMBOL,
-		WAITING_FOR_STRING_SYMBOL,
-		WAITING_FOR_LABELS_FILE
-
-	} state = READY;
-
-	bool bDumpSymbols = false;
-	bool bDumpAllSymbols = false;
-
-	GlobalData::Create();
-	SymbolTable::Create();
-
-	// Parse command line parameters
-
-	for ( int i = 1; i < argc; i++ )
+	if ( argc >= 3 && strcmp( argv[1], "--server" ) == 0 )
 	{
-		switch ( state )
-		{
-			case READY:
-
-				if ( strcmp( argv[i], "-i" ) == 0 )
-				{
-					state = WAITING_FOR_INPUT_FILENAME;
-				}
-				else if ( strcmp( argv[i], "-o" ) == 0 )
-				{
-					state = WAITING_FOR_OUTPUT_FILENAME;
-				}
-				else if ( strcmp( argv[i], "-do" ) == 0 )
-				{
-					state = WAITING_FOR_DISC_OUTPUT_FILENAME;
-				}
-				else if ( strcmp( argv[i], "-di" ) == 0 )
-				{
-					state = WAITING_FOR_DISC_INPUT_FILENAME;
-				}
-				else if ( strcmp( argv[i], "-boot" ) == 0 )
-				{
-					state = WAITING_FOR_BOOT_FILENAME;
-				}
-				else if ( strcmp( argv[i], "-labels" ) == 0 )
-				{
-					state = WAITING_FOR_LABELS_FILE;
-				}
-				else if ( strcmp( argv[i], "-opt" ) == 0 )
-				{
-					state = WAITING_FOR_DISC_OPTION;
-				}
-				else if ( strcmp( argv[i], "-title" ) == 0 )
-				{
-					state = WAITING_FOR_DISC_TITLE;
-				}
-				else if ( strcmp( argv[i], "-cycle" ) == 0 )
-				{
-					state = WAITING_FOR_DISC_CYCLE;
-				}
-				else if ( strcmp( argv[i], "-w" ) == 0 )
-				{
-					GlobalData::Instance().SetRequireDistinctOpcodes( true );
-				}
-				else if ( strcmp( argv[i], "-vc" ) == 0 )
-				{
-					GlobalData::Instance().SetUseVisualCppErrorFormat( true );
-				}
-				else if ( strcmp( argv[i], "-v" ) == 0 )
-				{
-					GlobalData::Instance().SetVerbose( true );
-				}
-				else if ( strcmp( argv[i], "-q" ) == 0 )
-				{
-					GlobalData::Instance().SetVerbose( false );
-				}
-				else if ( strcmp( argv[i], "-d" ) == 0 )
-				{
-					bDumpSymbols = true;
-				}
-				else if ( strcmp( argv[i], "-dd" ) == 0 )
-				{
-					bDumpAllSymbols = true;
-				}
-				else if ( strcmp( argv[i], "-D" ) == 0 )
-				{
-					state = WAITING_FOR_SYMBOL;
-				}
-				else if ( strcmp( argv[i], "-S" ) == 0 )
-				{
-					state = WAITING_FOR_STRING_SYMBOL;
-				}
-				else if ( ( strcmp( argv[i], "--help" ) == 0 ) ||
-					  ( strcmp( argv[i], "-help" ) == 0 ) ||
-					  ( strcmp( argv[i], "-h" ) == 0 ) )
-				{
-					cout << "beebasm " VERSION << endl << endl;
-					cout << "Possible options:" << endl;
-					cout << " -i <file>      Specify source filename" << endl;
-					cout << " -o <file>      Specify output filename (when not specified by SAVE command)" << endl;
-					cout << " -di <file>     Specify a disc image file to be added to" << endl;
-					cout << " -do <file>     Specify a disc image file to output" << endl;
-					cout << " -boot <file>   Specify a filename to be run by !BOOT on a new disc image" << endl;
-					cout << " -labels <file> Specify a filename to export any labels dumped with -d or -dd to" << endl;
-					cout << " -opt <opt>     Specify the *OPT 4,n for the generated disc image" << endl;
-					cout << " -title <title> Specify the title for the generated disc image" << endl;
-					cout << " -cycle <n>     Specify the cycle for the generated disc image" << endl;
-					cout << " -v             Verbose output" << endl;
-					cout << " -d             Dump all global symbols after assembly" << endl;
-					cout << " -dd            Dump all global and local symbols after assembly" << endl;
-					cout << " -w             Require whitespace between opcodes and labels" << endl;
-					cout << " -vc            Use Visual C++-style error messages" << endl;
-					cout << " -D <sym>=<val> Define numeric symbol prior to assembly" << endl;
-					cout << " -S <sym>=<str> Define string symbol prior to assembly" << endl;
-					cout << " --help         See this help again" << endl;
-					return EXIT_SUCCESS;
-				}
-				else
-				{
-					cerr << "Bad parameter: " << argv[i] << endl;
-					cerr << "Type beebasm --help for options" << endl;
-					return EXIT_FAILURE;
-				}
-				break;
-
-
-			case WAITING_FOR_INPUT_FILENAME:
-
-				pInputFile = argv[i];
-				state = READY;
-				break;
-
-
-			case WAITING_FOR_OUTPUT_FILENAME:
-
-				pOutputFile = argv[i];
-				GlobalData::Instance().SetOutputFile( pOutputFile );
-				state = READY;
-				break;
-
-
-			case WAITING_FOR_DISC_OUTPUT_FILENAME:
-
-				pDiscOutputFile = argv[i];
-				GlobalData::Instance().SetUseDiscImage( true );
-				state = READY;
-				break;
-
-
-			case WAITING_FOR_DISC_INPUT_FILENAME:
-
-				pDiscInputFile = argv[i];
-				state = READY;
-				break;
-
-
-			case WAITING_FOR_BOOT_FILENAME:
-
-				GlobalData::Instance().SetBootFile( argv[i] );
-				state = READY;
-				break;
-
-			case WAITING_FOR_DISC_OPTION:
-
-				GlobalData::Instance().SetDiscOption( std::strtol( argv[i], NULL, 10 ) );
-				state = READY;
-				break;
-
-			case WAITING_FOR_DISC_TITLE:
-
-				if ( strlen( argv[i] ) > 12 )
-				{
-					cerr << "Disc title cannot be longer than 12 characters" << endl;
-					return EXIT_FAILURE;
-				}
-				GlobalData::Instance().SetDiscTitle( argv[i] );
-				state = READY;
-                                break;
-
-			case WAITING_FOR_DISC_CYCLE:
-
-				GlobalData::Instance().SetDiscCycle( std::strtol( argv[i], NULL, 10 ) );
-				state = READY;
-				break;
-
-			case WAITING_FOR_SYMBOL:
-
-				if ( ! SymbolTable::Instance().AddCommandLineSymbol( argv[i] ) )
-				{
-					cerr << "Invalid -D expression: " << argv[i] << endl;
-					return EXIT_FAILURE;
-				}
-				state = READY;
-				break;
-
-			case WAITING_FOR_STRING_SYMBOL:
-
-				if ( ! SymbolTable::Instance().AddCommandLineStringSymbol( argv[i] ) )
-				{
-					cerr << "Invalid -S expression: " << argv[i] << endl;
-					return EXIT_FAILURE;
-				}
-				state = READY;
-				break;
-
-			case WAITING_FOR_LABELS_FILE:
-
-				pLabelsOutputFile = argv[i];
-				state = READY;
-				break;
-		}
-	}
-
-	if ( state != READY )
-	{
-		cerr << "Parameter error -" << endl;
-		cerr << "Type beebasm --help for syntax" << endl;
-		return EXIT_FAILURE;
-	}
-
-	// Check parameters
-
-	if ( pInputFile == NULL )
-	{
-		cerr << "No source file" << endl;
-		return EXIT_FAILURE;
+		return RunServer( argv[2] );
 	}
 
-	if ( ( pDiscInputFile != NULL && pDiscOutputFile == NULL ) ||
-		 ( pDiscInputFile != NULL && pDiscOutputFile != NULL && strcmp( pDiscInputFile, pDiscOutputFile ) == 0 ) )
+	if ( argc >= 3 && strcmp( argv[1], "--client" ) == 0 )
 	{
-		cerr << "If a disc image file is provided as input, a different filename must be provided as output" << endl;
-		return EXIT_FAILURE;
+		return RunClient( argv[2], argc - 2, argv + 2 );
 	}
 
-
-	// All good, start the assembling
-
-	int exitCode = EXIT_SUCCESS;
-
-	ObjectCode::Create();
-	MacroTable::Create();
-
-	time_t randomSeed = time( NULL );
-
-	DiscImage* pDiscIm = NULL;
-
-	try
-	{
-		if ( GlobalData::Instance().UsesDiscImage() )
-		{
-			pDiscIm = new DiscImage( pDiscOutputFile, pDiscInputFile );
-			GlobalData::Instance().SetDiscImage( pDiscIm );
-		}
-
-		for ( int pass = 0; pass < 2; pass++ )
-		{
-			GlobalData::Instance().SetPass( pass );
-			ObjectCode::Instance().InitialisePass();
-			GlobalData::Instance().ResetForId();
-			beebasm_srand( static_cast< unsigned long >( randomSeed ) );
-			SourceFile input( pInputFile, 0 );
-			input.Process();
-		}
-	}
-	catch ( AsmException& e )
+	if ( argc >= 2 && strcmp( argv[1], "--watch" ) == 0 )
 	{
-		e.Print();
-		exitCode = EXIT_FAILURE;
+		return RunWatch( argc - 1, argv + 1 );
 	}
 
-	delete pDiscIm;
+	FileCache::Create();
 
-	if ( (bDumpSymbols || bDumpAllSymbols) && exitCode == EXIT_SUCCESS )
-	{
-		SymbolTable::Instance().Dump(bDumpSymbols, bDumpAllSymbols, pLabelsOutputFile);
-	}
-
-	if ( !GlobalData::Instance().IsSaved() && ObjectCode::Instance().AnyUsed() && exitCode == EXIT_SUCCESS )
-	{
-		cerr << "warning: no SAVE command in source file." << endl;
-	}
+	int exitCode = Assemble( argc, argv, cout, cerr );
 
-	MacroTable::Destroy();
-	ObjectCode::Destroy();
-	SymbolTable::Destroy();
-	GlobalData::Destroy();
+	FileCache::Destroy();
 
 	return exitCode;
 }
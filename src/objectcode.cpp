@@ -20,9 +20,9 @@
 */
 /*************************************************************************************************/
 
+#include <algorithm>
 #include <cstring>
 #include <iostream>
-#include <fstream>
 
 #include "objectcode.h"
 #include "symboltable.h"
@@ -30,7 +30,7 @@
 #include "globaldata.h"
 
 
-ObjectCode* ObjectCode::m_gInstance = NULL;
+thread_local ObjectCode* ObjectCode::m_gInstance = NULL;
 
 
 using namespace std;
@@ -77,12 +77,19 @@ void ObjectCode::Destroy()
 */
 /*************************************************************************************************/
 ObjectCode::ObjectCode()
-	:	m_PC( 0 ),
-	 	m_CPU( 0 )
+	:	m_used( MEMORY_SIZE ),
+		m_guard( MEMORY_SIZE ),
+		m_check( MEMORY_SIZE ),
+		m_dontCheck( MEMORY_SIZE ),
+		m_PC( 0 ),
+	 	m_CPU( 0 ),
+		m_bytesAssembled( 0 ),
+		m_tableStart( -1 ),
+		m_tableEnd( -1 )
 {
 	memset( m_aMemory, 0, sizeof m_aMemory );
-	memset( m_aFlags, 0, sizeof m_aFlags );
-	SymbolTable::Instance().AddBuiltInSymbol( "CPU", m_CPU );
+	SymbolTable::Instance().AddBuiltInSymbol( "P%", &m_PC );
+	SymbolTable::Instance().AddBuiltInSymbol( "CPU", &m_CPU );
 }
 
 
@@ -110,7 +117,6 @@ ObjectCode::~ObjectCode()
 void ObjectCode::SetCPU( int i )
 {
 	m_CPU = i;
-	SymbolTable::Instance().ChangeBuiltInSymbol( "CPU", m_CPU );
 }
 
 
@@ -128,11 +134,10 @@ void ObjectCode::InitialisePass()
 
 	SetCPU( 0 );
 	SetPC( 0 );
-	SymbolTable::Instance().ChangeBuiltInSymbol( "P%", m_PC );
 
 	// Clear flags between passes
 
-	Clear( 0, 0x10000, false );
+	Clear( 0, MEMORY_SIZE, false );
 
 	// initialise ascii mapping table
 
@@ -140,6 +145,94 @@ void ObjectCode::InitialisePass()
 	{
 		m_aMapChar[ i ] = i + 32;
 	}
+
+	// Tables are found afresh on each first pass (which may be repeated with -relax), and kept
+	// for the second
+
+	EndTable();
+
+	if ( GlobalData::Instance().IsFirstPass() )
+	{
+		m_tables.clear();
+	}
+
+	m_warnedTables.clear();
+}
+
+
+
+/*************************************************************************************************/
+/**
+	ObjectCode::EndTable()
+
+	Records the table being gathered, if anything was assembled in it, so that nothing more is
+	added to it
+*/
+/*************************************************************************************************/
+void ObjectCode::EndTable()
+{
+	if ( m_tableEnd > m_tableStart )
+	{
+		int& end = m_tables[ m_tableStart ];
+		end = max( end, m_tableEnd );
+	}
+
+	m_tableStart = -1;
+	m_tableEnd = -1;
+}
+
+
+
+/*************************************************************************************************/
+/**
+	ObjectCode::NoteLabel()
+
+	Notes that a label has been defined at the PC on the first pass, which ends the table being
+	gathered and starts another
+*/
+/*************************************************************************************************/
+void ObjectCode::NoteLabel()
+{
+	EndTable();
+
+	m_tableStart = m_PC;
+	m_tableEnd = m_PC;
+}
+
+
+
+/*************************************************************************************************/
+/**
+	ObjectCode::FindTable()
+
+	Finds the table found on the first pass which contains an address
+
+	@param		addr			The address
+	@param		start			Filled in with the address of the table's label
+	@param		end				Filled in with the address just past the table
+
+	@return		false if no table contains the address
+*/
+/*************************************************************************************************/
+bool ObjectCode::FindTable( int addr, int& start, int& end ) const
+{
+	map<int, int>::const_iterator it = m_tables.upper_bound( addr );
+
+	if ( it == m_tables.begin() )
+	{
+		return false;
+	}
+
+	--it;
+
+	if ( addr >= it->second )
+	{
+		return false;
+	}
+
+	start = it->first;
+	end = it->second;
+	return true;
 }
 
 
@@ -152,28 +245,28 @@ void ObjectCode::InitialisePass()
 /*************************************************************************************************/
 void ObjectCode::PutByte( unsigned int byte )
 {
-	if ( m_PC > 0xFFFF )
+	if ( m_PC >= MEMORY_SIZE )
 	{
 		throw AsmException_AssembleError_OutOfMemory();
 	}
 
-	assert( m_PC >= 0 && m_PC < 0x10000 );
+	assert( m_PC >= 0 && m_PC < MEMORY_SIZE );
 	assert( byte < 0x100 );
 
-	if ( m_aFlags[ m_PC ] & GUARD )
+	if ( m_guard.Test( m_PC ) )
 	{
 		throw AsmException_AssembleError_GuardHit();
 	}
 
-	if ( m_aFlags[ m_PC ] & USED )
+	if ( m_used.Test( m_PC ) )
 	{
 		throw AsmException_AssembleError_Overlap();
 	}
 
-	m_aFlags[ m_PC ] |= USED;
+	m_used.Set( m_PC );
 	m_aMemory[ m_PC++ ] = byte;
-
-	SymbolTable::Instance().ChangeBuiltInSymbol( "P%", m_PC );
+	m_bytesAssembled++;
+	ExtendTable( 1 );
 }
 
 
@@ -187,36 +280,37 @@ void ObjectCode::PutByte( unsigned int byte )
 /*************************************************************************************************/
 void ObjectCode::Assemble1( unsigned int opcode )
 {
-	if ( m_PC > 0xFFFF )
+	if ( m_PC >= MEMORY_SIZE )
 	{
 		throw AsmException_AssembleError_OutOfMemory();
 	}
 
-	assert( m_PC >= 0 && m_PC < 0x10000 );
+	assert( m_PC >= 0 && m_PC < MEMORY_SIZE );
 	assert( opcode < 0x100 );
 
 	if ( GlobalData::Instance().IsSecondPass() &&
-		 ( m_aFlags[ m_PC ] & CHECK ) &&
-		 !( m_aFlags[ m_PC ] & DONT_CHECK ) &&
+		 m_check.Test( m_PC ) &&
+		 !m_dontCheck.Test( m_PC ) &&
 		 m_aMemory[ m_PC ] != opcode )
 	{
 		throw AsmException_AssembleError_InconsistentCode();
 	}
 
-	if ( m_aFlags[ m_PC ] & GUARD )
+	if ( m_guard.Test( m_PC ) )
 	{
 		throw AsmException_AssembleError_GuardHit();
 	}
 
-	if ( m_aFlags[ m_PC ] & USED )
+	if ( m_used.Test( m_PC ) )
 	{
 		throw AsmException_AssembleError_Overlap();
 	}
 
-	m_aFlags[ m_PC ] |= ( USED | CHECK );
+	m_used.Set( m_PC );
+	m_check.Set( m_PC );
 	m_aMemory[ m_PC++ ] = opcode;
-
-	SymbolTable::Instance().ChangeBuiltInSymbol( "P%", m_PC );
+	m_bytesAssembled++;
+	ExtendTable( 1 );
 }
 
 
@@ -230,41 +324,42 @@ void ObjectCode::Assemble1( unsigned int opcode )
 /*************************************************************************************************/
 void ObjectCode::Assemble2( unsigned int opcode, unsigned int val )
 {
-	if ( m_PC > 0xFFFE )
+	if ( m_PC > MEMORY_SIZE - 2 )
 	{
 		throw AsmException_AssembleError_OutOfMemory();
 	}
 
-	assert( m_PC >= 0 && m_PC < 0x10000 );
+	assert( m_PC >= 0 && m_PC < MEMORY_SIZE );
 	assert( opcode < 0x100 );
 	assert( val < 0x100 );
 
 	if ( GlobalData::Instance().IsSecondPass() &&
-		 ( m_aFlags[ m_PC ] & CHECK ) &&
-		 !( m_aFlags[ m_PC ] & DONT_CHECK ) &&
+		 m_check.Test( m_PC ) &&
+		 !m_dontCheck.Test( m_PC ) &&
 		 m_aMemory[ m_PC ] != opcode )
 	{
 		throw AsmException_AssembleError_InconsistentCode();
 	}
 
-	if ( ( m_aFlags[ m_PC ] & GUARD ) ||
-		 ( m_aFlags[ m_PC + 1 ] & GUARD ) )
+	if ( m_guard.Test( m_PC ) ||
+		 m_guard.Test( m_PC + 1 ) )
 	{
 		throw AsmException_AssembleError_GuardHit();
 	}
 
-	if ( ( m_aFlags[ m_PC ] & USED ) ||
-		 ( m_aFlags[ m_PC + 1 ] & USED ) )
+	if ( m_used.Test( m_PC ) ||
+		 m_used.Test( m_PC + 1 ) )
 	{
 		throw AsmException_AssembleError_Overlap();
 	}
 
-	m_aFlags[ m_PC ] |= ( USED | CHECK );
+	m_used.Set( m_PC );
+	m_check.Set( m_PC );
 	m_aMemory[ m_PC++ ] = opcode;
-	m_aFlags[ m_PC ] |= USED;
+	m_used.Set( m_PC );
 	m_aMemory[ m_PC++ ] = val;
-
-	SymbolTable::Instance().ChangeBuiltInSymbol( "P%", m_PC );
+	m_bytesAssembled += 2;
+	ExtendTable( 2 );
 }
 
 
@@ -278,45 +373,46 @@ void ObjectCode::Assemble2( unsigned int opcode, unsigned int val )
 /*************************************************************************************************/
 void ObjectCode::Assemble3( unsigned int opcode, unsigned int addr )
 {
-	if ( m_PC > 0xFFFD )
+	if ( m_PC > MEMORY_SIZE - 3 )
 	{
 		throw AsmException_AssembleError_OutOfMemory();
 	}
 
-	assert( m_PC >= 0 && m_PC < 0x10000 );
+	assert( m_PC >= 0 && m_PC < MEMORY_SIZE );
 	assert( opcode < 0x100 );
 	assert( addr < 0x10000 );
 
 	if ( GlobalData::Instance().IsSecondPass() &&
-		 ( m_aFlags[ m_PC ] & CHECK ) &&
-		 !( m_aFlags[ m_PC ] & DONT_CHECK ) &&
+		 m_check.Test( m_PC ) &&
+		 !m_dontCheck.Test( m_PC ) &&
 		 m_aMemory[ m_PC ] != opcode )
 	{
 		throw AsmException_AssembleError_InconsistentCode();
 	}
 
-	if ( ( m_aFlags[ m_PC ] & GUARD ) ||
-		 ( m_aFlags[ m_PC + 1 ] & GUARD ) ||
-		 ( m_aFlags[ m_PC + 2 ] & GUARD ) )
+	if ( m_guard.Test( m_PC ) ||
+		 m_guard.Test( m_PC + 1 ) ||
+		 m_guard.Test( m_PC + 2 ) )
 	{
 		throw AsmException_AssembleError_GuardHit();
 	}
 
-	if ( ( m_aFlags[ m_PC ] & USED ) ||
-		 ( m_aFlags[ m_PC + 1 ] & USED ) ||
-		 ( m_aFlags[ m_PC + 2 ] & USED ) )
+	if ( m_used.Test( m_PC ) ||
+		 m_used.Test( m_PC + 1 ) ||
+		 m_used.Test( m_PC + 2 ) )
 	{
 		throw AsmException_AssembleError_Overlap();
 	}
 
-	m_aFlags[ m_PC ] |= ( USED | CHECK );
+	m_used.Set( m_PC );
+	m_check.Set( m_PC );
 	m_aMemory[ m_PC++ ] = opcode;
-	m_aFlags[ m_PC ] |= USED;
+	m_used.Set( m_PC );
 	m_aMemory[ m_PC++ ] = addr & 0xFF;
-	m_aFlags[ m_PC ] |= USED;
+	m_used.Set( m_PC );
 	m_aMemory[ m_PC++ ] = ( addr & 0xFF00 ) >> 8;
-
-	SymbolTable::Instance().ChangeBuiltInSymbol( "P%", m_PC );
+	m_bytesAssembled += 3;
+	ExtendTable( 3 );
 }
 
 
@@ -328,8 +424,8 @@ void ObjectCode::Assemble3( unsigned int opcode, unsigned int addr )
 /*************************************************************************************************/
 void ObjectCode::SetGuard( int addr )
 {
-	assert( addr >= 0 && addr < 0x10000 );
-	m_aFlags[ addr ] |= GUARD;
+	assert( addr >= 0 && addr < MEMORY_SIZE );
+	m_guard.Set( addr );
 }
 
 
@@ -342,8 +438,8 @@ void ObjectCode::SetGuard( int addr )
 void ObjectCode::Clear( int start, int end, bool bAll )
 {
 	assert( start <= end );
-	assert( start >= 0 && start < 0x10000 );
-	assert( end > 0 && end <= 0x10000 );
+	assert( start >= 0 && start < MEMORY_SIZE );
+	assert( end > 0 && end <= MEMORY_SIZE );
 
 	// Nothing to do if start == end
 	if ( start == end )
@@ -357,17 +453,18 @@ void ObjectCode::Clear( int start, int end, bool bAll )
 		// as soon as we force a block to be cleared, we can no longer do inconsistency checks on
 		// the object code, so we flag the whole block as DONT_CHECK
 		memset( m_aMemory + start, 0, end - start );
-		memset( m_aFlags + start, DONT_CHECK, end - start );
+		m_used.ResetRange( start, end );
+		m_guard.ResetRange( start, end );
+		m_check.ResetRange( start, end );
+		m_dontCheck.SetRange( start, end );
 	}
 	else
 	{
 		// between first and second pass
 		// we preserve the memory image and the CHECK flags so that we can test for inconsistencies
 		// in the assembled code between first and second passes
-		for ( unsigned char* i = m_aFlags + start; i < m_aFlags + end; i++ )
-		{
-			(*i) &= ( CHECK | DONT_CHECK );
-		}
+		m_used.ResetRange( start, end );
+		m_guard.ResetRange( start, end );
 	}
 }
 
@@ -376,38 +473,92 @@ void ObjectCode::Clear( int start, int end, bool bAll )
 /*************************************************************************************************/
 /**
 	ObjectCode::IncBin()
+
+	Assembles a block of bytes to the memory image.  This has the same effect as calling
+	Assemble1() for each byte in turn, and reports the same error for the first byte which can't
+	be assembled, but the whole target range is validated before anything is written.
+
+	@param		data			The bytes to assemble
+	@param		length			The number of bytes
 */
 /*************************************************************************************************/
-void ObjectCode::IncBin( const char* filename, std::vector<unsigned char>& firstFour )
+void ObjectCode::IncBin( const unsigned char* data, size_t length )
 {
-	ifstream binfile;
+	assert( m_PC >= 0 );
 
-	binfile.open( filename, ios_base::in | ios_base::binary );
+	if ( length == 0 )
+	{
+		return;
+	}
+
+	// Only the part of the block that fits below the top of memory can be assembled
 
-	if ( !binfile )
+	if ( m_PC >= MEMORY_SIZE )
 	{
-		throw AsmException_AssembleError_FileOpen();
+		throw AsmException_AssembleError_OutOfMemory();
 	}
 
-	char c;
+	size_t room = static_cast< size_t >( MEMORY_SIZE - m_PC );
+	int fitsEnd = m_PC + static_cast< int >( min( length, room ) );
+
+	// Usually the whole range is unused and unguarded, and on the second pass holds what the
+	// first pass assembled there, so one comparison checks the lot
+
+	bool secondPass = GlobalData::Instance().IsSecondPass();
+
+	if ( m_used.AnyInRange( m_PC, fitsEnd ) ||
+		 m_guard.AnyInRange( m_PC, fitsEnd ) )
+	{
+		for ( int addr = m_PC; addr < fitsEnd; addr++ )
+		{
+			if ( secondPass &&
+				 m_check.Test( addr ) &&
+				 !m_dontCheck.Test( addr ) &&
+				 m_aMemory[ addr ] != data[ addr - m_PC ] )
+			{
+				throw AsmException_AssembleError_InconsistentCode();
+			}
+
+			if ( m_guard.Test( addr ) )
+			{
+				throw AsmException_AssembleError_GuardHit();
+			}
 
-	while ( binfile.get( c ) )
+			if ( m_used.Test( addr ) )
+			{
+				throw AsmException_AssembleError_Overlap();
+			}
+		}
+	}
+	else if ( secondPass &&
+			  memcmp( m_aMemory + m_PC, data, static_cast< size_t >( fitsEnd - m_PC ) ) != 0 )
 	{
-		assert( binfile.gcount() == 1 );
-		unsigned char uc = static_cast< unsigned char >( c );
-		if ( firstFour.size() < 4 )
+		// Only a difference in a byte which the first pass assembled, and which hasn't been
+		// CLEARed since, is an error
+
+		for ( int addr = m_PC; addr < fitsEnd; addr++ )
 		{
-			firstFour.push_back(uc);
+			if ( m_aMemory[ addr ] != data[ addr - m_PC ] &&
+				 m_check.Test( addr ) &&
+				 !m_dontCheck.Test( addr ) )
+			{
+				throw AsmException_AssembleError_InconsistentCode();
+			}
 		}
-		Assemble1( uc );
 	}
 
-	if ( !binfile.eof() )
+	if ( fitsEnd - m_PC < static_cast< int >( length ) )
 	{
-		throw AsmException_AssembleError_FileRead();
+		throw AsmException_AssembleError_OutOfMemory();
 	}
 
-	binfile.close();
+	memcpy( m_aMemory + m_PC, data, length );
+	m_used.SetRange( m_PC, fitsEnd );
+	m_check.SetRange( m_PC, fitsEnd );
+
+	m_PC += static_cast< int >( length );
+	m_bytesAssembled += static_cast< int >( length );
+	ExtendTable( static_cast< int >( length ) );
 }
 
 
@@ -449,55 +600,54 @@ void ObjectCode::CopyBlock( int start, int end, int dest, bool firstPass )
 {
 	int length = end - start;
 
-	if ( start + length > 0x10000 ||
-		 dest + length > 0x10000 )
+	if ( start + length > MEMORY_SIZE ||
+		 dest + length > MEMORY_SIZE )
 	{
 		throw AsmException_AssembleError_OutOfMemory();
 	}
 
+	if ( m_guard.AnyInRange( dest, dest + length ) )
+	{
+		throw AsmException_AssembleError_GuardHit();
+	}
+
 	if (firstPass)
 	{
+		// Byte by byte, so that overlapping blocks behave exactly as they always have
 		for ( int i = 0; i < length; i++ )
 		{
-			if ( m_aFlags[ dest + i ] & GUARD )
+			if ( m_used.Test( start + i ) )
 			{
-				throw AsmException_AssembleError_GuardHit();
+				m_used.Set( dest + i );
 			}
-
-			m_aFlags[ dest + i ] |= (m_aFlags[ start + i ] & USED);
 		}
 	}
-	else if ( start < dest )
+	else if ( start != dest )
 	{
-		for ( int i = length - 1; i >= 0; i-- )
-		{
-			if ( m_aFlags[ dest + i ] & GUARD )
-			{
-				throw AsmException_AssembleError_GuardHit();
-			}
+		memmove( m_aMemory + dest, m_aMemory + start, length );
 
-			m_aMemory[ dest + i ] = m_aMemory[ start + i ];
-			m_aFlags[ dest + i ] = m_aFlags[ start + i ];
-			m_aFlags[ start + i ] &= ( CHECK | DONT_CHECK );
-		}
-	}
-	else if ( start > dest )
-	{
-		for ( int i = 0; i < length; i++ )
-		{
-			if ( m_aFlags[ dest + i ] & GUARD )
-			{
-				throw AsmException_AssembleError_GuardHit();
-			}
+		// The destination takes all the flags of the source, and the source is no longer used
+		// or guarded (except where it overlaps the destination)
 
-			m_aMemory[ dest + i ] = m_aMemory[ start + i ];
-			m_aFlags[ dest + i ] = m_aFlags[ start + i ];
-			m_aFlags[ start + i ] &= ( CHECK | DONT_CHECK );
-		}
+		AddressSet::Bits bits;
+
+		m_used.GetRange( start, length, bits );
+		m_used.ResetRange( start, end );
+		m_used.PutRange( dest, length, bits );
+
+		m_guard.GetRange( start, length, bits );
+		m_guard.ResetRange( start, end );
+		m_guard.PutRange( dest, length, bits );
+
+		m_check.GetRange( start, length, bits );
+		m_check.PutRange( dest, length, bits );
+
+		m_dontCheck.GetRange( start, length, bits );
+		m_dontCheck.PutRange( dest, length, bits );
 	}
 }
 
-#define ARRAY_LENGTH(a) (sizeof(a) / sizeof(a[0]))
+
 
 /*************************************************************************************************/
 /**
@@ -506,13 +656,5 @@ void ObjectCode::CopyBlock( int start, int end, int dest, bool firstPass )
 /*************************************************************************************************/
 bool ObjectCode::AnyUsed() const
 {
-	for (unsigned int i = 0; i < ARRAY_LENGTH(m_aFlags); ++i)
-	{
-		if ( m_aFlags[i] & USED )
-		{
-			return true;
-		}
-	}
-
-	return false;
+	return m_used.Any();
 }
@@ -25,8 +25,12 @@
 
 #include <cassert>
 #include <cstdlib>
+#include <map>
+#include <set>
 #include <vector>
 
+#include "addressset.h"
+
 
 class ObjectCode
 {
@@ -36,12 +40,19 @@ public:
 	static void Destroy();
 	static inline ObjectCode& Instance() { assert( m_gInstance != NULL ); return *m_gInstance; }
 
+	// The size of the memory image
+
+	#define MEMORY_SIZE		0x10000
+
 	inline void SetPC( int i )		{ m_PC = i; }
 	inline int GetPC() const		{ return m_PC; }
 
 	void SetCPU( int i );
 	inline int GetCPU() const		{ return m_CPU; }
 
+	// Bytes assembled so far, over every pass, including any later overwritten after CLEAR
+	inline int GetBytesAssembled() const { return m_bytesAssembled; }
+
 	inline const unsigned char* GetAddr( int i ) const { return m_aMemory + i; }
 
 	void InitialisePass();
@@ -50,7 +61,7 @@ public:
 	void Assemble1( unsigned int opcode );
 	void Assemble2( unsigned int opcode, unsigned int val );
 	void Assemble3( unsigned int opcode, unsigned int addr );
-	void IncBin( const char* filename, std::vector<unsigned char>& firstFour );
+	void IncBin( const unsigned char* data, size_t length );
 
 	void SetGuard( int i );
 	void Clear( int start, int end, bool bAll = true );
@@ -62,33 +73,51 @@ public:
 
 	bool AnyUsed() const;
 
-private:
+	// Tables, for the page crossing checks.  On the first pass each label starts a table of the
+	// bytes assembled straight after it, up to the next label, ALIGN or SKIPTO; on the second
+	// pass, an indexed access can then be checked against the whole of the table it indexes.
 
-	// Each byte in the memory map has a set of flags
-	enum FLAGS
-	{
-		// This memory location has been used so don't assemble over it
-		USED  = (1 << 0),
-		// This memory location has been guarded so don't assemble over it
-		GUARD = (1 << 1),
-		// On the second pass, check that opcodes match what was written on the first pass
-		CHECK = (1 << 2),
-		// Suppress the opcode check (set by CLEAR)
-		DONT_CHECK = (1 << 3)
-	};
+	void NoteLabel();
+	void EndTable();
+	bool FindTable( int addr, int& start, int& end ) const;
+	inline bool MarkTableWarned( int start )	{ return m_warnedTables.insert( start ).second; }
 
+private:
 
 	ObjectCode();
 	~ObjectCode();
 
-	unsigned char				m_aMemory[ 0x10000 ];
-	unsigned char				m_aFlags[ 0x10000 ];
+	// Called once length bytes have been assembled at the PC, so that they extend the table
+	// being gathered if they follow on from it
+	inline void ExtendTable( int length )	{ if ( m_PC - length == m_tableEnd ) m_tableEnd = m_PC; }
+
+	// Each byte in the memory map has a set of flags, each of which is held as the set of
+	// addresses it applies to
+
+	// This memory location has been used so don't assemble over it
+	AddressSet					m_used;
+	// This memory location has been guarded so don't assemble over it
+	AddressSet					m_guard;
+	// On the second pass, check that opcodes match what was written on the first pass
+	AddressSet					m_check;
+	// Suppress the opcode check (set by CLEAR)
+	AddressSet					m_dontCheck;
+
+	unsigned char				m_aMemory[ MEMORY_SIZE ];
 	int							m_PC;
 	int							m_CPU;
+	int							m_bytesAssembled;
+
+	// The tables found on the first pass, as the end of each keyed by its start, and the one
+	// being gathered
+	std::map<int, int>			m_tables;
+	int							m_tableStart;
+	int							m_tableEnd;
+	std::set<int>				m_warnedTables;
 
 	unsigned char				m_aMapChar[ 96 ];
 
-	static ObjectCode*			m_gInstance;
+	static thread_local ObjectCode*	m_gInstance;
 };
 
 
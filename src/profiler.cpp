@@ -0,0 +1,351 @@
+/*************************************************************************************************/
+/**
+	profiler.cpp
+
+	Attributes the time spent assembling to each line of source, with -profile
+
+
+	Copyright (C) Rich Talbot-Watkins 2007 - 2012
+
+	This file is part of BeebAsm.
+
+	BeebAsm is free software: you can redistribute it and/or modify it under the terms of the GNU
+	General Public License as published by the Free Software Foundation, either version 3 of the
+	License, or (at your option) any later version.
+
+	BeebAsm is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without
+	even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License along with BeebAsm, as
+	COPYING.txt.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/*************************************************************************************************/
+
+#include "profiler.h"
+
+#ifdef BEEBASM_PROFILER
+
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+#include "filecache.h"
+#include "objectcode.h"
+
+using namespace std;
+
+
+thread_local Profiler* Profiler::m_gInstance = NULL;
+
+
+/*************************************************************************************************/
+/**
+	Profiler::Create()
+
+	Creates the Profiler singleton
+*/
+/*************************************************************************************************/
+void Profiler::Create()
+{
+	assert( m_gInstance == NULL );
+
+	m_gInstance = new Profiler;
+}
+
+
+
+/*************************************************************************************************/
+/**
+	Profiler::Destroy()
+
+	Destroys the Profiler singleton
+*/
+/*************************************************************************************************/
+void Profiler::Destroy()
+{
+	assert( m_gInstance != NULL );
+
+	delete m_gInstance;
+	m_gInstance = NULL;
+}
+
+
+
+/*************************************************************************************************/
+/**
+	Profiler::Profiler()
+
+	Profiler constructor
+*/
+/*************************************************************************************************/
+Profiler::Profiler()
+	:	m_bEnabled( false ),
+		m_lastFile( -1 )
+{
+}
+
+
+
+/*************************************************************************************************/
+/**
+	Profiler::~Profiler()
+
+	Profiler destructor
+*/
+/*************************************************************************************************/
+Profiler::~Profiler()
+{
+}
+
+
+
+/*************************************************************************************************/
+/**
+	Profiler::FindFile()
+
+	Returns the index of a file, adding it if it hasn't been seen before
+*/
+/*************************************************************************************************/
+int Profiler::FindFile( const string& filename )
+{
+	if ( m_lastFile >= 0 && filename == m_lastFilename )
+	{
+		return m_lastFile;
+	}
+
+	unordered_map<string, int>::const_iterator it = m_fileIndices.find( filename );
+
+	if ( it != m_fileIndices.end() )
+	{
+		m_lastFile = it->second;
+	}
+	else
+	{
+		m_lastFile = static_cast<int>( m_filenames.size() );
+		m_fileIndices[ filename ] = m_lastFile;
+		m_filenames.push_back( filename );
+		m_lines.push_back( vector<LineStats>() );
+	}
+
+	m_lastFilename = filename;
+	return m_lastFile;
+}
+
+
+
+/*************************************************************************************************/
+/**
+	Profiler::EnterLine()
+
+	Starts timing a line
+
+	@param		filename		The file the line is in
+	@param		lineNumber		Its line number
+	@param		text			The text of the line, kept the first time it's seen
+*/
+/*************************************************************************************************/
+void Profiler::EnterLine( const string& filename, int lineNumber, const string& text )
+{
+	Frame frame;
+	frame.m_file = FindFile( filename );
+	frame.m_line = lineNumber;
+	frame.m_startBytes = ObjectCode::Instance().GetBytesAssembled();
+	frame.m_childTime = Clock::duration::zero();
+	frame.m_childBytes = 0;
+
+	vector<LineStats>& lines = m_lines[ frame.m_file ];
+
+	if ( lineNumber >= static_cast<int>( lines.size() ) )
+	{
+		lines.resize( lineNumber + 1 );
+	}
+
+	LineStats& stats = lines[ lineNumber ];
+
+	if ( stats.m_count == 0 )
+	{
+		// Kept without indentation, and without tabs, which would split a column of the report
+		size_t start = text.find_first_not_of( " \t" );
+		stats.m_text = ( start == string::npos ) ? string() : text.substr( start );
+		replace( stats.m_text.begin(), stats.m_text.end(), '\t', ' ' );
+	}
+
+	stats.m_count++;
+	stats.m_active++;
+
+	m_frames.push_back( frame );
+
+	// Start the clock last, so that none of the above is counted
+	m_frames.back().m_start = Clock::now();
+}
+
+
+
+/*************************************************************************************************/
+/**
+	Profiler::LeaveLine()
+
+	Stops timing the line most recently entered, and adds its time and bytes to it, and to the
+	line which caused it to be processed
+*/
+/*************************************************************************************************/
+void Profiler::LeaveLine()
+{
+	Clock::time_point now = Clock::now();
+
+	assert( !m_frames.empty() );
+	const Frame& frame = m_frames.back();
+
+	Clock::duration time = now - frame.m_start;
+
+	long long bytes = ObjectCode::Instance().GetBytesAssembled() - frame.m_startBytes;
+
+	LineStats& stats = m_lines[ frame.m_file ][ frame.m_line ];
+
+	stats.m_selfTime += time - frame.m_childTime;
+	stats.m_selfBytes += max( 0LL, bytes - frame.m_childBytes );
+
+	// If a macro invokes itself, only the outermost invocation counts towards the total
+	if ( --stats.m_active == 0 )
+	{
+		stats.m_totalTime += time;
+		stats.m_totalBytes += bytes;
+	}
+
+	m_frames.pop_back();
+
+	if ( !m_frames.empty() )
+	{
+		m_frames.back().m_childTime += time;
+		m_frames.back().m_childBytes += bytes;
+	}
+}
+
+
+
+/*************************************************************************************************/
+/**
+	Profiler::GetEntries()
+
+	Lists every line processed, the line in which the most time was spent first
+*/
+/*************************************************************************************************/
+void Profiler::GetEntries( vector<Entry>& entries ) const
+{
+	for ( size_t file = 0; file < m_lines.size(); file++ )
+	{
+		for ( size_t line = 0; line < m_lines[ file ].size(); line++ )
+		{
+			if ( m_lines[ file ][ line ].m_count > 0 )
+			{
+				Entry entry;
+				entry.m_pStats = &m_lines[ file ][ line ];
+				entry.m_pFilename = &m_filenames[ file ];
+				entry.m_line = static_cast<int>( line );
+				entries.push_back( entry );
+			}
+		}
+	}
+
+	stable_sort( entries.begin(), entries.end(), []( const Entry& a, const Entry& b )
+	{
+		return a.m_pStats->m_selfTime > b.m_pStats->m_selfTime;
+	} );
+}
+
+
+
+/*************************************************************************************************/
+/**
+	Milliseconds()
+*/
+/*************************************************************************************************/
+static double Milliseconds( chrono::steady_clock::duration time )
+{
+	return chrono::duration<double, milli>( time ).count();
+}
+
+
+
+/*************************************************************************************************/
+/**
+	Profiler::PrintHottest()
+
+	Prints the lines in which the most time was spent
+
+	@param		out				Stream to print to
+	@param		count			How many lines to print
+*/
+/*************************************************************************************************/
+void Profiler::PrintHottest( ostream& out, int count ) const
+{
+	vector<Entry> entries;
+	GetEntries( entries );
+
+	out << "Hottest lines, of " << entries.size() << " processed:" << endl;
+	out << "   self ms   total ms      count      bytes  line" << endl;
+
+	for ( size_t i = 0; i < entries.size() && i < static_cast<size_t>( count ); i++ )
+	{
+		const LineStats& stats = *entries[ i ].m_pStats;
+
+		ostringstream location;
+		location << *entries[ i ].m_pFilename << ":" << entries[ i ].m_line;
+
+		out << fixed << setprecision( 2 )
+			<< setw( 10 ) << Milliseconds( stats.m_selfTime ) << " "
+			<< setw( 10 ) << Milliseconds( stats.m_totalTime ) << " "
+			<< setw( 10 ) << stats.m_count << " "
+			<< setw( 10 ) << stats.m_selfBytes << "  "
+			<< location.str() << "  " << stats.m_text.substr( 0, 40 ) << endl;
+	}
+
+	out.unsetf( ios::floatfield );
+}
+
+
+
+/*************************************************************************************************/
+/**
+	Profiler::WriteReport()
+
+	Writes every line processed, as tab-separated values, the line in which the most time was
+	spent first
+
+	@param		filename		File to write the report to
+
+	@return		false if the file couldn't be written
+*/
+/*************************************************************************************************/
+bool Profiler::WriteReport( const string& filename ) const
+{
+	vector<Entry> entries;
+	GetEntries( entries );
+
+	ostringstream report;
+	report << "file\tline\tcount\tself_ms\ttotal_ms\tself_bytes\ttotal_bytes\tsource" << endl;
+	report << fixed << setprecision( 3 );
+
+	for ( size_t i = 0; i < entries.size(); i++ )
+	{
+		const LineStats& stats = *entries[ i ].m_pStats;
+
+		report << *entries[ i ].m_pFilename << '\t'
+			   << entries[ i ].m_line << '\t'
+			   << stats.m_count << '\t'
+			   << Milliseconds( stats.m_selfTime ) << '\t'
+			   << Milliseconds( stats.m_totalTime ) << '\t'
+			   << stats.m_selfBytes << '\t'
+			   << stats.m_totalBytes << '\t'
+			   << stats.m_text << endl;
+	}
+
+	const string& text = report.str();
+
+	return FileCache::Instance().WriteFile( filename, reinterpret_cast<const unsigned char*>( text.data() ), text.size() ) == FileSystem::FILE_OK;
+}
+
+
+#endif // BEEBASM_PROFILER
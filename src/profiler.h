@@ -0,0 +1,175 @@
+/*************************************************************************************************/
+/**
+	profiler.h
+
+
+	Copyright (C) Rich Talbot-Watkins 2007 - 2012
+
+	This file is part of BeebAsm.
+
+	BeebAsm is free software: you can redistribute it and/or modify it under the terms of the GNU
+	General Public License as published by the Free Software Foundation, either version 3 of the
+	License, or (at your option) any later version.
+
+	BeebAsm is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without
+	even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License along with BeebAsm, as
+	COPYING.txt.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/*************************************************************************************************/
+
+#ifndef PROFILER_H_
+#define PROFILER_H_
+
+// The profiler only exists in builds with BEEBASM_PROFILER defined; otherwise PROFILE_LINE()
+// compiles to nothing, and -profile is rejected
+
+#ifdef BEEBASM_PROFILER
+
+#include <cassert>
+#include <chrono>
+#include <cstdlib>
+#include <iosfwd>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+
+/*************************************************************************************************/
+/**
+	Profiler
+
+	With -profile, attributes the time spent, the number of times processed and the bytes
+	assembled to each line of source, across every pass.  Lines inside macros are attributed to
+	the line in the macro definition.
+
+	Each line has a self figure, for the line alone, and a total figure, which also includes
+	whatever the line caused to be processed: the lines of a macro it invoked or a file it
+	included.
+*/
+/*************************************************************************************************/
+class Profiler
+{
+public:
+
+	static void Create();
+	static void Destroy();
+	static inline Profiler& Instance() { assert( m_gInstance != NULL ); return *m_gInstance; }
+
+	// The number of lines listed after assembling
+
+	#define PROFILE_TOP_LINES	10
+
+	inline void			Enable()								{ m_bEnabled = true; }
+	inline bool			IsEnabled() const						{ return m_bEnabled; }
+
+	void				EnterLine( const std::string& filename, int lineNumber, const std::string& text );
+	void				LeaveLine();
+
+	void				PrintHottest( std::ostream& out, int count ) const;
+	bool				WriteReport( const std::string& filename ) const;
+
+
+private:
+
+	Profiler();
+	~Profiler();
+
+	typedef std::chrono::steady_clock Clock;
+
+	struct LineStats
+	{
+		LineStats() : m_count( 0 ), m_selfTime( 0 ), m_totalTime( 0 ), m_selfBytes( 0 ), m_totalBytes( 0 ), m_active( 0 ) {}
+
+		long long			m_count;
+		Clock::duration		m_selfTime;
+		Clock::duration		m_totalTime;
+		long long			m_selfBytes;
+		long long			m_totalBytes;
+		int					m_active;		// how many times the line is being processed right now
+		std::string			m_text;
+	};
+
+	struct Frame
+	{
+		int					m_file;
+		int					m_line;
+		Clock::time_point	m_start;
+		int					m_startBytes;
+		Clock::duration		m_childTime;
+		long long			m_childBytes;
+	};
+
+	struct Entry
+	{
+		const LineStats*	m_pStats;
+		const std::string*	m_pFilename;
+		int					m_line;
+	};
+
+	int					FindFile( const std::string& filename );
+	void				GetEntries( std::vector<Entry>& entries ) const;
+
+	bool										m_bEnabled;
+
+	std::vector<std::string>					m_filenames;
+	std::unordered_map<std::string, int>		m_fileIndices;
+	std::vector< std::vector<LineStats> >		m_lines;		// by file, then by line number
+
+	// The file of the previous line, which is nearly always the file of the next one too
+	std::string									m_lastFilename;
+	int											m_lastFile;
+
+	std::vector<Frame>							m_frames;
+
+	static thread_local Profiler*				m_gInstance;
+};
+
+
+/*************************************************************************************************/
+/**
+	ProfileLine
+
+	Profiles a line from construction until destruction, even if an exception is thrown
+*/
+/*************************************************************************************************/
+class ProfileLine
+{
+public:
+
+	inline ProfileLine( const std::string& filename, int lineNumber, const std::string& text )
+		:	m_bEnabled( Profiler::Instance().IsEnabled() )
+	{
+		if ( m_bEnabled )
+		{
+			Profiler::Instance().EnterLine( filename, lineNumber, text );
+		}
+	}
+
+	inline ~ProfileLine()
+	{
+		if ( m_bEnabled )
+		{
+			Profiler::Instance().LeaveLine();
+		}
+	}
+
+
+private:
+
+	bool	m_bEnabled;
+};
+
+
+#define PROFILE_LINE( filename, lineNumber, text )	ProfileLine profileLine( filename, lineNumber, text )
+
+#else
+
+#define PROFILE_LINE( filename, lineNumber, text )
+
+#endif // BEEBASM_PROFILER
+
+
+#endif // PROFILER_H_
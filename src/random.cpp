@@ -26,7 +26,10 @@
 
 #include "random.h"
 
-static uint_least32_t state = 19670512;
+// Each thread has its own generator, so that assemblies running at the same time don't disturb
+// each other's RND() sequences
+
+static thread_local uint_least32_t state = 19670512;
 
 static uint_least32_t modulus = BEEBASM_RAND_MODULUS;
 
@@ -0,0 +1,155 @@
+/*************************************************************************************************/
+/**
+	scopedsymbolname.cpp
+
+
+	Copyright (C) Charles Reilly 2024
+
+	This file is part of BeebAsm.
+
+	BeebAsm is free software: you can redistribute it and/or modify it under the terms of the GNU
+	General Public License as published by the Free Software Foundation, either version 3 of the
+	License, or (at your option) any later version.
+
+	BeebAsm is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without
+	even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License along with BeebAsm, as
+	COPYING.txt.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/*************************************************************************************************/
+
+#include <cassert>
+#include <unordered_map>
+#include <vector>
+
+#include "scopedsymbolname.h"
+
+using namespace std;
+
+
+/*************************************************************************************************/
+/**
+	InternTable
+
+	The table of interned symbol names.  Atom 0 is always the empty name.
+
+	Each thread has its own table, as atoms index its own symbol table; a ScopedSymbolName must
+	only be used on the thread which created it.  The table lives as long as the AssemblerContext
+	which creates it, so that a thread which runs assembly after assembly doesn't keep every name
+	it has ever seen.
+*/
+/*************************************************************************************************/
+struct InternTable
+{
+	InternTable()
+	{
+		m_atoms[ string() ] = 0;
+		m_names.push_back( &m_atoms.begin()->first );
+	}
+
+	// Keys of an unordered_map don't move when it rehashes, so the name pointers stay valid
+	unordered_map< string, int >	m_atoms;
+	vector< const string* >			m_names;
+};
+
+static thread_local InternTable* gpInternTable = NULL;
+static thread_local int gInternTableGeneration = 0;
+
+static InternTable& GetInternTable()
+{
+	assert( gpInternTable != NULL );
+	return *gpInternTable;
+}
+
+
+
+/*************************************************************************************************/
+/**
+	ScopedSymbolName::CreateInternTable()
+
+	Creates an empty table of interned names for this thread
+*/
+/*************************************************************************************************/
+void ScopedSymbolName::CreateInternTable()
+{
+	assert( gpInternTable == NULL );
+
+	gpInternTable = new InternTable;
+	gInternTableGeneration++;
+}
+
+
+
+/*************************************************************************************************/
+/**
+	ScopedSymbolName::DestroyInternTable()
+
+	Destroys this thread's table of interned names, after which no ScopedSymbolName made with it
+	may be used
+*/
+/*************************************************************************************************/
+void ScopedSymbolName::DestroyInternTable()
+{
+	assert( gpInternTable != NULL );
+
+	delete gpInternTable;
+	gpInternTable = NULL;
+}
+
+
+
+/*************************************************************************************************/
+/**
+	ScopedSymbolName::GetInternTableGeneration()
+
+	Returns a number which changes whenever this thread's table of interned names is created, so
+	that anything which keeps names for longer than the table can tell when they are stale
+*/
+/*************************************************************************************************/
+int ScopedSymbolName::GetInternTableGeneration()
+{
+	return gInternTableGeneration;
+}
+
+
+
+/*************************************************************************************************/
+/**
+	ScopedSymbolName::Intern()
+
+	Returns the atom for a symbol name, adding it to the table if it's new
+*/
+/*************************************************************************************************/
+int ScopedSymbolName::Intern( const string& name )
+{
+	InternTable& table = GetInternTable();
+
+	unordered_map< string, int >::iterator it = table.m_atoms.find( name );
+
+	if ( it != table.m_atoms.end() )
+	{
+		return it->second;
+	}
+
+	int atom = static_cast< int >( table.m_names.size() );
+	it = table.m_atoms.insert( make_pair( name, atom ) ).first;
+	table.m_names.push_back( &it->first );
+
+	return atom;
+}
+
+
+
+/*************************************************************************************************/
+/**
+	ScopedSymbolName::NameOf()
+
+	Returns the symbol name for an atom
+*/
+/*************************************************************************************************/
+const string& ScopedSymbolName::NameOf( int atom )
+{
+	return *GetInternTable().m_names[ atom ];
+}
@@ -23,6 +23,7 @@
 #ifndef SCOPEDSYMBOLNAME_H_
 #define SCOPEDSYMBOLNAME_H_
 
+#include <cstdint>
 #include <functional>
 #include <string>
 
@@ -32,21 +33,32 @@ class ScopedSymbolName
 	friend class std::hash<ScopedSymbolName>;
 
 public:
-	explicit ScopedSymbolName(const std::string& name) : m_name(name), m_id(-1), m_count(-1)
+	explicit ScopedSymbolName(const std::string& name) : m_atom(Intern(name)), m_id(-1), m_count(-1)
 	{
 	}
 
-	ScopedSymbolName(const std::string& name, int id, int count) : m_name(name), m_id(id), m_count(count)
+	ScopedSymbolName(const std::string& name, int id, int count) : m_atom(Intern(name)), m_id(id), m_count(count)
 	{
 	}
 
-	ScopedSymbolName()
+	// The same name in a different scope, without looking the name up again
+	ScopedSymbolName(const ScopedSymbolName& name, int id, int count) : m_atom(name.m_atom), m_id(id), m_count(count)
 	{
 	}
 
-	std::string Name() const
+	ScopedSymbolName() : m_atom(0), m_id(-1), m_count(-1)
 	{
-		return m_name;
+	}
+
+	const std::string& Name() const
+	{
+		return NameOf(m_atom);
+	}
+
+	// A small integer which identifies the name regardless of its scope
+	int Atom() const
+	{
+		return m_atom;
 	}
 
 	bool TopLevel() const
@@ -56,18 +68,19 @@ public:
 
 	bool operator== (const ScopedSymbolName& that) const
 	{
-		return m_name == that.m_name && m_id == that.m_id && m_count == that.m_count;
+		return m_atom == that.m_atom && m_id == that.m_id && m_count == that.m_count;
 	}
 
+	// The table of interned names, which is created and destroyed with the AssemblerContext
+	static void CreateInternTable();
+	static void DestroyInternTable();
+	static int GetInternTableGeneration();
+
 	bool operator< (const ScopedSymbolName& that) const
 	{
-		if (m_name < that.m_name)
-		{
-			return true;
-		}
-		if (m_name > that.m_name)
+		if (m_atom != that.m_atom)
 		{
-			return false;
+			return Name() < that.Name();
 		}
 		if (m_id < that.m_id)
 		{
@@ -86,8 +99,12 @@ public:
 
 private:
 
-	// The symbol name
-	std::string m_name;
+	// Symbol names are interned, so that they can be compared and hashed as small integers
+	static int Intern(const std::string& name);
+	static const std::string& NameOf(int atom);
+
+	// The interned symbol name
+	int m_atom;
 	// The scope identifier
 	int m_id;
 	// The for loop count (number of times through, not current value)
@@ -101,12 +118,15 @@ struct std::hash<ScopedSymbolName>
 {
 	std::size_t operator()(const ScopedSymbolName& s) const
 	{
-		std::hash<std::string> hasher;
-		std::size_t h1 = hasher(s.m_name);
-		std::size_t h2 = s.m_id;
-		std::size_t h3 = s.m_count;
-		std::size_t h = h1 ^ (h2 * 3) ^ (h3 * 7);
-		return h;
+		// Loop ids and counts are small consecutive integers, so give each field its own
+		// multiplier and then mix the result thoroughly
+		std::uint64_t h = static_cast<std::uint64_t>(static_cast<std::uint32_t>(s.m_atom)) * 0x9E3779B97F4A7C15ull;
+		h ^= static_cast<std::uint64_t>(static_cast<std::uint32_t>(s.m_id)) * 0xC2B2AE3D27D4EB4Full;
+		h ^= static_cast<std::uint64_t>(static_cast<std::uint32_t>(s.m_count)) * 0x165667B19E3779F9ull;
+		h ^= h >> 32;
+		h *= 0xD6E8FEB86659FD93ull;
+		h ^= h >> 32;
+		return static_cast<std::size_t>(h);
 	}
 };
 
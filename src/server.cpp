@@ -0,0 +1,592 @@
+/*************************************************************************************************/
+/**
+	server.cpp
+
+	Runs beebasm as a server, so that a build which assembles many times pays for process startup
+	and for reading its shared source files only once
+
+
+	Copyright (C) Rich Talbot-Watkins 2007 - 2012
+
+	This file is part of BeebAsm.
+
+	BeebAsm is free software: you can redistribute it and/or modify it under the terms of the GNU
+	General Public License as published by the Free Software Foundation, either version 3 of the
+	License, or (at your option) any later version.
+
+	BeebAsm is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without
+	even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License along with BeebAsm, as
+	COPYING.txt.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/*************************************************************************************************/
+
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <cstdlib>
+#include <cstring>
+
+#include "server.h"
+#include "commandline.h"
+#include "filecache.h"
+
+#ifndef _WIN32
+#include <cerrno>
+#include <csignal>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+
+using namespace std;
+
+
+#ifndef _WIN32
+
+// A message is a sequence of numbers and strings.  Numbers are 32 bits, least significant byte
+// first; strings are their length followed by their characters.
+//
+// A job is the number of strings which follow, the client's working directory, and then the
+// command line options.  The reply is the exit code, followed by everything the job wrote to
+// stdout and then to stderr.
+
+
+/*************************************************************************************************/
+/**
+	WriteBytes()
+
+	Writes the whole of a buffer to a socket
+
+	@return		false if the socket was closed or failed
+*/
+/*************************************************************************************************/
+static bool WriteBytes( int fd, const char* pData, size_t length )
+{
+	while ( length > 0 )
+	{
+		ssize_t written = write( fd, pData, length );
+
+		if ( written < 0 && errno == EINTR )
+		{
+			continue;
+		}
+
+		if ( written <= 0 )
+		{
+			return false;
+		}
+
+		pData += written;
+		length -= static_cast< size_t >( written );
+	}
+
+	return true;
+}
+
+
+
+/*************************************************************************************************/
+/**
+	ReadBytes()
+
+	Fills a buffer from a socket
+
+	@return		false if the socket was closed or failed before the buffer was filled
+*/
+/*************************************************************************************************/
+static bool ReadBytes( int fd, char* pData, size_t length )
+{
+	while ( length > 0 )
+	{
+		ssize_t got = read( fd, pData, length );
+
+		if ( got < 0 && errno == EINTR )
+		{
+			continue;
+		}
+
+		if ( got <= 0 )
+		{
+			return false;
+		}
+
+		pData += got;
+		length -= static_cast< size_t >( got );
+	}
+
+	return true;
+}
+
+
+
+/*************************************************************************************************/
+/**
+	WriteNumber()
+
+	Writes a 32-bit number to a socket
+*/
+/*************************************************************************************************/
+static bool WriteNumber( int fd, unsigned int number )
+{
+	char bytes[ 4 ];
+
+	for ( int i = 0; i < 4; i++ )
+	{
+		bytes[ i ] = static_cast< char >( ( number >> ( i * 8 ) ) & 0xFF );
+	}
+
+	return WriteBytes( fd, bytes, 4 );
+}
+
+
+
+/*************************************************************************************************/
+/**
+	ReadNumber()
+
+	Reads a 32-bit number from a socket
+*/
+/*************************************************************************************************/
+static bool ReadNumber( int fd, unsigned int& number )
+{
+	char bytes[ 4 ];
+
+	if ( !ReadBytes( fd, bytes, 4 ) )
+	{
+		return false;
+	}
+
+	number = 0;
+
+	for ( int i = 0; i < 4; i++ )
+	{
+		number |= static_cast< unsigned int >( static_cast< unsigned char >( bytes[ i ] ) ) << ( i * 8 );
+	}
+
+	return true;
+}
+
+
+
+/*************************************************************************************************/
+/**
+	WriteString()
+
+	Writes a string to a socket, preceded by its length
+*/
+/*************************************************************************************************/
+static bool WriteString( int fd, const string& text )
+{
+	return WriteNumber( fd, static_cast< unsigned int >( text.size() ) ) &&
+		   WriteBytes( fd, text.data(), text.size() );
+}
+
+
+
+/*************************************************************************************************/
+/**
+	ReadString()
+
+	Reads a string written by WriteString()
+*/
+/*************************************************************************************************/
+static bool ReadString( int fd, string& text )
+{
+	unsigned int length;
+
+	if ( !ReadNumber( fd, length ) || length > MAX_SERVER_STRING )
+	{
+		return false;
+	}
+
+	text.resize( length );
+
+	return length == 0 || ReadBytes( fd, &text[ 0 ], length );
+}
+
+
+
+/*************************************************************************************************/
+/**
+	MakeAddress()
+
+	Fills in the address of a Unix domain socket
+
+	@return		false if the name is too long for a socket address
+*/
+/*************************************************************************************************/
+static bool MakeAddress( const char* pSocketName, sockaddr_un& address )
+{
+	memset( &address, 0, sizeof address );
+	address.sun_family = AF_UNIX;
+
+	if ( strlen( pSocketName ) >= sizeof address.sun_path )
+	{
+		cerr << "Socket name is too long: " << pSocketName << endl;
+		return false;
+	}
+
+	strcpy( address.sun_path, pSocketName );
+	return true;
+}
+
+
+
+/*************************************************************************************************/
+/**
+	GetWorkingDirectory()
+
+	Gets the current directory
+
+	@return		false if it couldn't be found
+*/
+/*************************************************************************************************/
+static bool GetWorkingDirectory( string& directory )
+{
+	vector< char > buffer( 256 );
+
+	while ( getcwd( &buffer[ 0 ], buffer.size() ) == NULL )
+	{
+		if ( errno != ERANGE )
+		{
+			return false;
+		}
+
+		buffer.resize( buffer.size() * 2 );
+	}
+
+	directory = &buffer[ 0 ];
+	return true;
+}
+
+
+
+/*************************************************************************************************/
+/**
+	IsSameUser()
+
+	Checks that the process at the other end of a connection belongs to the user running the
+	server, as a job can read and write any file the server can
+
+	@return		false if it belongs to someone else, or can't be found
+*/
+/*************************************************************************************************/
+static bool IsSameUser( int connection )
+{
+#if defined( SO_PEERCRED )
+	struct ucred credentials;
+	socklen_t length = sizeof credentials;
+
+	return getsockopt( connection, SOL_SOCKET, SO_PEERCRED, &credentials, &length ) == 0 &&
+		   credentials.uid == getuid();
+#else
+	uid_t uid;
+	gid_t gid;
+
+	return getpeereid( connection, &uid, &gid ) == 0 && uid == getuid();
+#endif
+}
+
+
+
+/*************************************************************************************************/
+/**
+	SetTimeouts()
+
+	Stops a client which neither sends its job nor takes the result from holding up the server
+*/
+/*************************************************************************************************/
+static void SetTimeouts( int connection )
+{
+	timeval timeout;
+	timeout.tv_sec = SERVER_TIMEOUT;
+	timeout.tv_usec = 0;
+
+	setsockopt( connection, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof timeout );
+	setsockopt( connection, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof timeout );
+}
+
+
+
+/*************************************************************************************************/
+/**
+	ServeJob()
+
+	Reads a job from a connection, assembles it with stdout and stderr captured and its files
+	relative to the client's directory, and sends back the result
+*/
+/*************************************************************************************************/
+static void ServeJob( int connection, DiskFileSystem& fileSystem )
+{
+	unsigned int count;
+
+	if ( !ReadNumber( connection, count ) || count == 0 || count > MAX_SERVER_ARGS )
+	{
+		return;
+	}
+
+	vector< string > strings( count );
+
+	for ( unsigned int i = 0; i < count; i++ )
+	{
+		if ( !ReadString( connection, strings[ i ] ) )
+		{
+			return;
+		}
+	}
+
+	// The first string is the directory, which is replaced by the program name to make argv
+
+	string directory = strings[ 0 ];
+	strings[ 0 ] = "beebasm";
+
+	vector< char* > argv;
+
+	for ( unsigned int i = 0; i < count; i++ )
+	{
+		strings[ i ].push_back( '\0' );
+		argv.push_back( &strings[ i ][ 0 ] );
+	}
+
+	argv.push_back( NULL );
+
+	ostringstream capturedOut;
+	ostringstream capturedErr;
+
+	int exitCode;
+
+	// The server's own directory is never changed: the job's files are found relative to the
+	// client's directory by the file system instead
+
+	struct stat info;
+
+	if ( directory.empty() || directory[ 0 ] != '/' ||
+		 stat( directory.c_str(), &info ) != 0 || !S_ISDIR( info.st_mode ) )
+	{
+		capturedErr << "Server cannot use directory " << directory << endl;
+		exitCode = EXIT_FAILURE;
+	}
+	else
+	{
+		fileSystem.SetDirectory( directory );
+		exitCode = Assemble( static_cast< int >( count ), &argv[ 0 ], capturedOut, capturedErr );
+		fileSystem.SetDirectory( "" );
+	}
+
+	// Only keep the files this job used, so that the cache doesn't grow with every project built
+
+	FileCache::Instance().ForgetUnused();
+
+	if ( !WriteNumber( connection, static_cast< unsigned int >( exitCode ) ) ||
+		 !WriteString( connection, capturedOut.str() ) ||
+		 !WriteString( connection, capturedErr.str() ) )
+	{
+		cerr << "Client disconnected before the result was sent" << endl;
+	}
+}
+
+
+
+/*************************************************************************************************/
+/**
+	RunServer()
+
+	Listens on a Unix domain socket, assembling each job sent to it in turn.  The file cache is
+	kept between jobs, so that source files which haven't changed are neither read nor lexed
+	again, but only holds the files used by the last job; everything else is created afresh for
+	each job.
+
+	Only the user running the server can connect to the socket, and jobs from anyone else are
+	refused.
+
+	@param		pSocketName		Path of the socket to create
+*/
+/*************************************************************************************************/
+int RunServer( const char* pSocketName )
+{
+	sockaddr_un address;
+
+	if ( !MakeAddress( pSocketName, address ) )
+	{
+		return EXIT_FAILURE;
+	}
+
+	// A client going away mustn't take the server with it
+	signal( SIGPIPE, SIG_IGN );
+
+	// Replace a socket left behind by a previous server, but nothing else
+	struct stat info;
+
+	if ( lstat( pSocketName, &info ) == 0 && S_ISSOCK( info.st_mode ) )
+	{
+		unlink( pSocketName );
+	}
+
+	// The socket is created with no access for anyone else
+	mode_t oldMask = umask( 0177 );
+
+	int listener = socket( AF_UNIX, SOCK_STREAM, 0 );
+	bool bBound = ( listener >= 0 && bind( listener, reinterpret_cast< sockaddr* >( &address ), sizeof address ) == 0 );
+
+	umask( oldMask );
+
+	if ( !bBound || listen( listener, SOMAXCONN ) != 0 )
+	{
+		cerr << "Unable to listen on " << pSocketName << ": " << strerror( errno ) << endl;
+
+		if ( listener >= 0 )
+		{
+			close( listener );
+		}
+
+		return EXIT_FAILURE;
+	}
+
+	cerr << "beebasm server listening on " << pSocketName << endl;
+
+	DiskFileSystem fileSystem;
+	FileCache::Create( &fileSystem );
+
+	for ( ;; )
+	{
+		int connection = accept( listener, NULL, NULL );
+
+		if ( connection < 0 )
+		{
+			if ( errno == EINTR || errno == ECONNABORTED )
+			{
+				continue;
+			}
+
+			cerr << "Unable to accept a connection: " << strerror( errno ) << endl;
+			break;
+		}
+
+		if ( IsSameUser( connection ) )
+		{
+			SetTimeouts( connection );
+			ServeJob( connection, fileSystem );
+		}
+		else
+		{
+			cerr << "Refused a connection from another user" << endl;
+		}
+
+		close( connection );
+	}
+
+	FileCache::Destroy();
+
+	close( listener );
+	unlink( pSocketName );
+
+	return EXIT_FAILURE;
+}
+
+
+
+/*************************************************************************************************/
+/**
+	RunClient()
+
+	Has the server assemble with the given command line, as if it had been run in the current
+	directory, and passes on its output and exit code
+
+	@param		pSocketName		Path of the server's socket
+	@param		argc			Number of parameters, including the program name
+	@param		argv			Array of parameters
+*/
+/*************************************************************************************************/
+int RunClient( const char* pSocketName, int argc, char* argv[] )
+{
+	sockaddr_un address;
+
+	if ( !MakeAddress( pSocketName, address ) )
+	{
+		return EXIT_FAILURE;
+	}
+
+	string directory;
+
+	if ( !GetWorkingDirectory( directory ) )
+	{
+		cerr << "Unable to determine current directory" << endl;
+		return EXIT_FAILURE;
+	}
+
+	signal( SIGPIPE, SIG_IGN );
+
+	int connection = socket( AF_UNIX, SOCK_STREAM, 0 );
+
+	if ( connection < 0 ||
+		 connect( connection, reinterpret_cast< sockaddr* >( &address ), sizeof address ) != 0 )
+	{
+		cerr << "Unable to connect to beebasm server at " << pSocketName << ": " << strerror( errno ) << endl;
+
+		if ( connection >= 0 )
+		{
+			close( connection );
+		}
+
+		return EXIT_FAILURE;
+	}
+
+	// argv[0] is replaced by the directory
+
+	bool bSent = WriteNumber( connection, static_cast< unsigned int >( argc ) ) &&
+				 WriteString( connection, directory );
+
+	for ( int i = 1; bSent && i < argc; i++ )
+	{
+		bSent = WriteString( connection, argv[ i ] );
+	}
+
+	unsigned int exitCode;
+	string capturedOut;
+	string capturedErr;
+
+	if ( !bSent ||
+		 !ReadNumber( connection, exitCode ) ||
+		 !ReadString( connection, capturedOut ) ||
+		 !ReadString( connection, capturedErr ) )
+	{
+		cerr << "Lost connection to beebasm server at " << pSocketName << endl;
+		close( connection );
+		return EXIT_FAILURE;
+	}
+
+	close( connection );
+
+	cout << capturedOut << flush;
+	cerr << capturedErr << flush;
+
+	return static_cast< int >( exitCode );
+}
+
+
+#else
+
+
+int RunServer( const char* )
+{
+	cerr << "--server is not supported on this platform" << endl;
+	return EXIT_FAILURE;
+}
+
+
+int RunClient( const char*, int, char** )
+{
+	cerr << "--client is not supported on this platform" << endl;
+	return EXIT_FAILURE;
+}
+
+
+#endif // _WIN32
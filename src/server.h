@@ -0,0 +1,46 @@
+/*************************************************************************************************/
+/**
+	server.h
+
+
+	Copyright (C) Rich Talbot-Watkins 2007 - 2012
+
+	This file is part of BeebAsm.
+
+	BeebAsm is free software: you can redistribute it and/or modify it under the terms of the GNU
+	General Public License as published by the Free Software Foundation, either version 3 of the
+	License, or (at your option) any later version.
+
+	BeebAsm is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without
+	even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License along with BeebAsm, as
+	COPYING.txt.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/*************************************************************************************************/
+
+#ifndef SERVER_H_
+#define SERVER_H_
+
+// The longest string, and most strings in a job, either end will accept, to guard against garbage
+
+#define MAX_SERVER_STRING	( 64 * 1024 * 1024 )
+#define MAX_SERVER_ARGS		4096
+
+// How long, in seconds, the server waits for a client to send a job or take the result
+
+#define SERVER_TIMEOUT		30
+
+
+// Listens on a Unix domain socket, assembling each job sent to it in turn.  Only returns if the
+// socket can't be set up.
+
+int RunServer( const char* pSocketName );
+
+// Sends the command line to the server, and writes out what the job wrote to stdout and stderr
+
+int RunClient( const char* pSocketName, int argc, char* argv[] );
+
+
+#endif // SERVER_H_
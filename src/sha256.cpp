@@ -0,0 +1,239 @@
+/*************************************************************************************************/
+/**
+	sha256.cpp
+
+
+	Copyright (C) Rich Talbot-Watkins 2007 - 2012
+
+	This file is part of BeebAsm.
+
+	BeebAsm is free software: you can redistribute it and/or modify it under the terms of the GNU
+	General Public License as published by the Free Software Foundation, either version 3 of the
+	License, or (at your option) any later version.
+
+	BeebAsm is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without
+	even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License along with BeebAsm, as
+	COPYING.txt.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/*************************************************************************************************/
+
+#include <cstring>
+
+#include "sha256.h"
+
+using namespace std;
+
+
+static const uint32_t s_roundConstants[ 64 ] =
+{
+	0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+	0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+	0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+	0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+	0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+	0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+	0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+	0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+
+static inline uint32_t RotateRight( uint32_t value, int bits )
+{
+	return ( value >> bits ) | ( value << ( 32 - bits ) );
+}
+
+
+
+/*************************************************************************************************/
+/**
+	Sha256::Sha256()
+
+	Sha256 constructor
+*/
+/*************************************************************************************************/
+Sha256::Sha256()
+	:	m_blockLength( 0 ),
+		m_totalLength( 0 )
+{
+	m_state[ 0 ] = 0x6a09e667;
+	m_state[ 1 ] = 0xbb67ae85;
+	m_state[ 2 ] = 0x3c6ef372;
+	m_state[ 3 ] = 0xa54ff53a;
+	m_state[ 4 ] = 0x510e527f;
+	m_state[ 5 ] = 0x9b05688c;
+	m_state[ 6 ] = 0x1f83d9ab;
+	m_state[ 7 ] = 0x5be0cd19;
+}
+
+
+
+/*************************************************************************************************/
+/**
+	Sha256::Update()
+
+	Adds bytes to the digest
+
+	@param		pData			Bytes to add
+	@param		length			Number of bytes
+*/
+/*************************************************************************************************/
+void Sha256::Update( const void* pData, size_t length )
+{
+	const unsigned char* pBytes = static_cast< const unsigned char* >( pData );
+
+	m_totalLength += length;
+
+	while ( length > 0 )
+	{
+		size_t chunk = 64 - m_blockLength;
+
+		if ( chunk > length )
+		{
+			chunk = length;
+		}
+
+		memcpy( m_block + m_blockLength, pBytes, chunk );
+		m_blockLength += chunk;
+		pBytes += chunk;
+		length -= chunk;
+
+		if ( m_blockLength == 64 )
+		{
+			ProcessBlock( m_block );
+			m_blockLength = 0;
+		}
+	}
+}
+
+
+
+/*************************************************************************************************/
+/**
+	Sha256::Update()
+
+	Adds a string to the digest, followed by a terminator so that consecutive strings can't run
+	into each other
+*/
+/*************************************************************************************************/
+void Sha256::Update( const string& text )
+{
+	Update( text.data(), text.size() );
+	Update( "", 1 );
+}
+
+
+
+/*************************************************************************************************/
+/**
+	Sha256::HexDigest()
+
+	Finishes the digest
+
+	@return		The digest, as 64 lower case hex digits
+*/
+/*************************************************************************************************/
+string Sha256::HexDigest()
+{
+	uint64_t totalBits = m_totalLength * 8;
+
+	unsigned char padding = 0x80;
+	Update( &padding, 1 );
+
+	padding = 0;
+
+	while ( m_blockLength != 56 )
+	{
+		Update( &padding, 1 );
+	}
+
+	unsigned char lengthBytes[ 8 ];
+
+	for ( int i = 0; i < 8; i++ )
+	{
+		lengthBytes[ i ] = static_cast< unsigned char >( totalBits >> ( 56 - i * 8 ) );
+	}
+
+	Update( lengthBytes, 8 );
+
+	static const char* hexDigits = "0123456789abcdef";
+	string digest;
+
+	for ( int i = 0; i < 8; i++ )
+	{
+		for ( int shift = 28; shift >= 0; shift -= 4 )
+		{
+			digest += hexDigits[ ( m_state[ i ] >> shift ) & 0xF ];
+		}
+	}
+
+	return digest;
+}
+
+
+
+/*************************************************************************************************/
+/**
+	Sha256::ProcessBlock()
+
+	Runs the compression function over a 64-byte block
+*/
+/*************************************************************************************************/
+void Sha256::ProcessBlock( const unsigned char* pBlock )
+{
+	uint32_t w[ 64 ];
+
+	for ( int i = 0; i < 16; i++ )
+	{
+		w[ i ] = ( static_cast< uint32_t >( pBlock[ i * 4 ] ) << 24 ) |
+				 ( static_cast< uint32_t >( pBlock[ i * 4 + 1 ] ) << 16 ) |
+				 ( static_cast< uint32_t >( pBlock[ i * 4 + 2 ] ) << 8 ) |
+				 static_cast< uint32_t >( pBlock[ i * 4 + 3 ] );
+	}
+
+	for ( int i = 16; i < 64; i++ )
+	{
+		uint32_t s0 = RotateRight( w[ i - 15 ], 7 ) ^ RotateRight( w[ i - 15 ], 18 ) ^ ( w[ i - 15 ] >> 3 );
+		uint32_t s1 = RotateRight( w[ i - 2 ], 17 ) ^ RotateRight( w[ i - 2 ], 19 ) ^ ( w[ i - 2 ] >> 10 );
+		w[ i ] = w[ i - 16 ] + s0 + w[ i - 7 ] + s1;
+	}
+
+	uint32_t a = m_state[ 0 ];
+	uint32_t b = m_state[ 1 ];
+	uint32_t c = m_state[ 2 ];
+	uint32_t d = m_state[ 3 ];
+	uint32_t e = m_state[ 4 ];
+	uint32_t f = m_state[ 5 ];
+	uint32_t g = m_state[ 6 ];
+	uint32_t h = m_state[ 7 ];
+
+	for ( int i = 0; i < 64; i++ )
+	{
+		uint32_t s1 = RotateRight( e, 6 ) ^ RotateRight( e, 11 ) ^ RotateRight( e, 25 );
+		uint32_t choose = ( e & f ) ^ ( ~e & g );
+		uint32_t temp1 = h + s1 + choose + s_roundConstants[ i ] + w[ i ];
+		uint32_t s0 = RotateRight( a, 2 ) ^ RotateRight( a, 13 ) ^ RotateRight( a, 22 );
+		uint32_t majority = ( a & b ) ^ ( a & c ) ^ ( b & c );
+		uint32_t temp2 = s0 + majority;
+
+		h = g;
+		g = f;
+		f = e;
+		e = d + temp1;
+		d = c;
+		c = b;
+		b = a;
+		a = temp1 + temp2;
+	}
+
+	m_state[ 0 ] += a;
+	m_state[ 1 ] += b;
+	m_state[ 2 ] += c;
+	m_state[ 3 ] += d;
+	m_state[ 4 ] += e;
+	m_state[ 5 ] += f;
+	m_state[ 6 ] += g;
+	m_state[ 7 ] += h;
+}
@@ -0,0 +1,62 @@
+/*************************************************************************************************/
+/**
+	sha256.h
+
+
+	Copyright (C) Rich Talbot-Watkins 2007 - 2012
+
+	This file is part of BeebAsm.
+
+	BeebAsm is free software: you can redistribute it and/or modify it under the terms of the GNU
+	General Public License as published by the Free Software Foundation, either version 3 of the
+	License, or (at your option) any later version.
+
+	BeebAsm is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without
+	even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License along with BeebAsm, as
+	COPYING.txt.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/*************************************************************************************************/
+
+#ifndef SHA256_H_
+#define SHA256_H_
+
+#include <cstddef>
+#include <string>
+
+#include <stdint.h>
+
+
+/*************************************************************************************************/
+/**
+	Sha256
+
+	Computes the SHA-256 digest of a sequence of bytes, as used to name the entries of the build
+	cache
+*/
+/*************************************************************************************************/
+class Sha256
+{
+public:
+
+	Sha256();
+
+	void				Update( const void* pData, size_t length );
+	void				Update( const std::string& text );
+	std::string			HexDigest();
+
+
+private:
+
+	void				ProcessBlock( const unsigned char* pBlock );
+
+	uint32_t			m_state[ 8 ];
+	unsigned char		m_block[ 64 ];
+	size_t				m_blockLength;
+	uint64_t			m_totalLength;
+};
+
+
+#endif // SHA256_H_
@@ -22,6 +22,8 @@
 */
 /*************************************************************************************************/
 
+#include <cstring>
+
 #include "sourcecode.h"
 #include "asmexception.h"
 #include "stringutils.h"
@@ -29,6 +31,9 @@
 #include "lineparser.h"
 #include "symboltable.h"
 #include "macro.h"
+#include "profiler.h"
+#include "statistics.h"
+#include "tracer.h"
 
 using namespace std;
 
@@ -42,30 +47,27 @@ using namespace std;
 
 	@param		filename		Filename of source file to open
 	@param		lineNumber		Line number
+	@param		source			Shared text to process
 	@param		parent  		Parent SourceCode object (or null)
 
 	The supplied file will be opened.  If there is a problem, an AsmException will be thrown.
 */
 /*************************************************************************************************/
-SourceCode::SourceCode( const string& filename, int lineNumber, const std::string& text, const SourceCode* parent )
-	:	m_forStackPtr( 0 ),
+SourceCode::SourceCode( const string& filename, int lineNumber, const shared_ptr<SourceText>& source, const SourceCode* parent )
+	:	m_forStackParent( NULL ),
+		m_forStackBase( 0 ),
+		m_forStackPtr( 0 ),
 		m_initialForStackPtr( 0 ),
-		m_ifStackPtr( 0 ),
 		m_initialIfStackPtr( 0 ),
 		m_currentMacro( NULL ),
 		m_filename( filename ),
 		m_lineNumber( lineNumber ),
 		m_parent( parent ),
 		m_lineStartPointer( 0 ),
-		m_text( text ),
+		m_source( source ),
+		m_text( source->GetText() ),
 		m_textPointer( 0 )
 {
-	// Double-check the supplied text came with a '\n' sentinel
-	if (m_text.empty() || m_text.back() != '\n')
-	{
-		assert(false);
-		m_text.push_back('\n');
-	}
 }
 
 
@@ -97,7 +99,7 @@ void SourceCode::Process()
 	// Remember the FOR and IF stack initial pointer values
 
 	m_initialForStackPtr = m_forStackPtr;
-	m_initialIfStackPtr = m_ifStackPtr;
+	m_initialIfStackPtr = static_cast<int>( m_ifStack.size() );
 
 	// Reuse the parser because it's a big object and expensive to construct/destruct
 	LineParser parser( this );
@@ -117,7 +119,9 @@ void SourceCode::Process()
 
 		try
 		{
-			parser.Process( lineFromFile );
+			PROFILE_LINE( m_filename, m_lineNumber, lineFromFile );
+			Statistics::Count( Statistics::LINES );
+			parser.Process( lineFromFile, m_source.get(), m_lineStartPointer );
 		}
 		catch ( AsmException_SyntaxError& e )
 		{
@@ -142,7 +146,7 @@ void SourceCode::Process()
 
 	if ( m_forStackPtr != m_initialForStackPtr )
 	{
-		For& mismatchedFor = m_forStack[ m_forStackPtr - 1 ];
+		const For& mismatchedFor = m_forStack.back();
 
 		if ( mismatchedFor.m_step == 0.0 )
 		{
@@ -162,9 +166,9 @@ void SourceCode::Process()
 
 	// Check that we have no IF / MACRO mismatch
 
-	if ( m_ifStackPtr != m_initialIfStackPtr )
+	if ( static_cast<int>( m_ifStack.size() ) != m_initialIfStackPtr )
 	{
-		If& mismatchedIf = m_ifStack[ m_ifStackPtr - 1 ];
+		const If& mismatchedIf = m_ifStack.back();
 
 		if ( mismatchedIf.m_isMacroDefinition )
 		{
@@ -181,6 +185,18 @@ void SourceCode::Process()
 			throw e;
 		}
 	}
+
+	// Check that we have no NOPAGECROSS mismatch
+
+	if ( !m_noPageCrossStack.empty() )
+	{
+		const NoPageCross& mismatchedNoPageCross = m_noPageCrossStack.back();
+
+		AsmException_SyntaxError_NoEndNoPageCross e( mismatchedNoPageCross.m_line, mismatchedNoPageCross.m_column );
+		e.SetFilename( m_filename );
+		e.SetLineNumber( mismatchedNoPageCross.m_lineNumber );
+		throw e;
+	}
 }
 
 
@@ -209,19 +225,27 @@ void SourceCode::AddFor( const ScopedSymbolName& varName,
 
 	// Fill in FOR block
 
-	m_forStack[ m_forStackPtr ].m_varName		= varName;
-	m_forStack[ m_forStackPtr ].m_current		= start;
-	m_forStack[ m_forStackPtr ].m_end			= end;
-	m_forStack[ m_forStackPtr ].m_step			= step;
-	m_forStack[ m_forStackPtr ].m_filePtr		= filePtr;
-	m_forStack[ m_forStackPtr ].m_id			= GlobalData::Instance().GetNextForId();
-	m_forStack[ m_forStackPtr ].m_count			= 0;
-	m_forStack[ m_forStackPtr ].m_line			= line;
-	m_forStack[ m_forStackPtr ].m_column		= column;
-	m_forStack[ m_forStackPtr ].m_lineNumber	= m_lineNumber;
-
-	SymbolTable::Instance().PushFor(m_forStack[ m_forStackPtr ].m_varName, m_forStack[ m_forStackPtr ].m_current);
+	m_forStack.push_back( For() );
+	For& thisFor = m_forStack.back();
+
+	thisFor.m_varName		= varName;
+	thisFor.m_current		= start;
+	thisFor.m_end			= end;
+	thisFor.m_step			= step;
+	thisFor.m_filePtr		= filePtr;
+	thisFor.m_id			= GlobalData::Instance().GetNextForId();
+	thisFor.m_count			= 0;
+	thisFor.m_line			= line;
+	thisFor.m_column		= column;
+	thisFor.m_lineNumber	= m_lineNumber;
+
+	SymbolTable::Instance().PushFor(thisFor.m_varName, thisFor.m_current);
 	m_forStackPtr++;
+
+	if ( Tracer::Instance().IsEnabled() )
+	{
+		Tracer::Instance().BeginLoop();
+	}
 }
 
 
@@ -242,16 +266,19 @@ void SourceCode::OpenBrace( const string& line, int column )
 
 	// Fill in FOR block
 
-	m_forStack[ m_forStackPtr ].m_varName		= ScopedSymbolName();
-	m_forStack[ m_forStackPtr ].m_current		= 1.0;
-	m_forStack[ m_forStackPtr ].m_end			= 0.0;
-	m_forStack[ m_forStackPtr ].m_step			= 0.0;
-	m_forStack[ m_forStackPtr ].m_filePtr		= 0;
-	m_forStack[ m_forStackPtr ].m_id			= GlobalData::Instance().GetNextForId();
-	m_forStack[ m_forStackPtr ].m_count			= 0;
-	m_forStack[ m_forStackPtr ].m_line			= line;
-	m_forStack[ m_forStackPtr ].m_column		= column;
-	m_forStack[ m_forStackPtr ].m_lineNumber	= m_lineNumber;
+	m_forStack.push_back( For() );
+	For& thisFor = m_forStack.back();
+
+	thisFor.m_varName		= ScopedSymbolName();
+	thisFor.m_current		= 1.0;
+	thisFor.m_end			= 0.0;
+	thisFor.m_step			= 0.0;
+	thisFor.m_filePtr		= 0;
+	thisFor.m_id			= GlobalData::Instance().GetNextForId();
+	thisFor.m_count			= 0;
+	thisFor.m_line			= line;
+	thisFor.m_column		= column;
+	thisFor.m_lineNumber	= m_lineNumber;
 
 	SymbolTable::Instance().PushBrace();
 	m_forStackPtr++;
@@ -266,12 +293,14 @@ void SourceCode::OpenBrace( const string& line, int column )
 /*************************************************************************************************/
 void SourceCode::UpdateFor( const string& line, int column )
 {
-	if ( m_forStackPtr == 0 )
+	// A macro can't loop back into a FOR which was started by the code that invoked it
+
+	if ( m_forStack.empty() )
 	{
 		throw AsmException_SyntaxError_NextWithoutFor( line, column );
 	}
 
-	For& thisFor = m_forStack[ m_forStackPtr - 1 ];
+	For& thisFor = m_forStack.back();
 
 	// step of 0.0 here means that the 'for' is in fact an open brace, so throw an error
 
@@ -286,8 +315,16 @@ void SourceCode::UpdateFor( const string& line, int column )
 		 ( thisFor.m_step < 0.0 && thisFor.m_current < thisFor.m_end ) )
 	{
 		// we have reached the end of the FOR
+		if ( Tracer::Instance().IsEnabled() )
+		{
+			Tracer::Instance().EndLoop( "FOR " + thisFor.m_varName.Name(),
+										Tracer::LocationArgs( m_filename, thisFor.m_lineNumber ) +
+										", \"iterations\": " + to_string( thisFor.m_count + 1 ) );
+		}
+
 		SymbolTable::Instance().RemoveSymbol( thisFor.m_varName );
 		SymbolTable::Instance().PopScope();
+		m_forStack.pop_back();
 		m_forStackPtr--;
 	}
 	else
@@ -326,7 +363,7 @@ void SourceCode::CloseBrace( const string& line, int column )
 		throw AsmException_SyntaxError_MismatchedBraces( line, column );
 	}
 
-	For& thisFor = m_forStack[ m_forStackPtr - 1 ];
+	const For& thisFor = m_forStack.back();
 
 	// step of non-0.0 here means that this a real 'for', so throw an error
 
@@ -336,23 +373,48 @@ void SourceCode::CloseBrace( const string& line, int column )
 	}
 
 	SymbolTable::Instance().PopScope();
+	m_forStack.pop_back();
 	m_forStackPtr--;
 }
 
 
 /*************************************************************************************************/
 /**
-	SourceCode::CopyForStack()
+	SourceCode::InheritForStack()
+
+	Makes the FOR levels of the parent visible to this code, without copying them.  The parent's
+	levels can be read but not changed, and the parent must outlive this object.
 */
 /*************************************************************************************************/
-void SourceCode::CopyForStack( const SourceCode* copyFrom )
+void SourceCode::InheritForStack( const SourceCode* parent )
 {
-	m_forStackPtr = copyFrom->m_forStackPtr;
+	assert( m_forStack.empty() );
+
+	m_forStackParent = parent;
+	m_forStackBase = parent->m_forStackPtr;
+	m_forStackPtr = m_forStackBase;
+}
+
+
 
-	for ( int i = 0; i < m_forStackPtr; i++ )
+/*************************************************************************************************/
+/**
+	SourceCode::GetFor()
+
+	Returns the FOR level with the given index, which may be held by an ancestor
+*/
+/*************************************************************************************************/
+const SourceCode::For& SourceCode::GetFor( int index ) const
+{
+	assert( index >= 0 && index < m_forStackPtr );
+
+	const SourceCode* owner = this;
+	while ( index < owner->m_forStackBase )
 	{
-		m_forStack[ i ] = copyFrom->m_forStack[ i ];
+		owner = owner->m_forStackParent;
 	}
+
+	return owner->m_forStack[ index - owner->m_forStackBase ];
 }
 
 
@@ -363,6 +425,11 @@ void SourceCode::CopyForStack( const SourceCode* copyFrom )
 */
 /*************************************************************************************************/
 ScopedSymbolName SourceCode::GetScopedSymbolName( const string& symbolName, int level ) const
+{
+	return GetScopedSymbolName( ScopedSymbolName( symbolName ), level );
+}
+
+ScopedSymbolName SourceCode::GetScopedSymbolName( const ScopedSymbolName& topLevelName, int level ) const
 {
 	if ( level == -1 )
 	{
@@ -372,11 +439,12 @@ ScopedSymbolName SourceCode::GetScopedSymbolName( const string& symbolName, int
 	int i = level - 1;
 	if ( i >= 0 )
 	{
-		return ScopedSymbolName(symbolName, m_forStack[ i ].m_id, m_forStack[ i ].m_count);
+		const For& thisFor = GetFor( i );
+		return ScopedSymbolName(topLevelName, thisFor.m_id, thisFor.m_count);
 	}
 	else
 	{
-		return ScopedSymbolName(symbolName);
+		return topLevelName;
 	}
 }
 
@@ -389,7 +457,7 @@ ScopedSymbolName SourceCode::GetScopedSymbolName( const string& symbolName, int
 /*************************************************************************************************/
 bool SourceCode::IsIfConditionTrue() const
 {
-	for ( int i = 0; i < m_ifStackPtr; i++ )
+	for ( size_t i = 0; i < m_ifStack.size(); i++ )
 	{
 		if ( !m_ifStack[ i ].m_condition )
 		{
@@ -409,19 +477,21 @@ bool SourceCode::IsIfConditionTrue() const
 /*************************************************************************************************/
 void SourceCode::AddIfLevel( const string& line, int column )
 {
-	if ( m_ifStackPtr == MAX_IF_LEVELS )
+	if ( m_ifStack.size() == MAX_IF_LEVELS )
 	{
 		throw AsmException_SyntaxError_TooManyIFs( line, column );
 	}
 
-	m_ifStack[ m_ifStackPtr ].m_condition			= true;
-	m_ifStack[ m_ifStackPtr ].m_passed				= false;
-	m_ifStack[ m_ifStackPtr ].m_hadElse				= false;
-	m_ifStack[ m_ifStackPtr ].m_isMacroDefinition	= false;
-	m_ifStack[ m_ifStackPtr ].m_line				= line;
-	m_ifStack[ m_ifStackPtr ].m_column				= column;
-	m_ifStack[ m_ifStackPtr ].m_lineNumber			= m_lineNumber;
-	m_ifStackPtr++;
+	m_ifStack.push_back( If() );
+	If& thisIf = m_ifStack.back();
+
+	thisIf.m_condition			= true;
+	thisIf.m_passed				= false;
+	thisIf.m_hadElse			= false;
+	thisIf.m_isMacroDefinition	= false;
+	thisIf.m_line				= line;
+	thisIf.m_column				= column;
+	thisIf.m_lineNumber			= m_lineNumber;
 }
 
 
@@ -433,8 +503,8 @@ void SourceCode::AddIfLevel( const string& line, int column )
 /*************************************************************************************************/
 void SourceCode::SetCurrentIfAsMacroDefinition()
 {
-	assert( m_ifStackPtr > 0 );
-	m_ifStack[ m_ifStackPtr - 1 ].m_isMacroDefinition = true;
+	assert( !m_ifStack.empty() );
+	m_ifStack.back().m_isMacroDefinition = true;
 }
 
 
@@ -446,11 +516,11 @@ void SourceCode::SetCurrentIfAsMacroDefinition()
 /*************************************************************************************************/
 void SourceCode::SetCurrentIfCondition( bool b )
 {
-	assert( m_ifStackPtr > 0 );
-	m_ifStack[ m_ifStackPtr - 1 ].m_condition = b;
+	assert( !m_ifStack.empty() );
+	m_ifStack.back().m_condition = b;
 	if ( b )
 	{
-		m_ifStack[ m_ifStackPtr - 1 ].m_passed = true;
+		m_ifStack.back().m_passed = true;
 	}
 }
 
@@ -463,14 +533,16 @@ void SourceCode::SetCurrentIfCondition( bool b )
 /*************************************************************************************************/
 void SourceCode::StartElse( const string& line, int column )
 {
-	if ( m_ifStack[ m_ifStackPtr - 1 ].m_hadElse )
+	If& thisIf = m_ifStack.back();
+
+	if ( thisIf.m_hadElse )
 	{
 		throw AsmException_SyntaxError_ElseWithoutIf( line, column );
 	}
 
-	m_ifStack[ m_ifStackPtr - 1 ].m_hadElse = true;
+	thisIf.m_hadElse = true;
 
-	m_ifStack[ m_ifStackPtr - 1 ].m_condition = !m_ifStack[ m_ifStackPtr - 1 ].m_passed;
+	thisIf.m_condition = !thisIf.m_passed;
 }
 
 
@@ -482,12 +554,14 @@ void SourceCode::StartElse( const string& line, int column )
 /*************************************************************************************************/
 void SourceCode::StartElif( const string& line, int column )
 {
-	if ( m_ifStack[ m_ifStackPtr - 1 ].m_hadElse )
+	If& thisIf = m_ifStack.back();
+
+	if ( thisIf.m_hadElse )
 	{
 		throw AsmException_SyntaxError_ElifWithoutIf( line, column );
 	}
 
-	m_ifStack[ m_ifStackPtr - 1 ].m_condition = !m_ifStack[ m_ifStackPtr - 1 ].m_passed;
+	thisIf.m_condition = !thisIf.m_passed;
 }
 
 
@@ -499,12 +573,12 @@ void SourceCode::StartElif( const string& line, int column )
 /*************************************************************************************************/
 void SourceCode::RemoveIfLevel( const string& line, int column )
 {
-	if ( m_ifStackPtr == 0 )
+	if ( m_ifStack.empty() )
 	{
 		throw AsmException_SyntaxError_EndifWithoutIf( line, column );
 	}
 
-	m_ifStackPtr--;
+	m_ifStack.pop_back();
 }
 
 
@@ -578,7 +652,64 @@ bool SourceCode::IsRealForLevel( int level ) const
 {
         assert( level > 0 );
         assert( level <= m_forStackPtr );
-        return m_forStack[ level - 1 ].m_step != 0.0;
+        return GetFor( level - 1 ).m_step != 0.0;
+}
+
+
+
+/*************************************************************************************************/
+/**
+	SourceCode::StartNoPageCross()
+*/
+/*************************************************************************************************/
+void SourceCode::StartNoPageCross( const string& line, int column )
+{
+	NoPageCross noPageCross;
+	noPageCross.m_line = line;
+	noPageCross.m_column = column;
+	noPageCross.m_lineNumber = m_lineNumber;
+
+	m_noPageCrossStack.push_back( noPageCross );
+}
+
+
+
+/*************************************************************************************************/
+/**
+	SourceCode::EndNoPageCross()
+*/
+/*************************************************************************************************/
+void SourceCode::EndNoPageCross( const string& line, int column )
+{
+	if ( m_noPageCrossStack.empty() )
+	{
+		throw AsmException_SyntaxError_EndNoPageCrossUnexpected( line, column );
+	}
+
+	m_noPageCrossStack.pop_back();
+}
+
+
+
+/*************************************************************************************************/
+/**
+	SourceCode::IsNoPageCross()
+
+	Is a NOPAGECROSS block in force?  A block must end in the file or macro which started it, but
+	covers any macros and files it invokes, so the parents are searched too.
+*/
+/*************************************************************************************************/
+bool SourceCode::IsNoPageCross() const
+{
+	for ( const SourceCode* sourceCode = this; sourceCode != NULL; sourceCode = sourceCode->m_parent )
+	{
+		if ( !sourceCode->m_noPageCrossStack.empty() )
+		{
+			return true;
+		}
+	}
+
+	return false;
 }
 
 
@@ -592,16 +723,33 @@ bool SourceCode::IsRealForLevel( int level ) const
 /*************************************************************************************************/
 bool SourceCode::GetSymbolValue(const std::string& name, Value& value)
 {
-	for ( int forLevel = GetForLevel(); forLevel >= 0; forLevel-- )
-	{
-		ScopedSymbolName fullSymbolName = GetScopedSymbolName( name, forLevel );
+	return GetSymbolValue( ScopedSymbolName( name ), value );
+}
+
+bool SourceCode::GetSymbolValue(const ScopedSymbolName& topLevelName, Value& value)
+{
+	SymbolTable& symbolTable = SymbolTable::Instance();
 
-		if ( SymbolTable::Instance().IsSymbolDefined( fullSymbolName ) )
+	// Only walk the FOR scopes if this name has ever been defined inside one
+	if ( symbolTable.HasScopedDefinitions( topLevelName ) )
+	{
+		for ( int forLevel = GetForLevel(); forLevel > 0; forLevel-- )
 		{
-			value = SymbolTable::Instance().GetSymbol( fullSymbolName );
-			return true;
+			const SymbolTable::Symbol* symbol = symbolTable.FindSymbolOrEstimate( GetScopedSymbolName( topLevelName, forLevel ) );
+			if ( symbol != NULL )
+			{
+				value = symbol->GetValue();
+				return true;
+			}
 		}
 	}
+
+	const SymbolTable::Symbol* symbol = symbolTable.FindSymbolOrEstimate( topLevelName );
+	if ( symbol != NULL )
+	{
+		value = symbol->GetValue();
+		return true;
+	}
 	return false;
 }
 
@@ -652,12 +800,12 @@ bool SourceCode::GetLine( string& lineFromFile )
 	}
 	// Check there is always a trailing '\n' (the constructor should ensure this)
 	assert(m_text.back() == '\n');
-	int begin = m_textPointer;
-	while (m_text[m_textPointer++] != '\n')
-	{
-	}
+	const char* begin = m_text.data() + m_textPointer;
+	const char* end = static_cast<const char*>(memchr(begin, '\n', m_text.length() - m_textPointer));
+	assert(end != NULL);
+	m_textPointer += static_cast<int>(end - begin) + 1;
 	// Adding the line in one go rather than character by character is very much faster
-	lineFromFile.assign(m_text.cbegin() + begin, m_text.cbegin() + m_textPointer - 1);
+	lineFromFile.assign(begin, end);
 	return true;
 }
 
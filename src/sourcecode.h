@@ -23,9 +23,12 @@
 #ifndef SOURCECODE_H_
 #define SOURCECODE_H_
 
+#include <memory>
 #include <string>
+#include <vector>
 
 #include "scopedsymbolname.h"
+#include "sourcetext.h"
 #include "value.h"
 
 class Macro;
@@ -36,7 +39,7 @@ public:
 
 	// Constructor/destructor
 
-	SourceCode( const std::string& filename, int lineNumber, const std::string& text, const SourceCode* parent );
+	SourceCode( const std::string& filename, int lineNumber, const std::shared_ptr<SourceText>& source, const SourceCode* parent );
 	~SourceCode();
 
 	// Process the file
@@ -57,7 +60,6 @@ public:
 
 
 	// For loop / if related stuff
-	// Should use a std::vector here, but I can't really be bothered to change it now
 
 	#define MAX_FOR_LEVELS	256
 	#define MAX_IF_LEVELS	256
@@ -78,10 +80,17 @@ protected:
 		int					m_lineNumber;
 	};
 
-	For						m_forStack[ MAX_FOR_LEVELS ];
+	// A macro instance sees the FOR levels of the code which invoked it without copying them:
+	// levels below m_forStackBase are read from m_forStackParent, and only the levels above
+	// it are held in m_forStack.
+	const SourceCode*		m_forStackParent;
+	int						m_forStackBase;
+	std::vector<For>		m_forStack;
 	int						m_forStackPtr;
 	int						m_initialForStackPtr;
 
+	const For&				GetFor( int index ) const;
+
 	struct If
 	{
 		bool				m_condition;
@@ -93,9 +102,17 @@ protected:
 		int					m_lineNumber;
 	};
 
-	int						m_ifStackPtr;
+	std::vector<If>			m_ifStack;
 	int						m_initialIfStackPtr;
-	If						m_ifStack[ MAX_IF_LEVELS ];
+
+	struct NoPageCross
+	{
+		std::string			m_line;
+		int					m_column;
+		int					m_lineNumber;
+	};
+
+	std::vector<NoPageCross>	m_noPageCrossStack;
 
 	Macro*					m_currentMacro;
 
@@ -115,14 +132,16 @@ public:
 
 	void					UpdateFor( const std::string& line, int column );
 
-	void					CopyForStack( const SourceCode* copyFrom );
+	void					InheritForStack( const SourceCode* parent );
 
 	inline int 				GetForLevel() const { return m_forStackPtr; }
 	inline int 				GetInitialForStackPtr() const { return m_initialForStackPtr; }
 	inline Macro*			GetCurrentMacro() { return m_currentMacro; }
 
 	bool					GetSymbolValue(const std::string& name, Value& value);
+	bool					GetSymbolValue(const ScopedSymbolName& topLevelName, Value& value);
 	ScopedSymbolName		GetScopedSymbolName( const std::string& symbolName, int level = -1 ) const;
+	ScopedSymbolName		GetScopedSymbolName( const ScopedSymbolName& topLevelName, int level = -1 ) const;
 
 	bool					ShouldOutputAsm();
 
@@ -137,6 +156,9 @@ public:
 	void					StartMacro( const std::string& line, int column );
 	void					EndMacro( const std::string& line, int column );
 	bool					IsRealForLevel( int level ) const;
+	void					StartNoPageCross( const std::string& line, int column );
+	void					EndNoPageCross( const std::string& line, int column );
+	bool					IsNoPageCross() const;
 	// For SOURCELINE
 	void					SetLineNumber(int line) { m_lineNumber = line; }
 	void					SetFileName(const std::string& name) { m_filename = name; }
@@ -148,7 +170,8 @@ protected:
 	int						m_lineNumber;
 	const SourceCode*		m_parent;
 	int						m_lineStartPointer;
-	std::string				m_text;
+	std::shared_ptr<SourceText>	m_source;
+	const std::string&		m_text;
 	int						m_textPointer;
 };
 
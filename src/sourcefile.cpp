@@ -22,87 +22,21 @@
 */
 /*************************************************************************************************/
 
-#include <fstream>
 #include <iostream>
 
 #include "sourcefile.h"
+#include "filecache.h"
 #include "asmexception.h"
 #include "stringutils.h"
 #include "globaldata.h"
 #include "lineparser.h"
 #include "symboltable.h"
+#include "tracer.h"
 
 
 using namespace std;
 
 
-/*************************************************************************************************/
-/**
-	ReadFile()
-
-	Read a file into a string.  Convert tabs to spaces and
-	normalise line endings (\r, \r\n or \n) to \n.
-
-	@param		filename		Filename of source file to open
-
-	The supplied file will be opened.  If there is a problem, an AsmException will be thrown.
-*/
-/*************************************************************************************************/
-static string ReadFile( const string& filename )
-{
-	// we have to open in binary, due to a bug in MinGW which means that calling
-	// tellg() on a text-mode file ruins the file pointer!
-	// http://www.mingw.org/MinGWiki/index.php/Known%20Problems
-	std::ifstream file;
-	file.open( filename.c_str(), ios_base::binary );
-
-	if ( !file )
-	{
-		throw AsmException_FileError_OpenSourceFile( filename );
-	}
-
-	file.seekg(0, std::ios_base::end);
-	unsigned int length = static_cast<unsigned int>(file.tellg());
-	file.seekg(0, std::ios_base::beg);
-
-	string blob;
-	blob.reserve(length + 1); // Extra 1 for trailing '\n'
-
-	std::istream::sentry sentry(file, true);
-	std::streambuf* sb = file.rdbuf();
-
-	while (true)
-	{
-		std::ifstream::int_type c = sb->sbumpc();
-		if (c == '\t')
-		{
-			blob.push_back(' ');
-		}
-		else if (c == '\r')
-		{
-			std::ifstream::int_type next = sb->sgetc();
-			if (next != '\n')
-			{
-				blob.push_back('\n');
-			}
-		}
-		else if (c == std::ifstream::traits_type::eof())
-		{
-			break;
-		}
-		else
-		{
-			blob.push_back(c);
-		}
-	}
-	if (blob.length() == 0 || blob[blob.length() - 1] != '\n')
-	{
-		blob.append("\n");
-	}
-
-	return blob;
-}
-
 /*************************************************************************************************/
 /**
 	SourceFile::SourceFile()
@@ -116,7 +50,7 @@ static string ReadFile( const string& filename )
 */
 /*************************************************************************************************/
 SourceFile::SourceFile( const string& filename, const SourceCode* parent )
-	:	SourceCode( filename, 1, ReadFile( filename ), parent )
+	:	SourceCode( filename, 1, FileCache::Instance().GetSourceText( filename ), parent )
 {
 }
 
@@ -145,12 +79,19 @@ SourceFile::~SourceFile()
 /*************************************************************************************************/
 void SourceFile::Process()
 {
+	TraceSpan span( "file" );
+
+	if ( span.IsEnabled() )
+	{
+		span.SetName( m_filename );
+	}
+
 	SourceCode::Process();
 
 	// Display ok message
 
 	if ( ShouldOutputAsm() )
 	{
-		cerr << "Processed file '" << m_filename << "' ok" << endl;
+		GlobalData::Instance().GetErrorStream() << "Processed file '" << m_filename << "' ok" << endl;
 	}
 }
@@ -0,0 +1,171 @@
+/*************************************************************************************************/
+/**
+	sourcetext.cpp
+
+
+	Copyright (C) Rich Talbot-Watkins 2007 - 2012
+
+	This file is part of BeebAsm.
+
+	BeebAsm is free software: you can redistribute it and/or modify it under the terms of the GNU
+	General Public License as published by the Free Software Foundation, either version 3 of the
+	License, or (at your option) any later version.
+
+	BeebAsm is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without
+	even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License along with BeebAsm, as
+	COPYING.txt.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/*************************************************************************************************/
+
+#include <cassert>
+#include <cstring>
+
+#include "sourcetext.h"
+#include "scopedsymbolname.h"
+
+using namespace std;
+
+
+
+/*************************************************************************************************/
+/**
+	SourceText::SourceText()
+
+	Constructor for SourceText
+
+	@param		text			Normalised source text, which should end with a '\n' sentinel
+*/
+/*************************************************************************************************/
+SourceText::SourceText( const string& text )
+	:	m_text( text ),
+		m_compiledGeneration( ScopedSymbolName::GetInternTableGeneration() )
+{
+	// Double-check the supplied text came with a '\n' sentinel
+	if (m_text.empty() || m_text.back() != '\n')
+	{
+		assert(false);
+		m_text.push_back('\n');
+	}
+
+	m_lexCache.resize( m_text.length(), 0 );
+}
+
+
+
+/*************************************************************************************************/
+/**
+	SourceText::~SourceText()
+
+	Destructor for SourceText
+*/
+/*************************************************************************************************/
+SourceText::~SourceText()
+{
+}
+
+
+
+/*************************************************************************************************/
+/**
+	SourceText::Normalise()
+
+	Converts the raw contents of a source file into the form the parser expects: tabs are
+	converted to spaces, line endings (\r, \r\n or \n) are normalised to \n, and the text
+	always ends with a '\n' sentinel.
+
+	@param		data			Raw file contents
+	@param		length			Length of the file contents
+*/
+/*************************************************************************************************/
+string SourceText::Normalise( const char* data, size_t length )
+{
+	string blob;
+	blob.reserve(length + 1); // Extra 1 for trailing '\n'
+
+	// Copy everything between carriage returns in one go, converting lone \r to \n and
+	// dropping the \r from \r\n
+
+	const char* p = data;
+	const char* end = data + length;
+
+	while (p != end)
+	{
+		const char* cr = static_cast<const char*>(memchr(p, '\r', end - p));
+		if (cr == NULL)
+		{
+			blob.append(p, end);
+			break;
+		}
+
+		blob.append(p, cr);
+		if (cr + 1 == end || cr[1] != '\n')
+		{
+			blob.push_back('\n');
+		}
+		p = cr + 1;
+	}
+
+	// Tabs map one-to-one to spaces, so they can be replaced in place
+
+	char* text = &blob[0];
+	size_t textLength = blob.length();
+	char* tab = static_cast<char*>(memchr(text, '\t', textLength));
+
+	while (tab != NULL)
+	{
+		*tab = ' ';
+		tab = static_cast<char*>(memchr(tab + 1, '\t', text + textLength - (tab + 1)));
+	}
+
+	if (blob.length() == 0 || blob[blob.length() - 1] != '\n')
+	{
+		blob.append("\n");
+	}
+
+	return blob;
+}
+
+
+
+/*************************************************************************************************/
+/**
+	SourceText::GetCompiledExpression()
+
+	Returns the compiled form of the expression with the given key, or NULL if there isn't one
+*/
+/*************************************************************************************************/
+const LineParser::CompiledExpression* SourceText::GetCompiledExpression( int key ) const
+{
+	if ( m_compiledGeneration != ScopedSymbolName::GetInternTableGeneration() )
+	{
+		return NULL;
+	}
+
+	unordered_map< int, unique_ptr<LineParser::CompiledExpression> >::const_iterator it = m_compiledExpressions.find( key );
+
+	return ( it != m_compiledExpressions.end() ) ? it->second.get() : NULL;
+}
+
+
+
+/*************************************************************************************************/
+/**
+	SourceText::AddCompiledExpression()
+
+	Stores the compiled form of an expression
+*/
+/*************************************************************************************************/
+void SourceText::AddCompiledExpression( int key, unique_ptr<LineParser::CompiledExpression> compiled )
+{
+	// Those compiled in an earlier context can't be used again
+	if ( m_compiledGeneration != ScopedSymbolName::GetInternTableGeneration() )
+	{
+		m_compiledExpressions.clear();
+		m_compiledGeneration = ScopedSymbolName::GetInternTableGeneration();
+	}
+
+	m_compiledExpressions[ key ] = std::move( compiled );
+}
@@ -0,0 +1,78 @@
+/*************************************************************************************************/
+/**
+	sourcetext.h
+
+
+	Copyright (C) Rich Talbot-Watkins 2007 - 2012
+
+	This file is part of BeebAsm.
+
+	BeebAsm is free software: you can redistribute it and/or modify it under the terms of the GNU
+	General Public License as published by the Free Software Foundation, either version 3 of the
+	License, or (at your option) any later version.
+
+	BeebAsm is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without
+	even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License along with BeebAsm, as
+	COPYING.txt.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/*************************************************************************************************/
+
+#ifndef SOURCETEXT_H_
+#define SOURCETEXT_H_
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "lineparser.h"
+
+
+/*************************************************************************************************/
+/**
+	SourceText
+
+	The normalised text of a source file or macro body, together with anything the parser has
+	learnt about it which doesn't depend on assembler state.  A SourceText is shared by every
+	SourceCode which processes the same text, so it outlives a single pass or FOR iteration and
+	the parser only has to lex each statement once.
+*/
+/*************************************************************************************************/
+class SourceText
+{
+public:
+
+	explicit SourceText( const std::string& text );
+	~SourceText();
+
+	static std::string			Normalise( const char* data, size_t length );
+
+	inline const std::string&	GetText() const					{ return m_text; }
+
+	// Lexed statement classification, indexed by the offset of the start of a statement.
+	// Zero means the statement at this offset hasn't been lexed yet; the parser owns the
+	// meaning of any other value.
+
+	inline unsigned char&		LexedStatement( int offset )	{ return m_lexCache[ offset ]; }
+
+	// Expressions compiled by the parser, keyed by the offset at which they start and the
+	// way they were parsed.  They name symbols with the interned names of one AssemblerContext,
+	// so are forgotten when used with another.
+
+	const LineParser::CompiledExpression*	GetCompiledExpression( int key ) const;
+	void						AddCompiledExpression( int key, std::unique_ptr<LineParser::CompiledExpression> compiled );
+
+
+private:
+
+	std::string					m_text;
+	std::vector<unsigned char>	m_lexCache;
+	std::unordered_map< int, std::unique_ptr<LineParser::CompiledExpression> >	m_compiledExpressions;
+	int							m_compiledGeneration;
+};
+
+
+#endif // SOURCETEXT_H_
@@ -0,0 +1,277 @@
+/*************************************************************************************************/
+/**
+	statistics.cpp
+
+	Counts what an assembly does, for -stats
+
+
+	Copyright (C) Rich Talbot-Watkins 2007 - 2012
+
+	This file is part of BeebAsm.
+
+	BeebAsm is free software: you can redistribute it and/or modify it under the terms of the GNU
+	General Public License as published by the Free Software Foundation, either version 3 of the
+	License, or (at your option) any later version.
+
+	BeebAsm is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without
+	even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License along with BeebAsm, as
+	COPYING.txt.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/*************************************************************************************************/
+
+#include <cstring>
+#include <iomanip>
+#include <sstream>
+
+#include "statistics.h"
+#include "filecache.h"
+#include "lineparser.h"
+#include "objectcode.h"
+#include "stringutils.h"
+#include "symboltable.h"
+#include "version.h"
+
+using namespace std;
+
+
+thread_local Statistics* Statistics::m_gInstance = NULL;
+
+
+// The names of the counters in the JSON, in the order of Statistics::COUNTER
+
+static const char* const gCounterNames[ Statistics::COUNTER_COUNT ] =
+{
+	"lines",
+	"instructions",
+	"assignments",
+	"expressions",
+	"compiled_expressions",
+	"symbol_probes",
+	"macro_instances",
+	"files_opened",
+	"strings_allocated"
+};
+
+
+
+/*************************************************************************************************/
+/**
+	Statistics::Create()
+
+	Creates the Statistics singleton
+*/
+/*************************************************************************************************/
+void Statistics::Create()
+{
+	assert( m_gInstance == NULL );
+
+	m_gInstance = new Statistics;
+}
+
+
+
+/*************************************************************************************************/
+/**
+	Statistics::Destroy()
+
+	Destroys the Statistics singleton
+*/
+/*************************************************************************************************/
+void Statistics::Destroy()
+{
+	assert( m_gInstance != NULL );
+
+	delete m_gInstance;
+	m_gInstance = NULL;
+}
+
+
+
+/*************************************************************************************************/
+/**
+	Statistics::Statistics()
+
+	Statistics constructor, which starts the setup phase
+*/
+/*************************************************************************************************/
+Statistics::Statistics()
+	:	m_pPhaseName( "setup" ),
+		m_phaseStart( Clock::now() ),
+		m_phaseStartBytes( 0 ),
+		m_statements( LineParser::GetNumberOfTokens(), 0 )
+{
+	memset( m_counts, 0, sizeof m_counts );
+}
+
+
+
+/*************************************************************************************************/
+/**
+	Statistics::~Statistics()
+
+	Statistics destructor
+*/
+/*************************************************************************************************/
+Statistics::~Statistics()
+{
+}
+
+
+
+/*************************************************************************************************/
+/**
+	Statistics::EndPhase()
+
+	Records the phase in progress
+*/
+/*************************************************************************************************/
+void Statistics::EndPhase()
+{
+	int bytes = ObjectCode::Instance().GetBytesAssembled();
+
+	Phase phase;
+	phase.m_name = m_pPhaseName;
+	phase.m_seconds = chrono::duration<double>( Clock::now() - m_phaseStart ).count();
+	phase.m_bytes = bytes - m_phaseStartBytes;
+	memcpy( phase.m_counts, m_counts, sizeof m_counts );
+	m_phases.push_back( phase );
+
+	memset( m_counts, 0, sizeof m_counts );
+	m_phaseStartBytes = bytes;
+}
+
+
+
+/*************************************************************************************************/
+/**
+	Statistics::StartPhase()
+
+	Ends the phase in progress, and starts another
+
+	@param		pName			Name of the new phase, e.g. "pass1"
+*/
+/*************************************************************************************************/
+void Statistics::StartPhase( const char* pName )
+{
+	EndPhase();
+
+	m_pPhaseName = pName;
+	m_phaseStart = Clock::now();
+}
+
+
+
+/*************************************************************************************************/
+/**
+	WriteCounts()
+
+	Writes the members of a JSON object for a phase, or for all of them
+*/
+/*************************************************************************************************/
+static void WriteCounts( ostringstream& json, double seconds, long long bytes, const long long* pCounts )
+{
+	json << "\"seconds\": " << fixed << setprecision( 6 ) << seconds << ", \"bytes\": " << bytes;
+
+	for ( int i = 0; i < Statistics::COUNTER_COUNT; i++ )
+	{
+		json << ", \"" << gCounterNames[ i ] << "\": " << pCounts[ i ];
+	}
+}
+
+
+
+/*************************************************************************************************/
+/**
+	Statistics::Write()
+
+	Ends the phase in progress, and writes everything counted as JSON
+
+	@param		filename			File to write to
+	@param		sourceFile			The source file assembled
+	@param		bSucceeded			Whether the assembly succeeded
+	@param		bRestoredFromCache	Whether the output was restored by -cache instead
+
+	@return		false if the file couldn't be written
+*/
+/*************************************************************************************************/
+bool Statistics::Write( const string& filename, const string& sourceFile, bool bSucceeded, bool bRestoredFromCache )
+{
+	EndPhase();
+
+	ostringstream json;
+	json << "{" << endl;
+	json << "\t\"version\": " << StringUtils::JsonString( VERSION ) << "," << endl;
+	json << "\t\"source\": " << StringUtils::JsonString( sourceFile ) << "," << endl;
+	json << "\t\"succeeded\": " << ( bSucceeded ? "true" : "false" ) << "," << endl;
+	json << "\t\"restored_from_cache\": " << ( bRestoredFromCache ? "true" : "false" ) << "," << endl;
+
+	// The totals, and then each phase
+
+	double totalSeconds = 0.0;
+	long long totalBytes = 0;
+	long long totalCounts[ COUNTER_COUNT ] = {};
+
+	for ( size_t i = 0; i < m_phases.size(); i++ )
+	{
+		totalSeconds += m_phases[ i ].m_seconds;
+		totalBytes += m_phases[ i ].m_bytes;
+
+		for ( int j = 0; j < COUNTER_COUNT; j++ )
+		{
+			totalCounts[ j ] += m_phases[ i ].m_counts[ j ];
+		}
+	}
+
+	json << "\t\"total\": { ";
+	WriteCounts( json, totalSeconds, totalBytes, totalCounts );
+	json << " }," << endl;
+
+	json << "\t\"phases\": [" << endl;
+
+	for ( size_t i = 0; i < m_phases.size(); i++ )
+	{
+		json << "\t\t{ \"name\": " << StringUtils::JsonString( m_phases[ i ].m_name ) << ", ";
+		WriteCounts( json, m_phases[ i ].m_seconds, m_phases[ i ].m_bytes, m_phases[ i ].m_counts );
+		json << " }" << ( i + 1 < m_phases.size() ? "," : "" ) << endl;
+	}
+
+	json << "\t]," << endl;
+
+	// Statements of each kind which were used
+
+	json << "\t\"statements\": {";
+
+	const char* pSeparator = "";
+
+	for ( size_t i = 0; i < m_statements.size(); i++ )
+	{
+		if ( m_statements[ i ] > 0 )
+		{
+			json << pSeparator << endl << "\t\t" << StringUtils::JsonString( LineParser::GetTokenName( static_cast< int >( i ) ) ) << ": " << m_statements[ i ];
+			pSeparator = ",";
+		}
+	}
+
+	json << endl << "\t}," << endl;
+
+	// How full the symbol table's hash table is
+
+	size_t symbols;
+	size_t buckets;
+	size_t largestBucket;
+	SymbolTable::Instance().GetBucketStatistics( symbols, buckets, largestBucket );
+
+	json << "\t\"symbol_table\": { \"symbols\": " << symbols
+		 << ", \"buckets\": " << buckets
+		 << ", \"load_factor\": " << fixed << setprecision( 3 ) << ( buckets > 0 ? static_cast< double >( symbols ) / buckets : 0.0 )
+		 << ", \"largest_bucket\": " << largestBucket << " }" << endl;
+
+	json << "}" << endl;
+
+	const string& text = json.str();
+
+	return FileCache::Instance().WriteFile( filename, reinterpret_cast< const unsigned char* >( text.data() ), text.size() ) == FileSystem::FILE_OK;
+}
@@ -0,0 +1,110 @@
+/*************************************************************************************************/
+/**
+	statistics.h
+
+
+	Copyright (C) Rich Talbot-Watkins 2007 - 2012
+
+	This file is part of BeebAsm.
+
+	BeebAsm is free software: you can redistribute it and/or modify it under the terms of the GNU
+	General Public License as published by the Free Software Foundation, either version 3 of the
+	License, or (at your option) any later version.
+
+	BeebAsm is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without
+	even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License along with BeebAsm, as
+	COPYING.txt.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/*************************************************************************************************/
+
+#ifndef STATISTICS_H_
+#define STATISTICS_H_
+
+#include <cassert>
+#include <chrono>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+
+/*************************************************************************************************/
+/**
+	Statistics
+
+	Counts what an assembly does, in each of its phases - setting up, each pass, and writing the
+	output - so that -stats can write the counts out as JSON.
+
+	Counting is always on, as each count is no more than an increment.  Anything counted while
+	no assembly is running on the thread, e.g. a string allocated while a library caller
+	collects the results, is ignored.
+*/
+/*************************************************************************************************/
+class Statistics
+{
+public:
+
+	static void Create();
+	static void Destroy();
+	static inline Statistics& Instance() { assert( m_gInstance != NULL ); return *m_gInstance; }
+
+	enum COUNTER
+	{
+		LINES,					// lines of source processed
+		INSTRUCTIONS,			// 6502 instructions assembled
+		ASSIGNMENTS,			// symbol assignments
+		EXPRESSIONS,			// expressions evaluated
+		COMPILED_EXPRESSIONS,	// expressions evaluated from their compiled form
+		SYMBOL_PROBES,			// symbol table lookups
+		MACRO_INSTANCES,		// macro invocations
+		FILES_OPENED,			// files read from disc, rather than from the file cache
+		STRINGS_ALLOCATED,		// string values allocated
+
+		COUNTER_COUNT
+	};
+
+	static inline void	Count( COUNTER counter )	{ if ( m_gInstance != NULL ) m_gInstance->m_counts[ counter ]++; }
+	static inline void	CountStatement( int token )	{ if ( m_gInstance != NULL ) m_gInstance->m_statements[ token ]++; }
+
+	// Ends the current phase, and starts another
+	void				StartPhase( const char* pName );
+
+	bool				Write( const std::string& filename, const std::string& sourceFile,
+							   bool bSucceeded, bool bRestoredFromCache );
+
+
+private:
+
+	Statistics();
+	~Statistics();
+
+	typedef std::chrono::steady_clock Clock;
+
+	struct Phase
+	{
+		std::string			m_name;
+		double				m_seconds;
+		long long			m_bytes;
+		long long			m_counts[ COUNTER_COUNT ];
+	};
+
+	void				EndPhase();
+
+	std::vector<Phase>		m_phases;
+
+	// The phase in progress
+	const char*				m_pPhaseName;
+	Clock::time_point		m_phaseStart;
+	int						m_phaseStartBytes;
+	long long				m_counts[ COUNTER_COUNT ];
+
+	// Statements of each kind, indexed by token
+	std::vector<long long>	m_statements;
+
+	static thread_local Statistics*	m_gInstance;
+};
+
+
+#endif // STATISTICS_H_
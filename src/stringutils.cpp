@@ -20,6 +20,7 @@
 */
 /*************************************************************************************************/
 
+#include <cstdio>
 #include <iostream>
 #include <sstream>
 #include "globaldata.h"
@@ -124,4 +125,46 @@ void PrintNumber(std::ostream& dest, double value)
 	dest << value;
 }
 
+
+
+/*************************************************************************************************/
+/**
+	JsonString()
+
+	Quotes a string for JSON, e.g. for -stats and -trace
+
+	@param		text		The string to quote
+
+	@return		string		The string in quotes, with any quotes, backslashes and control
+							characters in it escaped
+*/
+/*************************************************************************************************/
+std::string JsonString( const std::string& text )
+{
+	std::string quoted = "\"";
+
+	for ( size_t i = 0; i < text.length(); i++ )
+	{
+		unsigned char c = static_cast< unsigned char >( text[ i ] );
+
+		if ( c == '"' || c == '\\' )
+		{
+			quoted += '\\';
+			quoted += static_cast< char >( c );
+		}
+		else if ( c < 0x20 )
+		{
+			char escaped[ 8 ];
+			sprintf( escaped, "\\u%04x", c );
+			quoted += escaped;
+		}
+		else
+		{
+			quoted += static_cast< char >( c );
+		}
+	}
+
+	return quoted + "\"";
+}
+
 } // namespace StringUtils
@@ -31,6 +31,7 @@ namespace StringUtils
 	bool EatWhitespace( const std::string& line, size_t& column );
 	std::string FormattedErrorLocation ( const std::string& filename, int lineNumber );
 	void PrintNumber(std::ostream& dest, double value);
+	std::string JsonString( const std::string& text );
 }
 
 
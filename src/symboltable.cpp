@@ -22,11 +22,11 @@
 
 #include <cmath>
 #include <cstdio>
-#include <fstream>
 #include <iostream>
 #include <sstream>
 #include <algorithm>
 
+#include "filecache.h"
 #include "globaldata.h"
 #include "objectcode.h"
 #include "symboltable.h"
@@ -34,12 +34,13 @@
 #include "asmexception.h"
 #include "literals.h"
 #include "stringutils.h"
+#include "statistics.h"
 
 
 using namespace std;
 
 
-SymbolTable* SymbolTable::m_gInstance = NULL;
+thread_local SymbolTable* SymbolTable::m_gInstance = NULL;
 
 
 /*************************************************************************************************/
@@ -88,7 +89,6 @@ SymbolTable::SymbolTable()
 	// Add any constant symbols here
 
 	AddBuiltInSymbol( "PI", const_pi );
-	AddBuiltInSymbol( "P%", 0 );
 	AddBuiltInSymbol( "TRUE", -1 );
 	AddBuiltInSymbol( "FALSE", 0 );
 }
@@ -120,11 +120,171 @@ SymbolTable::~SymbolTable()
 /*************************************************************************************************/
 bool SymbolTable::IsSymbolDefined( const ScopedSymbolName& symbol ) const
 {
+	Statistics::Count( Statistics::SYMBOL_PROBES );
 	return m_map.find( symbol ) != m_map.cend();
 }
 
 
 
+/*************************************************************************************************/
+/**
+	SymbolTable::FindSymbol()
+
+	Looks up a symbol with a single probe of the symbol table
+
+	@param		symbol			The symbol to search for
+	@returns	The symbol, or NULL if it is not defined
+*/
+/*************************************************************************************************/
+const SymbolTable::Symbol* SymbolTable::FindSymbol( const ScopedSymbolName& symbol ) const
+{
+	Statistics::Count( Statistics::SYMBOL_PROBES );
+	MapType::const_iterator it = m_map.find( symbol );
+	return ( it != m_map.cend() ) ? &it->second : NULL;
+}
+
+SymbolTable::Symbol* SymbolTable::FindSymbol( const ScopedSymbolName& symbol )
+{
+	Statistics::Count( Statistics::SYMBOL_PROBES );
+	MapType::iterator it = m_map.find( symbol );
+	return ( it != m_map.end() ) ? &it->second : NULL;
+}
+
+
+
+/*************************************************************************************************/
+/**
+	SymbolTable::FindSymbolOrEstimate()
+
+	Looks up a symbol, falling back to its value from the previous pass while relaxing
+
+	@param		symbol			The symbol to search for
+	@returns	The symbol, or NULL if it is not defined in this pass or the previous one
+*/
+/*************************************************************************************************/
+const SymbolTable::Symbol* SymbolTable::FindSymbolOrEstimate( const ScopedSymbolName& symbol ) const
+{
+	const Symbol* pSymbol = FindSymbol( symbol );
+
+	if ( pSymbol == NULL && !m_estimates.empty() )
+	{
+		Statistics::Count( Statistics::SYMBOL_PROBES );
+		MapType::const_iterator it = m_estimates.find( symbol );
+		if ( it != m_estimates.cend() )
+		{
+			pSymbol = &it->second;
+		}
+	}
+
+	return pSymbol;
+}
+
+
+
+/*************************************************************************************************/
+/**
+	SymbolTable::SavePredefinedSymbols()
+
+	Remembers the symbols defined before assembly starts (built-in and command line symbols), so
+	that each relaxation pass can start from them
+*/
+/*************************************************************************************************/
+void SymbolTable::SavePredefinedSymbols()
+{
+	m_predefined = m_map;
+}
+
+
+
+/*************************************************************************************************/
+/**
+	SymbolTable::StartRelaxationPass()
+
+	Prepares for a repeat of the first pass.  The symbols defined by the previous pass become the
+	estimates used for forward references, and only the predefined symbols remain defined.
+*/
+/*************************************************************************************************/
+void SymbolTable::StartRelaxationPass()
+{
+	m_estimates.swap( m_map );
+	m_map = m_predefined;
+
+	// m_scopedDefinitions is deliberately left alone: it still counts the FOR scoped estimates,
+	// which lookups must be able to find
+}
+
+
+
+/*************************************************************************************************/
+/**
+	SymbolTable::MatchesEstimates()
+
+	Returns whether every symbol has the same value as in the previous pass, i.e. the layout has
+	settled.  If not, the name of a symbol which changed is returned in changedSymbol.
+*/
+/*************************************************************************************************/
+bool SymbolTable::MatchesEstimates( string& changedSymbol ) const
+{
+	for ( MapType::const_iterator it = m_map.begin(); it != m_map.end(); ++it )
+	{
+		MapType::const_iterator estimate = m_estimates.find( it->first );
+
+		if ( estimate == m_estimates.end() ||
+			 Value::Compare( estimate->second.GetValue(), it->second.GetValue() ) != 0 )
+		{
+			changedSymbol = it->first.Name();
+			return false;
+		}
+	}
+
+	for ( MapType::const_iterator it = m_estimates.begin(); it != m_estimates.end(); ++it )
+	{
+		if ( m_map.find( it->first ) == m_map.end() )
+		{
+			changedSymbol = it->first.Name();
+			return false;
+		}
+	}
+
+	return true;
+}
+
+
+
+/*************************************************************************************************/
+/**
+	SymbolTable::EndRelaxation()
+
+	Discards the estimates once the layout has settled
+*/
+/*************************************************************************************************/
+void SymbolTable::EndRelaxation()
+{
+	m_estimates.clear();
+	m_predefined.clear();
+}
+
+
+
+/*************************************************************************************************/
+/**
+	SymbolTable::HasScopedDefinitions()
+
+	Returns whether the supplied name has ever been defined inside a FOR scope.  If not, only
+	its top level definition need be searched for, however deeply nested the reference is.
+
+	@param		symbol			The symbol to search for; only its name is considered
+	@returns	bool
+*/
+/*************************************************************************************************/
+bool SymbolTable::HasScopedDefinitions( const ScopedSymbolName& symbol ) const
+{
+	size_t atom = static_cast< size_t >( symbol.Atom() );
+	return atom < m_scopedDefinitions.size() && m_scopedDefinitions[ atom ] > 0;
+}
+
+
+
 /*************************************************************************************************/
 /**
 	SymbolTable::AddBuiltInSymbol()
@@ -142,6 +302,26 @@ void SymbolTable::AddBuiltInSymbol( const string& name, Value value )
 
 
 
+/*************************************************************************************************/
+/**
+	SymbolTable::AddBuiltInSymbol()
+
+	Adds a unscoped symbol to the symbol table whose value is read from the supplied variable
+	whenever the symbol is referenced
+
+	@param		symbol			The symbol to add
+	@param		pValue			The variable holding its value, which must outlive the symbol
+*/
+/*************************************************************************************************/
+void SymbolTable::AddBuiltInSymbol( const string& name, const int* pValue )
+{
+	bool inserted = m_map.insert( make_pair( ScopedSymbolName( name ), Symbol( pValue ) ) ).second;
+	assert( inserted );
+	(void)inserted;
+}
+
+
+
 /*************************************************************************************************/
 /**
 	SymbolTable::AddSymbol()
@@ -154,8 +334,19 @@ void SymbolTable::AddBuiltInSymbol( const string& name, Value value )
 /*************************************************************************************************/
 void SymbolTable::AddSymbol( const ScopedSymbolName& symbol, Value value, bool isLabel )
 {
-	assert( !IsSymbolDefined( symbol ) );
-	m_map.insert( make_pair( symbol, Symbol( value, isLabel ) ) );
+	bool inserted = m_map.insert( make_pair( symbol, Symbol( value, isLabel ) ) ).second;
+	assert( inserted );
+	(void)inserted;
+
+	if ( !symbol.TopLevel() )
+	{
+		size_t atom = static_cast< size_t >( symbol.Atom() );
+		if ( atom >= m_scopedDefinitions.size() )
+		{
+			m_scopedDefinitions.resize( atom + 1, 0 );
+		}
+		m_scopedDefinitions[ atom ]++;
+	}
 }
 
 
@@ -283,25 +474,9 @@ bool SymbolTable::AddCommandLineStringSymbol( const std::string& expr )
 /*************************************************************************************************/
 Value SymbolTable::GetSymbol( const ScopedSymbolName& symbol ) const
 {
-	assert( IsSymbolDefined( symbol ) );
-	return m_map.find( symbol )->second.GetValue();
-}
-
-
-
-/*************************************************************************************************/
-/**
-	SymbolTable::ChangeBuiltInSymbol()
-
-	Changes the value of an unscoped symbol which already exists in the symbol table
-
-	@param		symbolName		The name of the symbol to look for
-	@param		value			Its new value
-*/
-/*************************************************************************************************/
-void SymbolTable::ChangeBuiltInSymbol( const std::string& symbolName, double value )
-{
-	ChangeSymbol(ScopedSymbolName(symbolName), value);
+	const Symbol* pSymbol = FindSymbol( symbol );
+	assert( pSymbol != NULL );
+	return pSymbol->GetValue();
 }
 
 
@@ -318,8 +493,9 @@ void SymbolTable::ChangeBuiltInSymbol( const std::string& symbolName, double val
 /*************************************************************************************************/
 void SymbolTable::ChangeSymbol( const ScopedSymbolName& symbol, Value value )
 {
-	assert( IsSymbolDefined( symbol ) );
-	m_map.find( symbol )->second.SetValue( value );
+	Symbol* pSymbol = FindSymbol( symbol );
+	assert( pSymbol != NULL );
+	pSymbol->SetValue( value );
 }
 
 
@@ -335,8 +511,14 @@ void SymbolTable::ChangeSymbol( const ScopedSymbolName& symbol, Value value )
 /*************************************************************************************************/
 void SymbolTable::RemoveSymbol( const ScopedSymbolName& symbol )
 {
-	assert( IsSymbolDefined( symbol ) );
-	m_map.erase( symbol );
+	MapType::size_type erased = m_map.erase( symbol );
+	assert( erased == 1 );
+	(void)erased;
+
+	if ( !symbol.TopLevel() )
+	{
+		m_scopedDefinitions[ static_cast< size_t >( symbol.Atom() ) ]--;
+	}
 }
 
 
@@ -350,8 +532,8 @@ void SymbolTable::RemoveSymbol( const ScopedSymbolName& symbol )
 /*************************************************************************************************/
 void SymbolTable::Dump(bool global, bool all, const char * labels_file) const
 {
-	std::ofstream labels;
-	std::ostream & our_cout = (labels_file && (labels.open(labels_file), !labels.bad())) ? labels : std::cout;
+	std::ostringstream labels;
+	std::ostream & our_cout = labels_file ? labels : GlobalData::Instance().GetOutputStream();
 
 	our_cout << "[{";
 
@@ -406,8 +588,67 @@ void SymbolTable::Dump(bool global, bool all, const char * labels_file) const
 	}
 
 	our_cout << "}]" << endl;
+
+	if (labels_file)
+	{
+		const std::string& text = labels.str();
+		FileCache::Instance().WriteFile(labels_file, reinterpret_cast< const unsigned char* >(text.data()), text.size());
+	}
+}
+
+
+
+/*************************************************************************************************/
+/**
+	SymbolTable::GetLabels()
+
+	Gets the name and value of every global label with a numeric value, as dumped by -d
+
+	@param		labels			Filled in with the labels
+*/
+/*************************************************************************************************/
+void SymbolTable::GetLabels( std::map<std::string, double>& labels ) const
+{
+	for ( MapType::const_iterator it = m_map.begin(); it != m_map.end(); ++it )
+	{
+		if ( it->second.IsLabel() && it->first.TopLevel() )
+		{
+			Value value = it->second.GetValue();
+
+			if ( value.GetType() == Value::NumberValue )
+			{
+				labels[ it->first.Name() ] = value.GetNumber();
+			}
+		}
+	}
 }
 
+
+
+/*************************************************************************************************/
+/**
+	SymbolTable::GetBucketStatistics()
+
+	Gets how full the hash table holding the symbols is, for -stats
+
+	@param		symbols			Filled in with the number of symbols
+	@param		buckets			Filled in with the number of buckets
+	@param		largestBucket	Filled in with the most symbols in any one bucket
+*/
+/*************************************************************************************************/
+void SymbolTable::GetBucketStatistics( size_t& symbols, size_t& buckets, size_t& largestBucket ) const
+{
+	symbols = m_map.size();
+	buckets = m_map.bucket_count();
+	largestBucket = 0;
+
+	for ( size_t i = 0; i < buckets; i++ )
+	{
+		largestBucket = std::max( largestBucket, m_map.bucket_size( i ) );
+	}
+}
+
+
 void SymbolTable::PushBrace()
 {
 	if (GlobalData::Instance().IsSecondPass())
@@ -25,6 +25,7 @@
 
 #include <cassert>
 #include <cstdlib>
+#include <map>
 #include <unordered_map>
 #include <string>
 #include <vector>
@@ -41,17 +42,52 @@ public:
 	static void Destroy();
 	static inline SymbolTable& Instance() { assert( m_gInstance != NULL ); return *m_gInstance; }
 
+	class Symbol
+	{
+	public:
+
+		Symbol( Value value, bool isLabel ) : m_value( value ), m_isLabel( isLabel ), m_pLiveValue( NULL ) {}
+		Symbol( const int* pLiveValue ) : m_isLabel( false ), m_pLiveValue( pLiveValue ) {}
+
+		void SetValue( Value value ) { assert( m_pLiveValue == NULL ); m_value = value; }
+		Value GetValue() const { return ( m_pLiveValue != NULL ) ? Value( static_cast< double >( *m_pLiveValue ) ) : m_value; }
+		bool IsLabel() const { return m_isLabel; }
+
+	private:
+
+		Value		m_value;
+		bool		m_isLabel;
+
+		// Built-in symbols like P% which mirror some assembler state read it from here when
+		// they are referenced, rather than being updated every time the state changes
+		const int*	m_pLiveValue;
+	};
+
 	void AddBuiltInSymbol( const std::string& symbol, Value value );
+	void AddBuiltInSymbol( const std::string& symbol, const int* pValue );
 	void AddSymbol( const ScopedSymbolName& symbol, Value value, bool isLabel = false );
 	bool AddCommandLineSymbol( const std::string& expr );
 	bool AddCommandLineStringSymbol( const std::string& expr );
-	void ChangeBuiltInSymbol( const std::string& symbol, double value );
 	void ChangeSymbol( const ScopedSymbolName& symbol, Value value );
 	Value GetSymbol( const ScopedSymbolName& symbol ) const;
+	const Symbol* FindSymbol( const ScopedSymbolName& symbol ) const;
+	Symbol* FindSymbol( const ScopedSymbolName& symbol );
 	bool IsSymbolDefined( const ScopedSymbolName& symbol ) const;
+	bool HasScopedDefinitions( const ScopedSymbolName& symbol ) const;
 	void RemoveSymbol( const ScopedSymbolName& symbol );
 
 	void Dump(bool global, bool all, const char * labels_file) const; // labels_file == nullptr -> stdout
+	void GetLabels( std::map<std::string, double>& labels ) const;
+	void GetBucketStatistics( size_t& symbols, size_t& buckets, size_t& largestBucket ) const;
+
+	// Relaxation: the first pass can be repeated, with forward references taking the values their
+	// symbols had at the end of the previous attempt, until no symbol changes
+
+	void SavePredefinedSymbols();
+	void StartRelaxationPass();
+	bool MatchesEstimates( std::string& changedSymbol ) const;
+	void EndRelaxation();
+	const Symbol* FindSymbolOrEstimate( const ScopedSymbolName& symbol ) const;
 
 	void PushBrace();
 	void PushFor(const ScopedSymbolName& symbol, double value);
@@ -60,29 +96,22 @@ public:
 
 private:
 
-	class Symbol
-	{
-	public:
-
-		Symbol( Value value, bool isLabel ) : m_value( value ), m_isLabel( isLabel ) {}
-
-		void SetValue( Value value ) { m_value = value; }
-		Value GetValue() const { return m_value; }
-		bool IsLabel() const { return m_isLabel; }
-
-	private:
-
-		Value	m_value;
-		bool	m_isLabel;
-	};
-
 	SymbolTable();
 	~SymbolTable();
 
 	typedef std::unordered_map<ScopedSymbolName, Symbol> MapType;
 	MapType m_map;
 
-	static SymbolTable*				m_gInstance;
+	// The symbols which exist before assembly starts, and the symbols from the previous pass
+	// while relaxing
+	MapType m_predefined;
+	MapType m_estimates;
+
+	// The number of symbols defined inside a FOR scope for each name, indexed by its atom.
+	// Most names are never defined in a loop, so their lookups can skip straight to the top level.
+	std::vector<int> m_scopedDefinitions;
+
+	static thread_local SymbolTable*	m_gInstance;
 
 	int m_labelScopes;
 	struct Label
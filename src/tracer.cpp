@@ -0,0 +1,380 @@
+/*************************************************************************************************/
+/**
+	tracer.cpp
+
+	Records a timeline of an assembly, for -trace
+
+
+	Copyright (C) Rich Talbot-Watkins 2007 - 2012
+
+	This file is part of BeebAsm.
+
+	BeebAsm is free software: you can redistribute it and/or modify it under the terms of the GNU
+	General Public License as published by the Free Software Foundation, either version 3 of the
+	License, or (at your option) any later version.
+
+	BeebAsm is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without
+	even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License along with BeebAsm, as
+	COPYING.txt.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/*************************************************************************************************/
+
+#include <iomanip>
+#include <sstream>
+
+#include "tracer.h"
+#include "filecache.h"
+#include "stringutils.h"
+
+using namespace std;
+
+
+thread_local Tracer* Tracer::m_gInstance = NULL;
+
+
+
+/*************************************************************************************************/
+/**
+	Tracer::Create()
+
+	Creates the Tracer singleton
+*/
+/*************************************************************************************************/
+void Tracer::Create()
+{
+	assert( m_gInstance == NULL );
+
+	m_gInstance = new Tracer;
+}
+
+
+
+/*************************************************************************************************/
+/**
+	Tracer::Destroy()
+
+	Destroys the Tracer singleton
+*/
+/*************************************************************************************************/
+void Tracer::Destroy()
+{
+	assert( m_gInstance != NULL );
+
+	delete m_gInstance;
+	m_gInstance = NULL;
+}
+
+
+
+/*************************************************************************************************/
+/**
+	Tracer::Tracer()
+
+	Tracer constructor
+*/
+/*************************************************************************************************/
+Tracer::Tracer()
+	:	m_bEnabled( false ),
+		m_origin( Clock::now() ),
+		m_depth( 0 ),
+		m_pPhaseName( NULL )
+{
+}
+
+
+
+/*************************************************************************************************/
+/**
+	Tracer::~Tracer()
+
+	Tracer destructor
+*/
+/*************************************************************************************************/
+Tracer::~Tracer()
+{
+}
+
+
+
+/*************************************************************************************************/
+/**
+	Tracer::AddEvent()
+
+	Adds a span at the current depth to the timeline, or if it's inside a FOR loop, to the total
+	for its name in the innermost loop
+*/
+/*************************************************************************************************/
+void Tracer::AddEvent( const string& name, const char* pCategory, Clock::time_point start, Clock::time_point end,
+					   const string& args )
+{
+	if ( !m_loops.empty() )
+	{
+		// Anything further inside is already counted in the time of the span directly inside
+		// the loop which contains it
+
+		if ( m_depth > m_loops.back().m_depth )
+		{
+			return;
+		}
+
+		vector<Aggregate>& aggregates = m_loops.back().m_aggregates;
+
+		for ( size_t i = 0; i < aggregates.size(); i++ )
+		{
+			if ( aggregates[ i ].m_name == name && aggregates[ i ].m_pCategory == pCategory )
+			{
+				aggregates[ i ].m_count++;
+				aggregates[ i ].m_duration += end - start;
+				return;
+			}
+		}
+
+		Aggregate aggregate;
+		aggregate.m_name = name;
+		aggregate.m_pCategory = pCategory;
+		aggregate.m_count = 1;
+		aggregate.m_duration = end - start;
+		aggregates.push_back( aggregate );
+		return;
+	}
+
+	Event event;
+	event.m_name = name;
+	event.m_pCategory = pCategory;
+	event.m_start = start - m_origin;
+	event.m_duration = end - start;
+	event.m_args = args;
+	m_events.push_back( event );
+}
+
+
+
+/*************************************************************************************************/
+/**
+	Tracer::BeginSpan()
+
+	Starts a span
+
+	@return		When it started
+*/
+/*************************************************************************************************/
+Tracer::Clock::time_point Tracer::BeginSpan()
+{
+	m_depth++;
+	return Clock::now();
+}
+
+
+
+/*************************************************************************************************/
+/**
+	Tracer::EndSpan()
+
+	Ends the span most recently started, and records it
+
+	@param		name			What to call it on the timeline
+	@param		pCategory		What kind of span it is, e.g. "macro"
+	@param		start			When it started
+	@param		args			Any more detail about it, as the members of a JSON object
+*/
+/*************************************************************************************************/
+void Tracer::EndSpan( const string& name, const char* pCategory, Clock::time_point start, const string& args )
+{
+	Clock::time_point end = Clock::now();
+
+	assert( m_depth > 0 );
+	m_depth--;
+
+	// A span which contains a loop can only end first if an error left the loop unfinished
+
+	while ( !m_loops.empty() && m_loops.back().m_depth > m_depth )
+	{
+		EndLoop( "unfinished FOR", "" );
+	}
+
+	AddEvent( name, pCategory, start, end, args );
+}
+
+
+
+/*************************************************************************************************/
+/**
+	Tracer::BeginLoop()
+
+	Starts a FOR loop, inside which spans are gathered up by name
+*/
+/*************************************************************************************************/
+void Tracer::BeginLoop()
+{
+	m_loops.push_back( Loop() );
+	m_loops.back().m_start = Clock::now();
+	m_loops.back().m_depth = m_depth;
+}
+
+
+
+/*************************************************************************************************/
+/**
+	Tracer::EndLoop()
+
+	Ends the innermost FOR loop, recording it as a span, with the spans gathered up inside it
+	laid end to end from its start
+
+	@param		name			What to call the loop on the timeline
+	@param		args			Any more detail about it, as the members of a JSON object
+*/
+/*************************************************************************************************/
+void Tracer::EndLoop( const string& name, const string& args )
+{
+	assert( !m_loops.empty() );
+
+	Clock::time_point end = Clock::now();
+	Loop loop = m_loops.back();
+	m_loops.pop_back();
+
+	AddEvent( name, "for", loop.m_start, end, args );
+
+	// Inside another loop, all that's kept is how long this one took
+
+	if ( !m_loops.empty() )
+	{
+		return;
+	}
+
+	Clock::time_point start = loop.m_start;
+
+	for ( size_t i = 0; i < loop.m_aggregates.size(); i++ )
+	{
+		const Aggregate& aggregate = loop.m_aggregates[ i ];
+
+		ostringstream count;
+		count << "\"count\": " << aggregate.m_count;
+
+		AddEvent( aggregate.m_name, aggregate.m_pCategory, start, start + aggregate.m_duration, count.str() );
+		start += aggregate.m_duration;
+	}
+}
+
+
+
+/*************************************************************************************************/
+/**
+	Tracer::LocationArgs()
+
+	@param		filename		The file a span comes from
+	@param		lineNumber		The line it comes from
+
+	@return		The args giving the file and line, for EndSpan() or EndLoop()
+*/
+/*************************************************************************************************/
+string Tracer::LocationArgs( const string& filename, int lineNumber )
+{
+	ostringstream args;
+	args << "\"file\": " << StringUtils::JsonString( filename ) << ", \"line\": " << lineNumber;
+	return args.str();
+}
+
+
+
+/*************************************************************************************************/
+/**
+	Tracer::EndPhase()
+
+	Records the phase in progress, if any, which contains every other span
+*/
+/*************************************************************************************************/
+void Tracer::EndPhase()
+{
+	while ( !m_loops.empty() )
+	{
+		EndLoop( "unfinished FOR", "" );
+	}
+
+	if ( m_pPhaseName != NULL )
+	{
+		AddEvent( m_pPhaseName, "phase", m_phaseStart, Clock::now(), "" );
+		m_pPhaseName = NULL;
+	}
+}
+
+
+
+/*************************************************************************************************/
+/**
+	Tracer::StartPhase()
+
+	Ends the phase in progress, and starts another
+
+	@param		pName			Name of the new phase, e.g. "pass1"
+*/
+/*************************************************************************************************/
+void Tracer::StartPhase( const char* pName )
+{
+	EndPhase();
+
+	m_pPhaseName = pName;
+	m_phaseStart = Clock::now();
+}
+
+
+
+/*************************************************************************************************/
+/**
+	Microseconds()
+*/
+/*************************************************************************************************/
+static double Microseconds( Tracer::Clock::duration time )
+{
+	return chrono::duration<double, micro>( time ).count();
+}
+
+
+
+/*************************************************************************************************/
+/**
+	Tracer::Write()
+
+	Ends the phase in progress, and writes the timeline as JSON in the trace event format
+
+	@param		filename		File to write to
+
+	@return		false if the file couldn't be written
+*/
+/*************************************************************************************************/
+bool Tracer::Write( const string& filename )
+{
+	EndPhase();
+
+	ostringstream json;
+	json << "{\"traceEvents\": [" << endl;
+	json << "{\"name\": \"process_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": 1, \"args\": {\"name\": \"beebasm\"}}";
+	json << fixed << setprecision( 3 );
+
+	for ( size_t i = 0; i < m_events.size(); i++ )
+	{
+		const Event& event = m_events[ i ];
+
+		json << "," << endl
+			 << "{\"name\": " << StringUtils::JsonString( event.m_name )
+			 << ", \"cat\": \"" << event.m_pCategory
+			 << "\", \"ph\": \"X\", \"pid\": 1, \"tid\": 1"
+			 << ", \"ts\": " << Microseconds( event.m_start )
+			 << ", \"dur\": " << Microseconds( event.m_duration );
+
+		if ( !event.m_args.empty() )
+		{
+			json << ", \"args\": {" << event.m_args << "}";
+		}
+
+		json << "}";
+	}
+
+	json << endl << "], \"displayTimeUnit\": \"ms\"}" << endl;
+
+	const string& text = json.str();
+
+	return FileCache::Instance().WriteFile( filename, reinterpret_cast<const unsigned char*>( text.data() ), text.size() ) == FileSystem::FILE_OK;
+}
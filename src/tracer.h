@@ -0,0 +1,170 @@
+/*************************************************************************************************/
+/**
+	tracer.h
+
+
+	Copyright (C) Rich Talbot-Watkins 2007 - 2012
+
+	This file is part of BeebAsm.
+
+	BeebAsm is free software: you can redistribute it and/or modify it under the terms of the GNU
+	General Public License as published by the Free Software Foundation, either version 3 of the
+	License, or (at your option) any later version.
+
+	BeebAsm is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without
+	even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License along with BeebAsm, as
+	COPYING.txt.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/*************************************************************************************************/
+
+#ifndef TRACER_H_
+#define TRACER_H_
+
+#include <cassert>
+#include <chrono>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+
+/*************************************************************************************************/
+/**
+	Tracer
+
+	With -trace, records a timeline of the assembly - its phases, each source file (with the
+	files it includes inside it), each macro expansion, each FOR loop and each file added to the
+	disc image - and writes it in the trace event format read by chrome://tracing and Perfetto.
+
+	A FOR loop is a single span, however many times it goes round.  The spans directly inside it
+	are gathered up by name, and drawn inside the loop as one span for each name, as long as all
+	of them together, with the number of times it happened.
+*/
+/*************************************************************************************************/
+class Tracer
+{
+public:
+
+	static void Create();
+	static void Destroy();
+	static inline Tracer& Instance() { assert( m_gInstance != NULL ); return *m_gInstance; }
+
+	typedef std::chrono::steady_clock Clock;
+
+	inline void			Enable()								{ m_bEnabled = true; }
+	inline bool			IsEnabled() const						{ return m_bEnabled; }
+
+	// Ends the current phase, and starts another
+	void				StartPhase( const char* pName );
+
+	// Spans are nested, so each BeginSpan() must be followed by an EndSpan() - see TraceSpan.
+	// args, if not empty, is the members of a JSON object, e.g. "\"bytes\": 256".
+	Clock::time_point	BeginSpan();
+	void				EndSpan( const std::string& name, const char* pCategory, Clock::time_point start,
+								 const std::string& args );
+
+	void				BeginLoop();
+	void				EndLoop( const std::string& name, const std::string& args );
+
+	// The args for a span which comes from a line of source
+	static std::string	LocationArgs( const std::string& filename, int lineNumber );
+
+	bool				Write( const std::string& filename );
+
+
+private:
+
+	Tracer();
+	~Tracer();
+
+	struct Event
+	{
+		std::string			m_name;
+		const char*			m_pCategory;
+		Clock::duration		m_start;			// since the Tracer was created
+		Clock::duration		m_duration;
+		std::string			m_args;
+	};
+
+	struct Aggregate
+	{
+		std::string			m_name;
+		const char*			m_pCategory;
+		int					m_count;
+		Clock::duration		m_duration;
+	};
+
+	struct Loop
+	{
+		Clock::time_point		m_start;
+		int						m_depth;			// of the spans directly inside it
+		std::vector<Aggregate>	m_aggregates;
+	};
+
+	void				EndPhase();
+	void				AddEvent( const std::string& name, const char* pCategory, Clock::time_point start,
+								  Clock::time_point end, const std::string& args );
+
+	bool						m_bEnabled;
+	Clock::time_point			m_origin;
+
+	std::vector<Event>			m_events;
+	std::vector<Loop>			m_loops;			// the FOR loops in progress
+	int							m_depth;			// how many spans are in progress
+
+	// The phase in progress, if any
+	const char*					m_pPhaseName;
+	Clock::time_point			m_phaseStart;
+
+	static thread_local Tracer*	m_gInstance;
+};
+
+
+/*************************************************************************************************/
+/**
+	TraceSpan
+
+	Traces a span from construction until destruction, even if an exception is thrown
+*/
+/*************************************************************************************************/
+class TraceSpan
+{
+public:
+
+	inline TraceSpan( const char* pCategory )
+		:	m_bEnabled( Tracer::Instance().IsEnabled() ),
+			m_pCategory( pCategory )
+	{
+		if ( m_bEnabled )
+		{
+			m_start = Tracer::Instance().BeginSpan();
+		}
+	}
+
+	inline ~TraceSpan()
+	{
+		if ( m_bEnabled )
+		{
+			Tracer::Instance().EndSpan( m_name, m_pCategory, m_start, m_args );
+		}
+	}
+
+	// The name and args are only worth making if the span is being traced
+	inline bool			IsEnabled() const						{ return m_bEnabled; }
+	inline void			SetName( const std::string& name )		{ m_name = name; }
+	inline void			SetArgs( const std::string& args )		{ m_args = args; }
+
+
+private:
+
+	bool						m_bEnabled;
+	const char*					m_pCategory;
+	Tracer::Clock::time_point	m_start;
+	std::string					m_name;
+	std::string					m_args;
+};
+
+
+#endif // TRACER_H_
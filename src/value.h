@@ -27,6 +27,7 @@
 #include <string.h>
 #include <cstdlib>
 
+#include "statistics.h"
 #include "stringutils.h"
 
 // A simple immutable string buffer with a length and a reference count.
@@ -168,6 +169,7 @@ private:
 
 	static StringHeader* Allocate(unsigned int length)
 	{
+		Statistics::Count(Statistics::STRINGS_ALLOCATED);
 		int fullLength = sizeof(StringHeader) + length + 1;
 		char* data = static_cast<char*>(malloc(fullLength));
 		if (!data)
@@ -0,0 +1,303 @@
+/*************************************************************************************************/
+/**
+	watch.cpp
+
+	Assembles again whenever a file read by the previous assembly changes
+
+
+	Copyright (C) Rich Talbot-Watkins 2007 - 2012
+
+	This file is part of BeebAsm.
+
+	BeebAsm is free software: you can redistribute it and/or modify it under the terms of the GNU
+	General Public License as published by the Free Software Foundation, either version 3 of the
+	License, or (at your option) any later version.
+
+	BeebAsm is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without
+	even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License along with BeebAsm, as
+	COPYING.txt.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/*************************************************************************************************/
+
+#include <iostream>
+#include <map>
+#include <set>
+#include <string>
+#include <cstdlib>
+#include <cstring>
+
+#include "watch.h"
+#include "commandline.h"
+#include "filecache.h"
+
+#ifdef __linux__
+#include <cerrno>
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#else
+#include <chrono>
+#include <ctime>
+#include <thread>
+#include <sys/types.h>
+#include <sys/stat.h>
+#endif
+
+
+using namespace std;
+
+
+#ifdef __linux__
+
+/*************************************************************************************************/
+/**
+	SplitPath()
+
+	Splits a path into the directory containing it and the name within that directory
+*/
+/*************************************************************************************************/
+static void SplitPath( const string& path, string& directory, string& name )
+{
+	size_t slash = path.find_last_of( '/' );
+
+	if ( slash == string::npos )
+	{
+		directory = ".";
+		name = path;
+	}
+	else
+	{
+		directory = ( slash == 0 ) ? "/" : path.substr( 0, slash );
+		name = path.substr( slash + 1 );
+	}
+}
+
+
+
+/*************************************************************************************************/
+/**
+	WaitForChange()
+
+	Waits until any of the files is written, created, deleted or replaced, using inotify.  The
+	directories containing them are watched rather than the files themselves, so that editors
+	which save by writing a new file and renaming it over the old one are noticed.
+
+	@param		files			Files to watch
+	@param		changed			Set to the files which changed
+
+	@return		false if the files couldn't be watched
+*/
+/*************************************************************************************************/
+static bool WaitForChange( const set< string >& files, set< string >& changed )
+{
+	int fd = inotify_init();
+
+	if ( fd < 0 )
+	{
+		cerr << "Unable to watch for changes: " << strerror( errno ) << endl;
+		return false;
+	}
+
+	// For each watched directory, the names within it which are wanted, and the paths they
+	// were read as
+
+	map< int, map< string, string > > watched;
+
+	for ( set< string >::const_iterator it = files.begin(); it != files.end(); ++it )
+	{
+		string directory;
+		string name;
+		SplitPath( *it, directory, name );
+
+		int wd = inotify_add_watch( fd, directory.c_str(),
+									IN_CLOSE_WRITE | IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO );
+
+		if ( wd < 0 )
+		{
+			cerr << "Unable to watch " << *it << ": " << strerror( errno ) << endl;
+			continue;
+		}
+
+		watched[ wd ][ name ] = *it;
+	}
+
+	if ( watched.empty() )
+	{
+		close( fd );
+		return false;
+	}
+
+	alignas( inotify_event ) char buffer[ 4096 ];
+
+	// Wait indefinitely for the first change, and then until there's been a short pause, so that
+	// a save which touches several files results in a single assembly
+
+	int timeout = -1;
+
+	for ( ;; )
+	{
+		pollfd request = { fd, POLLIN, 0 };
+		int ready = poll( &request, 1, timeout );
+
+		if ( ready == 0 )
+		{
+			break;
+		}
+
+		ssize_t length = ( ready < 0 ) ? -1 : read( fd, buffer, sizeof buffer );
+
+		if ( length < 0 )
+		{
+			if ( errno == EINTR )
+			{
+				continue;
+			}
+
+			cerr << "Unable to watch for changes: " << strerror( errno ) << endl;
+			close( fd );
+			return false;
+		}
+
+		for ( char* p = buffer; p < buffer + length; )
+		{
+			const inotify_event* event = reinterpret_cast< const inotify_event* >( p );
+
+			if ( event->len > 0 )
+			{
+				map< string, string >& names = watched[ event->wd ];
+				map< string, string >::const_iterator name = names.find( event->name );
+
+				if ( name != names.end() )
+				{
+					changed.insert( name->second );
+				}
+			}
+
+			p += sizeof( inotify_event ) + event->len;
+		}
+
+		if ( !changed.empty() )
+		{
+			timeout = WATCH_SETTLE_TIME;
+		}
+	}
+
+	close( fd );
+	return true;
+}
+
+
+#else
+
+
+/*************************************************************************************************/
+/**
+	WaitForChange()
+
+	Waits until any of the files is written, created or deleted, by checking their modification
+	times and sizes every so often
+
+	@param		files			Files to watch
+	@param		changed			Set to the files which changed
+
+	@return		false if the files couldn't be watched
+*/
+/*************************************************************************************************/
+static bool WaitForChange( const set< string >& files, set< string >& changed )
+{
+	// The modification time and size of each file, or -1 if it doesn't exist
+
+	map< string, pair< time_t, long long > > original;
+
+	for ( set< string >::const_iterator it = files.begin(); it != files.end(); ++it )
+	{
+		struct stat info;
+		original[ *it ] = ( stat( it->c_str(), &info ) == 0 ) ?
+							make_pair( info.st_mtime, static_cast< long long >( info.st_size ) ) :
+							make_pair( static_cast< time_t >( -1 ), -1LL );
+	}
+
+	while ( changed.empty() )
+	{
+		this_thread::sleep_for( chrono::milliseconds( WATCH_POLL_TIME ) );
+
+		for ( set< string >::const_iterator it = files.begin(); it != files.end(); ++it )
+		{
+			struct stat info;
+			pair< time_t, long long > now = ( stat( it->c_str(), &info ) == 0 ) ?
+											make_pair( info.st_mtime, static_cast< long long >( info.st_size ) ) :
+											make_pair( static_cast< time_t >( -1 ), -1LL );
+
+			if ( now != original[ *it ] )
+			{
+				changed.insert( *it );
+			}
+		}
+	}
+
+	this_thread::sleep_for( chrono::milliseconds( WATCH_SETTLE_TIME ) );
+	return true;
+}
+
+
+#endif // __linux__
+
+
+
+/*************************************************************************************************/
+/**
+	RunWatch()
+
+	Assembles with the given command line, and again whenever any file read by the previous
+	assembly - source files, and files for INCBIN, PUTFILE, PUTTEXT and PUTBASIC - changes.  The
+	file cache is kept between assemblies, so only the files which changed are read and lexed
+	again.
+
+	@param		argc			Number of parameters, including the program name
+	@param		argv			Array of parameters
+*/
+/*************************************************************************************************/
+int RunWatch( int argc, char* argv[] )
+{
+	FileCache::Create();
+
+	int exitCode;
+
+	for ( ;; )
+	{
+		exitCode = Assemble( argc, argv, cout, cerr );
+
+		FileCache::Instance().ForgetUnused();
+
+		set< string > files = FileCache::Instance().GetDependencies();
+
+		if ( files.empty() )
+		{
+			// The command line was wrong, or only asked for help
+			break;
+		}
+
+		cerr << "Watching " << files.size() << ( files.size() == 1 ? " file" : " files" ) << " for changes" << endl;
+
+		set< string > changed;
+
+		if ( !WaitForChange( files, changed ) )
+		{
+			exitCode = EXIT_FAILURE;
+			break;
+		}
+
+		for ( set< string >::const_iterator it = changed.begin(); it != changed.end(); ++it )
+		{
+			cerr << "Changed: " << *it << endl;
+			FileCache::Instance().Invalidate( *it );
+		}
+	}
+
+	FileCache::Destroy();
+
+	return exitCode;
+}
@@ -0,0 +1,39 @@
+/*************************************************************************************************/
+/**
+	watch.h
+
+
+	Copyright (C) Rich Talbot-Watkins 2007 - 2012
+
+	This file is part of BeebAsm.
+
+	BeebAsm is free software: you can redistribute it and/or modify it under the terms of the GNU
+	General Public License as published by the Free Software Foundation, either version 3 of the
+	License, or (at your option) any later version.
+
+	BeebAsm is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without
+	even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License along with BeebAsm, as
+	COPYING.txt.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/*************************************************************************************************/
+
+#ifndef WATCH_H_
+#define WATCH_H_
+
+// How long to wait after a change for the rest of a save to arrive, and how often to check
+// for changes where inotify isn't available, in milliseconds
+
+#define WATCH_SETTLE_TIME	100
+#define WATCH_POLL_TIME		250
+
+
+// Assembles with the given command line, and again whenever any file it read changes.  Only
+// returns if the command line is wrong or the files can't be watched.
+
+int RunWatch( int argc, char* argv[] );
+
+
+#endif // WATCH_H_
@@ -0,0 +1,378 @@
+/*************************************************************************************************/
+/**
+	libbeebasmtest.cpp
+
+	Checks what AssembleInMemory() returns: the memory, saved files, symbols and diagnostics of
+	an assembly, files found through the resolver, and the errors it reports; and that
+	assemblies on separate threads at the same time give the same results as one at a time
+
+
+	Copyright (C) Rich Talbot-Watkins 2007 - 2012
+
+	This file is part of BeebAsm.
+
+	BeebAsm is free software: you can redistribute it and/or modify it under the terms of the GNU
+	General Public License as published by the Free Software Foundation, either version 3 of the
+	License, or (at your option) any later version.
+
+	BeebAsm is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without
+	even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License along with BeebAsm, as
+	COPYING.txt.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/*************************************************************************************************/
+
+#include <cstdlib>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "libbeebasm.h"
+
+
+using namespace std;
+
+
+static int failures = 0;
+
+
+/*************************************************************************************************/
+/**
+	Check()
+
+	Reports a failed check
+
+	@param		bPassed			Whether the check passed
+	@param		pDescription	What was checked
+*/
+/*************************************************************************************************/
+static void Check( bool bPassed, const char* pDescription )
+{
+	if ( !bPassed )
+	{
+		cerr << "FAILED: " << pDescription << endl;
+		failures++;
+	}
+}
+
+
+
+/*************************************************************************************************/
+/**
+	Contains()
+*/
+/*************************************************************************************************/
+static bool Contains( const string& text, const string& wanted )
+{
+	return text.find( wanted ) != string::npos;
+}
+
+
+
+/*************************************************************************************************/
+/**
+	TestAssembly()
+
+	Assembles a source which includes a file from the map, and INCBINs one from the resolver
+*/
+/*************************************************************************************************/
+static void TestAssembly()
+{
+	map<string, string> files;
+	files[ "main.6502" ] =
+		"INCLUDE \"defs.6502\"\n"
+		"ORG &2000\n"
+		".start\n"
+		"  LDA #VALUE\n"
+		"  RTS\n"
+		".data\n"
+		"  INCBIN \"data.bin\"\n"
+		".end\n"
+		"PRINT \"size\", end - start\n"
+		"SAVE \"code\", start, end\n";
+	files[ "defs.6502" ] = "VALUE = 42\n";
+
+	vector<string> resolved;
+
+	BeebAsmOptions options;
+	options.m_resolver = [&resolved]( const string& filename, string& contents )
+	{
+		resolved.push_back( filename );
+
+		if ( filename != "data.bin" )
+		{
+			return false;
+		}
+
+		contents = string( "\x01\x02\x03", 3 );
+		return true;
+	};
+
+	BeebAsmResult result = AssembleInMemory( "main.6502", files, options );
+
+	Check( result.m_bSucceeded, "assembly succeeds" );
+	Check( result.m_diagnostics.empty(), "no diagnostics" );
+	Check( Contains( result.m_output, "size6" ), "PRINT goes to the output" );
+
+	Check( resolved.size() == 1 && resolved[ 0 ] == "data.bin", "only data.bin is asked of the resolver" );
+
+	static const unsigned char code[] = { 0xA9, 42, 0x60, 0x01, 0x02, 0x03 };
+
+	Check( result.m_memory.size() == 0x10000, "memory is returned" );
+	Check( result.m_memory.size() == 0x10000 &&
+		   string( result.m_memory.begin() + 0x2000, result.m_memory.begin() + 0x2006 ) ==
+		   string( code, code + sizeof code ), "memory holds the assembled code" );
+
+	Check( result.m_savedFiles.size() == 1, "one file is saved" );
+	Check( result.m_savedFiles[ "code" ] == string( code, code + sizeof code ), "the saved file holds the code" );
+
+	Check( result.m_symbols[ "start" ] == 0x2000, "start is a symbol" );
+	Check( result.m_symbols[ "data" ] == 0x2003, "data is a symbol" );
+	Check( result.m_symbols.count( "VALUE" ) == 0, "constants aren't labels" );
+}
+
+
+
+/*************************************************************************************************/
+/**
+	TestArguments()
+
+	Passes command line options through, and writes a disc image to memory
+*/
+/*************************************************************************************************/
+static void TestArguments()
+{
+	map<string, string> files;
+	files[ "main.6502" ] =
+		"ORG &2000\n"
+		".start\n"
+		"  EQUB LEVEL\n"
+		".end\n"
+		"SAVE \"CODE\", start, end\n";
+
+	BeebAsmOptions options;
+	options.m_arguments.push_back( "-D" );
+	options.m_arguments.push_back( "LEVEL=7" );
+	options.m_arguments.push_back( "-do" );
+	options.m_arguments.push_back( "game.ssd" );
+
+	BeebAsmResult result = AssembleInMemory( "main.6502", files, options );
+
+	Check( result.m_bSucceeded, "assembly with options succeeds" );
+	Check( result.m_memory.size() == 0x10000 && result.m_memory[ 0x2000 ] == 7, "-D defines a symbol" );
+	Check( result.m_savedFiles.count( "game.ssd" ) == 1, "-do writes the disc image" );
+	Check( result.m_savedFiles.count( "CODE" ) == 0, "SAVE goes to the disc image" );
+}
+
+
+
+/*************************************************************************************************/
+/**
+	TestMissingFile()
+
+	An INCLUDE of a file which neither the map nor the resolver has fails
+*/
+/*************************************************************************************************/
+static void TestMissingFile()
+{
+	map<string, string> files;
+	files[ "main.6502" ] = "INCLUDE \"missing.6502\"\n";
+
+	int calls = 0;
+
+	BeebAsmOptions options;
+	options.m_resolver = [&calls]( const string&, string& )
+	{
+		calls++;
+		return false;
+	};
+
+	BeebAsmResult result = AssembleInMemory( "main.6502", files, options );
+
+	Check( !result.m_bSucceeded, "a missing file fails" );
+	Check( calls > 0, "the resolver is asked for a missing file" );
+	Check( Contains( result.m_diagnostics, "missing.6502" ), "the missing file is reported" );
+	Check( result.m_memory.empty(), "no memory is returned from a failed assembly" );
+	Check( result.m_symbols.empty(), "no symbols are returned from a failed assembly" );
+
+	BeebAsmResult noSource = AssembleInMemory( "nowhere.6502", files );
+
+	Check( !noSource.m_bSucceeded, "a missing source file fails" );
+	Check( Contains( noSource.m_diagnostics, "nowhere.6502" ), "the missing source file is reported" );
+}
+
+
+
+/*************************************************************************************************/
+/**
+	TestErrors()
+
+	An error in the source is reported in the diagnostics
+*/
+/*************************************************************************************************/
+static void TestErrors()
+{
+	map<string, string> files;
+	files[ "main.6502" ] =
+		"ORG &2000\n"
+		"  LDA #undefined\n";
+
+	BeebAsmResult result = AssembleInMemory( "main.6502", files );
+
+	Check( !result.m_bSucceeded, "an error fails" );
+	Check( Contains( result.m_diagnostics, "main.6502:2:" ), "the error gives the file and line" );
+	Check( result.m_savedFiles.empty(), "nothing is saved" );
+}
+
+
+
+/*************************************************************************************************/
+/**
+	TestCacheRejected()
+
+	-cache would write to the disk, so it is refused before anything is read
+*/
+/*************************************************************************************************/
+static void TestCacheRejected()
+{
+	map<string, string> files;
+	files[ "main.6502" ] = "ORG &2000\nNOP\n";
+
+	bool bResolverCalled = false;
+
+	BeebAsmOptions options;
+	options.m_arguments.push_back( "-cache" );
+	options.m_arguments.push_back( "cachedir" );
+	options.m_resolver = [&bResolverCalled]( const string&, string& )
+	{
+		bResolverCalled = true;
+		return false;
+	};
+
+	BeebAsmResult result = AssembleInMemory( "main.6502", files, options );
+
+	Check( !result.m_bSucceeded, "-cache fails" );
+	Check( Contains( result.m_diagnostics, "-cache" ), "-cache is reported" );
+	Check( !bResolverCalled, "nothing is read with -cache" );
+	Check( result.m_savedFiles.empty(), "nothing is saved with -cache" );
+}
+
+
+
+/*************************************************************************************************/
+/**
+	TestConcurrentAssemblies()
+
+	Assembles several variants of a source on separate threads at once, a few times over, and
+	checks each gives exactly what it gives when assembled alone.  The source uses everything
+	which once kept state outside the assembly: symbols, macros, RND and TIME$.
+*/
+/*************************************************************************************************/
+static void TestConcurrentAssemblies()
+{
+	static const int VARIANTS = 8;
+	static const int ROUNDS = 3;
+
+	map<string, string> files;
+	files[ "main.6502" ] =
+		"RANDOMIZE LEVEL\n"
+		"MACRO TABLE n\n"
+		"  FOR i, 0, n\n"
+		"    EQUB ( i * LEVEL ) AND 255, RND(256)\n"
+		"  NEXT\n"
+		"ENDMACRO\n"
+		"ORG &1900\n"
+		".start\n"
+		"  LDX #LEVEL\n"
+		".loop\n"
+		"  DEX\n"
+		"  BNE loop\n"
+		"  RTS\n"
+		".table\n"
+		"  TABLE 200\n"
+		"  ASSERT LEN( TIME$( \"%H:%M:%S\" ) ) = 8\n"
+		"  EQUS STR$~( RND(65536) )\n"
+		".end\n"
+		"PRINT \"level\", LEVEL, ~end\n"
+		"SAVE \"code\", start, end\n";
+
+	vector<BeebAsmOptions> options( VARIANTS );
+
+	for ( int i = 0; i < VARIANTS; i++ )
+	{
+		ostringstream level;
+		level << "LEVEL=" << ( i + 1 );
+		options[ i ].m_arguments.push_back( "-D" );
+		options[ i ].m_arguments.push_back( level.str() );
+	}
+
+	vector<BeebAsmResult> expected( VARIANTS );
+
+	for ( int i = 0; i < VARIANTS; i++ )
+	{
+		expected[ i ] = AssembleInMemory( "main.6502", files, options[ i ] );
+		Check( expected[ i ].m_bSucceeded, "each variant assembles alone" );
+	}
+
+	Check( expected[ 0 ].m_memory != expected[ 1 ].m_memory, "the variants differ" );
+
+	for ( int round = 0; round < ROUNDS; round++ )
+	{
+		vector<BeebAsmResult> results( VARIANTS );
+		vector<thread> threads;
+
+		for ( int i = 0; i < VARIANTS; i++ )
+		{
+			threads.push_back( thread( [&, i]()
+			{
+				results[ i ] = AssembleInMemory( "main.6502", files, options[ i ] );
+			} ) );
+		}
+
+		for ( size_t i = 0; i < threads.size(); i++ )
+		{
+			threads[ i ].join();
+		}
+
+		for ( int i = 0; i < VARIANTS; i++ )
+		{
+			Check( results[ i ].m_bSucceeded, "each variant assembles alongside the others" );
+			Check( results[ i ].m_memory == expected[ i ].m_memory, "memory matches the lone assembly" );
+			Check( results[ i ].m_savedFiles == expected[ i ].m_savedFiles, "saved files match the lone assembly" );
+			Check( results[ i ].m_symbols == expected[ i ].m_symbols, "labels match the lone assembly" );
+			Check( results[ i ].m_output == expected[ i ].m_output, "output matches the lone assembly" );
+			Check( results[ i ].m_diagnostics == expected[ i ].m_diagnostics, "diagnostics match the lone assembly" );
+		}
+	}
+}
+
+
+
+/*************************************************************************************************/
+/**
+	main()
+*/
+/*************************************************************************************************/
+int main()
+{
+	TestAssembly();
+	TestArguments();
+	TestMissingFile();
+	TestErrors();
+	TestCacheRejected();
+	TestConcurrentAssemblies();
+
+	if ( failures > 0 )
+	{
+		cerr << failures << ( failures == 1 ? " check failed" : " checks failed" ) << endl;
+		return EXIT_FAILURE;
+	}
+
+	cout << "All checks passed" << endl;
+	return EXIT_SUCCESS;
+}